@@ -0,0 +1,64 @@
+#!/bin/sh
+#
+# Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+#
+# This file is part of MenuGen:
+#
+#   http://www.stevefryatt.org.uk/risc-os/
+#
+# Licensed under the EUPL, Version 1.2 only (the "Licence");
+# You may not use this work except in compliance with the
+# Licence.
+#
+# You may obtain a copy of the Licence at:
+#
+#   http://joinup.ec.europa.eu/software/page/eupl
+#
+# Unless required by applicable law or agreed to in
+# writing, software distributed under the Licence is
+# distributed on an "AS IS" basis, WITHOUT WARRANTIES
+# OR CONDITIONS OF ANY KIND, either express or implied.
+#
+# See the Licence for the specific language governing
+# permissions and limitations under the Licence.
+
+# Run MenuGen over generated corpora of increasing size, recording the
+# throughput and peak memory of each run.
+#
+# Usage: bench.sh <menugen> <menucorpus> <workdir> [<sizes>]
+
+MENUGEN=$1
+MENUCORPUS=$2
+WORKDIR=$3
+SIZES=${4:-"100 1000 10000"}
+
+if [ -z "$MENUGEN" ] || [ -z "$MENUCORPUS" ] || [ -z "$WORKDIR" ]; then
+	echo "Usage: bench.sh <menugen> <menucorpus> <workdir> [<sizes>]"
+	exit 1
+fi
+
+mkdir -p "$WORKDIR" || exit 1
+
+RESULTS="$WORKDIR/results.txt"
+
+printf "%-8s %10s %10s %12s %12s %14s %12s\n" "Menus" "Source" "Output" "Parse ms" "Total ms" "Parse bytes/s" "Peak bytes" > "$RESULTS"
+
+for size in $SIZES; do
+	corpus="$WORKDIR/corpus$size.def"
+	output="$WORKDIR/corpus$size.mnu"
+	stats="$WORKDIR/corpus$size.json"
+
+	"$MENUCORPUS" "$corpus" -menus "$size" -dboxes $((size / 4)) || exit 1
+	"$MENUGEN" "$corpus" "$output" -d -m -stats "$stats" > /dev/null 2>&1 || exit 1
+
+	source=$(sed -n 's/.*"source_bytes":\([0-9]*\).*/\1/p' "$stats")
+	file=$(sed -n 's/.*"bytes":{[^}]*"total":\([0-9]*\)}.*/\1/p' "$stats")
+	parse=$(sed -n 's/.*"parse_ms":\([0-9.]*\).*/\1/p' "$stats")
+	total=$(sed -n 's/.*"total_ms":\([0-9.]*\).*/\1/p' "$stats")
+	rate=$(sed -n 's/.*"parse_bytes_per_second":\([0-9]*\).*/\1/p' "$stats")
+	peak=$(sed -n 's/.*"memory":{.*"total":{[^}]*"peak":\([0-9]*\)}.*/\1/p' "$stats")
+
+	printf "%-8s %10s %10s %12s %12s %14s %12s\n" "$size" "$source" "$file" "$parse" "$total" "$rate" "$peak" >> "$RESULTS"
+done
+
+cat "$RESULTS"
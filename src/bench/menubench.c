@@ -0,0 +1,802 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+/* MenuBench
+ *
+ * Time the individual stages of MenuGen in isolation, using in-memory
+ * sources which are shaped so that each run is dominated by a single
+ * kernel. Each kernel is timed over a number of samples, with the number
+ * of iterations in each sample calibrated so that timer resolution is
+ * not an issue; the median, minimum and median absolute deviation are
+ * reported. Results can be saved as a baseline, and later runs compared
+ * against it to find regressions in any one kernel.
+ *
+ * Syntax: MenuBench [<options>]
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/* MenuGen source headers. */
+
+#include "../gen/compile.h"
+#include "../gen/trace.h"
+
+/**
+ * The default number of samples to take for each kernel.
+ */
+
+#define BENCH_DEFAULT_SAMPLES 15
+
+/**
+ * The maximum number of samples which can be taken for each kernel.
+ */
+
+#define BENCH_MAX_SAMPLES 1000
+
+/**
+ * The minimum length of each sample, in microseconds.
+ */
+
+#define BENCH_SAMPLE_TIME 20000.0
+
+/**
+ * The maximum number of iterations in a single sample.
+ */
+
+#define BENCH_MAX_ITERATIONS 1048576
+
+/**
+ * The default percentage by which a kernel's median must slow before
+ * it is reported as a regression.
+ */
+
+#define BENCH_DEFAULT_THRESHOLD 10.0
+
+/**
+ * The maximum length of a kernel name in a baseline file.
+ */
+
+#define BENCH_MAX_NAME 32
+
+/**
+ * A block of generated source text.
+ */
+
+struct bench_text {
+	char		*text;			/**< The text, zero terminated.				*/
+	size_t		length;			/**< The length of the text, in bytes.			*/
+	size_t		size;			/**< The space allocated to the text.			*/
+};
+
+/**
+ * A kernel to be timed.
+ */
+
+struct bench_kernel {
+	char		*name;			/**< The name of the kernel.				*/
+	char		*description;		/**< A description of what is timed.			*/
+	bool		(*build)(struct bench_text *source, int scale);
+	bool		(*run)(struct bench_kernel *kernel, int iterations, double *elapsed);
+	struct bench_text source;		/**< The source used by the kernel.			*/
+};
+
+/**
+ * The results of timing a kernel, in nanoseconds per iteration.
+ */
+
+struct bench_result {
+	char		name[BENCH_MAX_NAME];	/**< The name of the kernel.				*/
+	double		median;			/**< The median of the samples.				*/
+	double		minimum;		/**< The fastest of the samples.			*/
+	double		deviation;		/**< The median absolute deviation of the samples.	*/
+};
+
+static bool bench_build_lexer(struct bench_text *source, int scale);
+static bool bench_build_parameters(struct bench_text *source, int scale);
+static bool bench_build_dispatch(struct bench_text *source, int scale);
+static bool bench_build_lookup(struct bench_text *source, int scale);
+static bool bench_build_localise(struct bench_text *source, int scale);
+static bool bench_run_parse(struct bench_kernel *kernel, int iterations, double *elapsed);
+static bool bench_run_lookup(struct bench_kernel *kernel, int iterations, double *elapsed);
+static bool bench_run_collate(struct bench_kernel *kernel, int iterations, double *elapsed);
+static bool bench_run_write(struct bench_kernel *kernel, int iterations, double *elapsed);
+static bool bench_run_localise(struct bench_kernel *kernel, int iterations, double *elapsed);
+
+/**
+ * The kernels which can be timed.
+ */
+
+static struct bench_kernel bench_kernels[] = {
+	{"lexer",	"Character lexer over comments and white space",	bench_build_lexer,	bench_run_parse,	{NULL, 0, 0}},
+	{"parameters",	"Parameter parsing for multi-value commands",		bench_build_parameters,	bench_run_parse,	{NULL, 0, 0}},
+	{"dispatch",	"Command dispatch for parameterless commands",		bench_build_dispatch,	bench_run_parse,	{NULL, 0, 0}},
+	{"lookup",	"Menu tag lookups in the reference checks",		bench_build_lookup,	bench_run_lookup,	{NULL, 0, 0}},
+	{"collate",	"Collation and submenu and dialogue chain linking",	bench_build_lookup,	bench_run_collate,	{NULL, 0, 0}},
+	{"write",	"Serialising a collated menu file",			bench_build_lookup,	bench_run_write,	{NULL, 0, 0}},
+	{"localise",	"Transcoding UTF-8 item text into Latin1",		bench_build_localise,	bench_run_localise,	{NULL, 0, 0}}
+};
+
+#define BENCH_KERNELS ((int) (sizeof(bench_kernels) / sizeof(struct bench_kernel)))
+
+/**
+ * The name of the scratch file used by the writer kernel.
+ */
+
+static char *bench_scratch_file = "menubench.tmp";
+
+/**
+ * The number of errors reported by MenuGen during the current kernel.
+ */
+
+static int bench_errors;
+
+static bool bench_time_kernel(struct bench_kernel *kernel, int samples, struct bench_result *result);
+static void bench_report(void *handle, struct report_record *record);
+static struct compile_context *bench_prepare(struct bench_kernel *kernel, bool collate);
+static bool bench_append(struct bench_text *source, char *format, ...);
+static int bench_compare_doubles(const void *a, const void *b);
+static bool bench_save_results(char *filename, struct bench_result *results, int count);
+static int bench_compare_results(char *filename, struct bench_result *results, int count, double threshold);
+
+
+int main(int argc, char *argv[])
+{
+	struct bench_result	results[BENCH_KERNELS];
+	char			*kernel_name = NULL, *save_file = NULL, *compare_file = NULL, *end;
+	int			param, kernel, count = 0, samples = BENCH_DEFAULT_SAMPLES, scale = 1, regressions = 0;
+	double			threshold = BENCH_DEFAULT_THRESHOLD;
+	bool			success = true, param_error = false;
+
+	for (param = 1; param < argc && !param_error; param++) {
+		if (strcmp(argv[param], "-kernel") == 0 && param + 1 < argc) {
+			kernel_name = argv[++param];
+		} else if (strcmp(argv[param], "-samples") == 0 && param + 1 < argc) {
+			samples = strtol(argv[++param], &end, 10);
+			if (*end != '\0' || samples < 3 || samples > BENCH_MAX_SAMPLES)
+				param_error = true;
+		} else if (strcmp(argv[param], "-scale") == 0 && param + 1 < argc) {
+			scale = strtol(argv[++param], &end, 10);
+			if (*end != '\0' || scale < 1)
+				param_error = true;
+		} else if (strcmp(argv[param], "-save") == 0 && param + 1 < argc) {
+			save_file = argv[++param];
+		} else if (strcmp(argv[param], "-compare") == 0 && param + 1 < argc) {
+			compare_file = argv[++param];
+		} else if (strcmp(argv[param], "-threshold") == 0 && param + 1 < argc) {
+			threshold = strtod(argv[++param], &end);
+			if (*end != '\0' || threshold < 0.0)
+				param_error = true;
+		} else if (strcmp(argv[param], "-scratch") == 0 && param + 1 < argc) {
+			bench_scratch_file = argv[++param];
+		} else {
+			param_error = true;
+		}
+	}
+
+	if (param_error) {
+		fprintf(stderr, "Usage: menubench [-kernel <name>] [-samples <n>] [-scale <n>] [-scratch <file>]\n");
+		fprintf(stderr, "                 [-save <file>] [-compare <file> [-threshold <%%>]]\n");
+		return 1;
+	}
+
+	printf("%-12s %12s %12s %10s  %s\n", "Kernel", "Median ns", "Min ns", "MAD %", "Description");
+
+	for (kernel = 0; kernel < BENCH_KERNELS && success; kernel++) {
+		if (kernel_name != NULL && strcmp(kernel_name, bench_kernels[kernel].name) != 0)
+			continue;
+
+		success = bench_kernels[kernel].build(&(bench_kernels[kernel].source), scale);
+		if (success)
+			success = bench_time_kernel(bench_kernels + kernel, samples, results + count);
+
+		free(bench_kernels[kernel].source.text);
+		bench_kernels[kernel].source.text = NULL;
+		bench_kernels[kernel].source.length = 0;
+		bench_kernels[kernel].source.size = 0;
+
+		if (!success) {
+			fprintf(stderr, "Failed to time kernel '%s'\n", bench_kernels[kernel].name);
+			break;
+		}
+
+		printf("%-12s %12.0f %12.0f %10.2f  %s\n", results[count].name, results[count].median, results[count].minimum,
+				(results[count].median > 0.0) ? 100.0 * results[count].deviation / results[count].median : 0.0,
+				bench_kernels[kernel].description);
+
+		count++;
+	}
+
+	remove(bench_scratch_file);
+
+	if (success && count == 0) {
+		fprintf(stderr, "No kernel named '%s'\n", kernel_name);
+		success = false;
+	}
+
+	if (success && save_file != NULL && !bench_save_results(save_file, results, count)) {
+		fprintf(stderr, "Failed to write baseline file '%s'\n", save_file);
+		success = false;
+	}
+
+	if (success && compare_file != NULL) {
+		regressions = bench_compare_results(compare_file, results, count, threshold);
+		if (regressions < 0)
+			success = false;
+	}
+
+	return (success && regressions == 0) ? 0 : 1;
+}
+
+
+/**
+ * Time a kernel, first calibrating the number of iterations needed for
+ * a sample to run for long enough to be measured accurately, and then
+ * taking the required number of samples.
+ *
+ * \param *kernel		The kernel to time.
+ * \param samples		The number of samples to take.
+ * \param *result		Pointer to a block to take the results.
+ * \return			True if successful; else False.
+ */
+
+static bool bench_time_kernel(struct bench_kernel *kernel, int samples, struct bench_result *result)
+{
+	double	times[BENCH_MAX_SAMPLES], elapsed;
+	int	iterations = 1, sample;
+
+	bench_errors = 0;
+
+	/* Calibrate, which also serves to warm the caches. */
+
+	do {
+		if (!kernel->run(kernel, iterations, &elapsed) || bench_errors > 0)
+			return false;
+
+		if (elapsed >= BENCH_SAMPLE_TIME || iterations >= BENCH_MAX_ITERATIONS)
+			break;
+
+		iterations *= (elapsed < BENCH_SAMPLE_TIME / 100.0) ? 10 : 2;
+	} while (true);
+
+	for (sample = 0; sample < samples; sample++) {
+		if (!kernel->run(kernel, iterations, &elapsed) || bench_errors > 0)
+			return false;
+
+		times[sample] = 1000.0 * elapsed / iterations;
+	}
+
+	qsort(times, samples, sizeof(double), bench_compare_doubles);
+
+	snprintf(result->name, BENCH_MAX_NAME, "%s", kernel->name);
+	result->minimum = times[0];
+	result->median = (samples % 2 == 1) ? times[samples / 2] : (times[samples / 2 - 1] + times[samples / 2]) / 2.0;
+
+	for (sample = 0; sample < samples; sample++)
+		times[sample] = (times[sample] > result->median) ? times[sample] - result->median : result->median - times[sample];
+
+	qsort(times, samples, sizeof(double), bench_compare_doubles);
+
+	result->deviation = (samples % 2 == 1) ? times[samples / 2] : (times[samples / 2 - 1] + times[samples / 2]) / 2.0;
+
+	return true;
+}
+
+
+/**
+ * Time the parsing of a kernel's source into a fresh compile context.
+ *
+ * \param *kernel		The kernel to run.
+ * \param iterations		The number of iterations to time.
+ * \param *elapsed		Pointer to a variable to take the time, in us.
+ * \return			True if successful; else False.
+ */
+
+static bool bench_run_parse(struct bench_kernel *kernel, int iterations, double *elapsed)
+{
+	struct compile_context	*context;
+	double			start;
+	int			i;
+
+	start = trace_time();
+
+	for (i = 0; i < iterations; i++) {
+		context = compile_create(bench_report, NULL);
+		if (context == NULL || !compile_parse_buffer(context, kernel->name, kernel->source.text, kernel->source.length, false)) {
+			compile_destroy(context);
+			return false;
+		}
+
+		compile_destroy(context);
+	}
+
+	*elapsed = trace_time() - start;
+
+	return true;
+}
+
+
+/**
+ * Time the reference checks, which look up every menu and submenu tag,
+ * on a context holding the kernel's parsed source.
+ *
+ * \param *kernel		The kernel to run.
+ * \param iterations		The number of iterations to time.
+ * \param *elapsed		Pointer to a variable to take the time, in us.
+ * \return			True if successful; else False.
+ */
+
+static bool bench_run_lookup(struct bench_kernel *kernel, int iterations, double *elapsed)
+{
+	struct compile_context	*context;
+	double			start;
+	int			i;
+	bool			success = true;
+
+	context = bench_prepare(kernel, false);
+	if (context == NULL)
+		return false;
+
+	start = trace_time();
+
+	for (i = 0; i < iterations && success; i++)
+		success = compile_check_references(context);
+
+	*elapsed = trace_time() - start;
+
+	compile_destroy(context);
+
+	return success;
+}
+
+
+/**
+ * Time the collation of the kernel's parsed source. Collation can only be
+ * done once on each context, so a fresh one is prepared, outside of the
+ * timed section, for each iteration.
+ *
+ * \param *kernel		The kernel to run.
+ * \param iterations		The number of iterations to time.
+ * \param *elapsed		Pointer to a variable to take the time, in us.
+ * \return			True if successful; else False.
+ */
+
+static bool bench_run_collate(struct bench_kernel *kernel, int iterations, double *elapsed)
+{
+	struct compile_context	*context;
+	double			start;
+	int			i;
+	bool			success = true;
+
+	*elapsed = 0.0;
+
+	for (i = 0; i < iterations && success; i++) {
+		context = bench_prepare(kernel, false);
+		if (context == NULL)
+			return false;
+
+		start = trace_time();
+		success = compile_collate(context, true, true, false, 0, false, false);
+		*elapsed += trace_time() - start;
+
+		compile_destroy(context);
+	}
+
+	return success;
+}
+
+
+/**
+ * Time writing the kernel's collated source out to the scratch file.
+ *
+ * \param *kernel		The kernel to run.
+ * \param iterations		The number of iterations to time.
+ * \param *elapsed		Pointer to a variable to take the time, in us.
+ * \return			True if successful; else False.
+ */
+
+static bool bench_run_write(struct bench_kernel *kernel, int iterations, double *elapsed)
+{
+	struct compile_context	*context;
+	double			start;
+	int			i;
+	bool			success = true;
+
+	context = bench_prepare(kernel, true);
+	if (context == NULL)
+		return false;
+
+	start = trace_time();
+
+	for (i = 0; i < iterations && success; i++)
+		success = compile_write_file(context, bench_scratch_file, DATA_FORMAT_MENUS, NULL, false, false);
+
+	*elapsed = trace_time() - start;
+
+	compile_destroy(context);
+
+	return success;
+}
+
+
+/**
+ * Time the localisation of the kernel's parsed source, transcoding all of
+ * its text from UTF-8 into Latin1.
+ *
+ * \param *kernel		The kernel to run.
+ * \param iterations		The number of iterations to time.
+ * \param *elapsed		Pointer to a variable to take the time, in us.
+ * \return			True if successful; else False.
+ */
+
+static bool bench_run_localise(struct bench_kernel *kernel, int iterations, double *elapsed)
+{
+	struct compile_context	*context;
+	double			start;
+	int			i;
+	bool			success = true;
+
+	context = bench_prepare(kernel, false);
+	if (context == NULL)
+		return false;
+
+	start = trace_time();
+
+	for (i = 0; i < iterations && success; i++)
+		success = compile_localise(context, NULL, ENCODING_LATIN1);
+
+	*elapsed = trace_time() - start;
+
+	compile_destroy(context);
+
+	return success;
+}
+
+
+/**
+ * Create a compile context holding a kernel's parsed source, optionally
+ * checked and collated ready for writing out.
+ *
+ * \param *kernel		The kernel to prepare a context for.
+ * \param collate		True to check and collate the source; else False.
+ * \return			The new context, or NULL on failure.
+ */
+
+static struct compile_context *bench_prepare(struct bench_kernel *kernel, bool collate)
+{
+	struct compile_context	*context;
+	bool			success;
+
+	context = compile_create(bench_report, NULL);
+	if (context == NULL)
+		return NULL;
+
+	success = compile_parse_buffer(context, kernel->name, kernel->source.text, kernel->source.length, false);
+
+	if (success && collate)
+		success = compile_check_references(context) && compile_collate(context, true, true, false, 0, false, false);
+
+	if (!success) {
+		compile_destroy(context);
+		return NULL;
+	}
+
+	return context;
+}
+
+
+/**
+ * Build a source which is mostly comments and white space, so that the
+ * time is spent in the character lexer.
+ *
+ * \param *source		The text block to build the source in.
+ * \param scale			The scale factor to apply to the source.
+ * \return			True if successful; else False.
+ */
+
+static bool bench_build_lexer(struct bench_text *source, int scale)
+{
+	int	line;
+	bool	success;
+
+	success = bench_append(source, "menu(lexer, \"Lexer\")\n{\n");
+
+	for (line = 0; success && line < 2000 * scale; line++)
+		success = bench_append(source, "\t/* Comment line %d, which is ignored by the parser. */\n  \t  \n", line);
+
+	if (success)
+		success = bench_append(source, "\titem(\"Item\");\n}\n");
+
+	return success;
+}
+
+
+/**
+ * Build a source which is mostly commands taking several parameters, so
+ * that the time is spent extracting and converting them.
+ *
+ * \param *source		The text block to build the source in.
+ * \param scale			The scale factor to apply to the source.
+ * \return			True if successful; else False.
+ */
+
+static bool bench_build_parameters(struct bench_text *source, int scale)
+{
+	int	item;
+	bool	success;
+
+	success = bench_append(source, "menu(parameters, \"Parameters\")\n{\n");
+
+	for (item = 0; success && item < 500 * scale; item++)
+		success = bench_append(source, "\titem(\"Item %d\") {\n\t\tcolours(7, 0);\n\t\tcolours(7, 0);\n"
+				"\t\tindirected(%d);\n\t\tindirected(%d);\n\t}\n", item, 20 + item % 10, 30 + item % 10);
+
+	if (success)
+		success = bench_append(source, "\tcolours(7, 2, 7, 0);\n}\n");
+
+	return success;
+}
+
+
+/**
+ * Build a source which is mostly parameterless commands, so that the time
+ * is spent in the command dispatch.
+ *
+ * \param *source		The text block to build the source in.
+ * \param scale			The scale factor to apply to the source.
+ * \return			True if successful; else False.
+ */
+
+static bool bench_build_dispatch(struct bench_text *source, int scale)
+{
+	int	item;
+	bool	success;
+
+	success = bench_append(source, "menu(dispatch, \"Dispatch\")\n{\n");
+
+	for (item = 0; success && item < 500 * scale; item++)
+		success = bench_append(source, "\titem(\"Item\") {\n\t\tticked;\n\t\tdotted;\n\t\tshaded;\n"
+				"\t\tticked;\n\t\tdotted;\n\t\tshaded;\n\t}\n");
+
+	if (success)
+		success = bench_append(source, "}\n");
+
+	return success;
+}
+
+
+/**
+ * Build a source with many menus linked by submenus and dialogue boxes,
+ * so that the reference checks, collation and output have plenty of
+ * tags to look up and chains to link.
+ *
+ * \param *source		The text block to build the source in.
+ * \param scale			The scale factor to apply to the source.
+ * \return			True if successful; else False.
+ */
+
+static bool bench_build_lookup(struct bench_text *source, int scale)
+{
+	int	menu, menus = 500 * scale;
+	bool	success = true;
+
+	for (menu = 0; success && menu < menus; menu++) {
+		success = bench_append(source, "menu(menu%d, \"Menu %d\")\n{\n\titem(\"Submenu\") { submenu(menu%d); }\n"
+				"\titem(\"Dialogue\") { d_box(dbox%d); }\n\titem(\"Writable\") { writable; indirected(20); }\n}\n",
+				menu, menu, (menu * 7 + 1) % menus, menu % 50);
+	}
+
+	return success;
+}
+
+
+/**
+ * Build a source with long item text, most of which is plain ASCII but
+ * with accented characters in every few items, so that both the fast
+ * path and the full transcoder are used.
+ *
+ * \param *source		The text block to build the source in.
+ * \param scale			The scale factor to apply to the source.
+ * \return			True if successful; else False.
+ */
+
+static bool bench_build_localise(struct bench_text *source, int scale)
+{
+	int	menu;
+	bool	success = true;
+
+	for (menu = 0; success && menu < 500 * scale; menu++) {
+		success = bench_append(source, "menu(menu%d, \"Menu %d\")\n{\n\titem(\"Save the document as a new file\");\n"
+				"\titem(\"Export the selection to the clipboard\");\n\titem(\"Gr\xc3\xb6\xc3\x9f""e \xc3\xa4ndern\xe2\x80\xa6\");\n"
+				"\titem(\"Print\");\n}\n", menu, menu);
+	}
+
+	return success;
+}
+
+
+/**
+ * Handle messages reported by MenuGen, counting any errors: the sources
+ * should always compile cleanly, so an error means that the results
+ * would not be valid.
+ *
+ * \param *handle		Unused.
+ * \param *record		The message being reported.
+ */
+
+static void bench_report(void *handle, struct report_record *record)
+{
+	if (record->level != REPORT_LEVEL_ERROR)
+		return;
+
+	if (bench_errors++ == 0)
+		fprintf(stderr, "%s line %d: %s\n", (record->file != NULL) ? record->file : "", record->line, record->message);
+}
+
+
+/**
+ * Append formatted text to a source block, growing it as required.
+ *
+ * \param *source		The text block to append to.
+ * \param *format		The printf() format for the text.
+ * \param ...			The parameters for the format.
+ * \return			True if successful; else False.
+ */
+
+static bool bench_append(struct bench_text *source, char *format, ...)
+{
+	va_list	ap;
+	int	length;
+	char	*text;
+
+	while (true) {
+		va_start(ap, format);
+		length = vsnprintf(source->text + source->length, source->size - source->length, format, ap);
+		va_end(ap);
+
+		if (length < 0)
+			return false;
+
+		if (source->text != NULL && source->length + length < source->size)
+			break;
+
+		text = realloc(source->text, source->size + length + 65536);
+		if (text == NULL)
+			return false;
+
+		source->text = text;
+		source->size += length + 65536;
+	}
+
+	source->length += length;
+
+	return true;
+}
+
+
+/**
+ * Compare two doubles for qsort().
+ *
+ * \param *a			The first value.
+ * \param *b			The second value.
+ * \return			The result of the comparison.
+ */
+
+static int bench_compare_doubles(const void *a, const void *b)
+{
+	double	x = *((const double *) a), y = *((const double *) b);
+
+	return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+
+/**
+ * Save a set of results to a baseline file.
+ *
+ * \param *filename		The name of the file to write.
+ * \param *results		The results to save.
+ * \param count			The number of results.
+ * \return			True if successful; else False.
+ */
+
+static bool bench_save_results(char *filename, struct bench_result *results, int count)
+{
+	FILE	*file;
+	int	result;
+	bool	success;
+
+	file = fopen(filename, "w");
+	if (file == NULL)
+		return false;
+
+	fprintf(file, "# MenuBench baseline: kernel, median ns, minimum ns, MAD ns\n");
+
+	for (result = 0; result < count; result++)
+		fprintf(file, "%s %.1f %.1f %.1f\n", results[result].name, results[result].median, results[result].minimum, results[result].deviation);
+
+	success = (ferror(file) == 0) ? true : false;
+
+	if (fclose(file) != 0)
+		success = false;
+
+	return success;
+}
+
+
+/**
+ * Compare a set of results against a baseline file. A kernel is reported
+ * as having regressed if its median is slower than the baseline by more
+ * than the threshold percentage, and the change is also more than three
+ * times the larger of the two deviations, so that noisy kernels do not
+ * give false alarms.
+ *
+ * \param *filename		The name of the baseline file.
+ * \param *results		The results to compare.
+ * \param count			The number of results.
+ * \param threshold		The percentage slowdown to allow.
+ * \return			The number of regressions, or -1 on failure.
+ */
+
+static int bench_compare_results(char *filename, struct bench_result *results, int count, double threshold)
+{
+	FILE			*file;
+	char			line[256];
+	struct bench_result	base;
+	double			change, noise;
+	int			result, regressions = 0;
+
+	file = fopen(filename, "r");
+	if (file == NULL) {
+		fprintf(stderr, "Failed to read baseline file '%s'\n", filename);
+		return -1;
+	}
+
+	printf("\n%-12s %12s %12s %10s\n", "Kernel", "Baseline ns", "Median ns", "Change %");
+
+	while (fgets(line, sizeof(line), file) != NULL) {
+		if (line[0] == '#' || sscanf(line, "%31s %lf %lf %lf", base.name, &base.median, &base.minimum, &base.deviation) != 4)
+			continue;
+
+		for (result = 0; result < count && strcmp(results[result].name, base.name) != 0; result++);
+
+		if (result == count || base.median <= 0.0)
+			continue;
+
+		change = 100.0 * (results[result].median - base.median) / base.median;
+		noise = 3.0 * ((base.deviation > results[result].deviation) ? base.deviation : results[result].deviation);
+
+		if (change > threshold && results[result].median - base.median > noise) {
+			printf("%-12s %12.0f %12.0f %+10.2f  REGRESSION\n", base.name, base.median, results[result].median, change);
+			regressions++;
+		} else {
+			printf("%-12s %12.0f %12.0f %+10.2f\n", base.name, base.median, results[result].median, change);
+		}
+	}
+
+	fclose(file);
+
+	return regressions;
+}
@@ -0,0 +1,356 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+/* MenuCorpus
+ *
+ * Generate synthetic menu definition files for benchmarking MenuGen, at
+ * a scale and with a mix of features set on the command line. The same
+ * parameters and seed always produce the same file.
+ *
+ * Syntax: MenuCorpus <output> [<options>]
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/**
+ * The settings used to generate a corpus file.
+ */
+
+struct corpus_settings {
+	int		menus;			/**< The number of menus to generate.			*/
+	int		items;			/**< The number of items in each menu.			*/
+	int		fanout;			/**< The number of submenus attached to each menu.	*/
+	int		depth;			/**< The maximum depth of a submenu tree.		*/
+	int		indirected;		/**< The percentage of items to indirect.		*/
+	int		writable;		/**< The percentage of items to make writable.		*/
+	int		validation;		/**< The percentage of writable items with validation.	*/
+	int		dboxes;			/**< The number of dialogue box references.		*/
+	int		dbox_names;		/**< The number of different dialogue boxes.		*/
+	int		comments;		/**< The percentage of items preceded by a comment.	*/
+	uint32_t	seed;			/**< The seed for the random number generator.		*/
+};
+
+/**
+ * The shape of the menu tree, with one entry for each menu.
+ */
+
+struct corpus_menu {
+	int		depth;			/**< The depth of the menu in its tree.			*/
+	int		children;		/**< The number of submenus attached so far.		*/
+	int		*child;			/**< The menus attached to the first items.		*/
+};
+
+static uint32_t corpus_random_state;
+
+static bool corpus_read_options(int argc, char *argv[], struct corpus_settings *settings);
+static struct corpus_menu *corpus_build_tree(struct corpus_settings *settings);
+static bool corpus_write_file(char *filename, struct corpus_settings *settings, struct corpus_menu *menus);
+static uint32_t corpus_random(void);
+static bool corpus_chance(int percentage);
+
+
+int main(int argc, char *argv[])
+{
+	struct corpus_settings	settings;
+	struct corpus_menu	*menus;
+	bool			success;
+	int			menu;
+
+	settings.menus = 100;
+	settings.items = 10;
+	settings.fanout = 2;
+	settings.depth = 4;
+	settings.indirected = 20;
+	settings.writable = 5;
+	settings.validation = 50;
+	settings.dboxes = 10;
+	settings.dbox_names = 8;
+	settings.comments = 10;
+	settings.seed = 1;
+
+	if (argc < 2 || !corpus_read_options(argc - 2, argv + 2, &settings)) {
+		fprintf(stderr, "Usage: menucorpus <output> [-menus <n>] [-items <n>] [-fanout <n>] [-depth <n>]\n");
+		fprintf(stderr, "                  [-indirected <%%>] [-writable <%%>] [-validation <%%>]\n");
+		fprintf(stderr, "                  [-dboxes <n>] [-dboxnames <n>] [-comments <%%>] [-seed <n>]\n");
+		return 1;
+	}
+
+	corpus_random_state = (settings.seed != 0) ? settings.seed : 1;
+
+	menus = corpus_build_tree(&settings);
+	if (menus == NULL) {
+		fprintf(stderr, "Failed to allocate memory for menu tree\n");
+		return 1;
+	}
+
+	success = corpus_write_file(argv[1], &settings, menus);
+	if (!success)
+		fprintf(stderr, "Failed to write corpus file '%s'\n", argv[1]);
+
+	for (menu = 0; menu < settings.menus; menu++)
+		free(menus[menu].child);
+
+	free(menus);
+
+	return (success) ? 0 : 1;
+}
+
+
+/**
+ * Read the command line options, updating the settings for any which
+ * are found.
+ *
+ * \param argc			The number of options to read.
+ * \param *argv[]		The options to read.
+ * \param *settings		Pointer to the settings to update.
+ * \return			True if the options were valid; else False.
+ */
+
+static bool corpus_read_options(int argc, char *argv[], struct corpus_settings *settings)
+{
+	int	param, value;
+	char	*end;
+
+	for (param = 0; param + 1 < argc; param += 2) {
+		value = strtol(argv[param + 1], &end, 10);
+		if (*end != '\0' || value < 0)
+			return false;
+
+		if (strcmp(argv[param], "-menus") == 0 && value > 0)
+			settings->menus = value;
+		else if (strcmp(argv[param], "-items") == 0 && value > 0)
+			settings->items = value;
+		else if (strcmp(argv[param], "-fanout") == 0)
+			settings->fanout = value;
+		else if (strcmp(argv[param], "-depth") == 0)
+			settings->depth = value;
+		else if (strcmp(argv[param], "-indirected") == 0 && value <= 100)
+			settings->indirected = value;
+		else if (strcmp(argv[param], "-writable") == 0 && value <= 100)
+			settings->writable = value;
+		else if (strcmp(argv[param], "-validation") == 0 && value <= 100)
+			settings->validation = value;
+		else if (strcmp(argv[param], "-dboxes") == 0)
+			settings->dboxes = value;
+		else if (strcmp(argv[param], "-dboxnames") == 0 && value > 0)
+			settings->dbox_names = value;
+		else if (strcmp(argv[param], "-comments") == 0 && value <= 100)
+			settings->comments = value;
+		else if (strcmp(argv[param], "-seed") == 0)
+			settings->seed = value;
+		else
+			return false;
+	}
+
+	/* Each submenu needs an item of its own to hang from. */
+
+	if (settings->fanout > settings->items)
+		settings->fanout = settings->items;
+
+	return (param == argc) ? true : false;
+}
+
+
+/**
+ * Build the shape of the menu tree. Menus are attached in turn to the
+ * first menu which still has space for a submenu and isn't at the maximum
+ * depth; if there isn't one, the menu starts a new tree.
+ *
+ * \param *settings		The settings to use.
+ * \return			Pointer to the menu array, or NULL on failure.
+ */
+
+static struct corpus_menu *corpus_build_tree(struct corpus_settings *settings)
+{
+	struct corpus_menu	*menus;
+	int			menu, parent = 0;
+
+	menus = malloc(sizeof(struct corpus_menu) * settings->menus);
+	if (menus == NULL)
+		return NULL;
+
+	for (menu = 0; menu < settings->menus; menu++) {
+		menus[menu].children = 0;
+		menus[menu].child = (settings->fanout > 0) ? malloc(sizeof(int) * settings->fanout) : NULL;
+
+		if (settings->fanout > 0 && menus[menu].child == NULL) {
+			while (menu-- > 0)
+				free(menus[menu].child);
+			free(menus);
+			return NULL;
+		}
+
+		while (parent < menu && (menus[parent].children >= settings->fanout || menus[parent].depth >= settings->depth))
+			parent++;
+
+		if (parent < menu) {
+			menus[menu].depth = menus[parent].depth + 1;
+			menus[parent].child[menus[parent].children++] = menu;
+		} else {
+			menus[menu].depth = 0;
+		}
+	}
+
+	return menus;
+}
+
+
+/**
+ * Write a corpus file.
+ *
+ * \param *filename		The name of the file to write.
+ * \param *settings		The settings to use.
+ * \param *menus		The shape of the menu tree.
+ * \return			True if the file was written; else False.
+ */
+
+static bool corpus_write_file(char *filename, struct corpus_settings *settings, struct corpus_menu *menus)
+{
+	FILE	*file;
+	int	menu, item, eligible, dboxes, dbox = 0, submenu, target;
+	bool	success, writable, validation, indirected, dotted;
+	char	text[64];
+
+	file = fopen(filename, "w");
+	if (file == NULL)
+		return false;
+
+	fprintf(file, "/* MenuGen benchmark corpus\n *\n");
+	fprintf(file, " * menus %d, items %d, fanout %d, depth %d, indirected %d%%, writable %d%%,\n",
+			settings->menus, settings->items, settings->fanout, settings->depth,
+			settings->indirected, settings->writable);
+	fprintf(file, " * validation %d%%, dboxes %d (%d names), comments %d%%, seed %u\n */\n",
+			settings->validation, settings->dboxes, settings->dbox_names, settings->comments,
+			(unsigned) settings->seed);
+
+	/* Items which don't lead to submenus are eligible to lead to dialogue
+	 * boxes; choose the required number evenly across them.
+	 */
+
+	eligible = settings->menus * settings->items;
+	for (menu = 0; menu < settings->menus; menu++)
+		eligible -= menus[menu].children;
+
+	dboxes = (settings->dboxes < eligible) ? settings->dboxes : eligible;
+
+	for (menu = 0; menu < settings->menus; menu++) {
+		fprintf(file, "\nmenu(m%d, \"Menu %d\")\n{\n", menu, menu);
+
+		if (corpus_chance(settings->indirected))
+			fprintf(file, "  indirected(%d);\n", 20 + (int) (corpus_random() % 20));
+
+		for (item = 0; item < settings->items; item++) {
+			if (corpus_chance(settings->comments))
+				fprintf(file, "  /* Item %d of menu %d. */\n", item, menu);
+
+			snprintf(text, sizeof(text), "Item %d.%d", menu, item);
+
+			submenu = (item < menus[menu].children) ? menus[menu].child[item] : -1;
+
+			target = -1;
+			if (submenu == -1) {
+				if (dboxes > 0 && (int) (corpus_random() % eligible) < dboxes) {
+					target = dbox++ % settings->dbox_names;
+					dboxes--;
+				}
+
+				eligible--;
+			}
+
+			writable = corpus_chance(settings->writable);
+			validation = writable && corpus_chance(settings->validation);
+			indirected = writable || corpus_chance(settings->indirected);
+			dotted = (item % 4 == 3) ? true : false;
+
+			if (submenu == -1 && target == -1 && !writable && !indirected && !dotted) {
+				fprintf(file, "  item(\"%s\");\n", text);
+				continue;
+			}
+
+			fprintf(file, "  item(\"%s\") {\n", text);
+
+			if (submenu != -1)
+				fprintf(file, "    submenu(m%d);\n", submenu);
+
+			if (target != -1)
+				fprintf(file, "    d_box(dbox%d);\n", target);
+
+			if (validation)
+				fprintf(file, "    writable { validation(\"A0-9\"); }\n");
+			else if (writable)
+				fprintf(file, "    writable;\n");
+
+			if (indirected)
+				fprintf(file, "    indirected(%d);\n", (int) strlen(text) + 10);
+
+			if (dotted)
+				fprintf(file, "    dotted;\n");
+
+			fprintf(file, "  }\n");
+		}
+
+		fprintf(file, "}\n");
+	}
+
+	success = (ferror(file) == 0) ? true : false;
+
+	if (fclose(file) != 0)
+		success = false;
+
+	return success;
+}
+
+
+/**
+ * Return the next number from a simple xorshift random number generator,
+ * so that the output is the same on every platform.
+ *
+ * \return			The next random number.
+ */
+
+static uint32_t corpus_random(void)
+{
+	corpus_random_state ^= corpus_random_state << 13;
+	corpus_random_state ^= corpus_random_state >> 17;
+	corpus_random_state ^= corpus_random_state << 5;
+
+	return corpus_random_state;
+}
+
+
+/**
+ * Make a random decision.
+ *
+ * \param percentage		The percentage chance of returning True.
+ * \return			True or False.
+ */
+
+static bool corpus_chance(int percentage)
+{
+	return ((int) (corpus_random() % 100) < percentage) ? true : false;
+}
+
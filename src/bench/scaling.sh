@@ -0,0 +1,116 @@
+#!/bin/sh
+#
+# Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+#
+# This file is part of MenuGen:
+#
+#   http://www.stevefryatt.org.uk/risc-os/
+#
+# Licensed under the EUPL, Version 1.2 only (the "Licence");
+# You may not use this work except in compliance with the
+# Licence.
+#
+# You may obtain a copy of the Licence at:
+#
+#   http://joinup.ec.europa.eu/software/page/eupl
+#
+# Unless required by applicable law or agreed to in
+# writing, software distributed under the Licence is
+# distributed on an "AS IS" basis, WITHOUT WARRANTIES
+# OR CONDITIONS OF ANY KIND, either express or implied.
+#
+# See the Licence for the specific language governing
+# permissions and limitations under the Licence.
+
+
+# Run a MenuGen built with counters ("make COUNTERS=1") over generated
+# corpora which double in size at each step, and check that none of the
+# hot-path operation counts grow faster than the input: across the whole
+# range, each may grow by no more than the input does, plus a tolerance.
+# Unlike timings, the counts are exact, so the check is reliable on a
+# busy machine.
+#
+# Usage: scaling.sh <menugen> <menucorpus> <workdir> [<base> [<steps> [<tolerance %>]]]
+
+MENUGEN=$1
+MENUCORPUS=$2
+WORKDIR=$3
+BASE=${4:-500}
+STEPS=${5:-4}
+TOLERANCE=${6:-25}
+
+if [ -z "$MENUGEN" ] || [ -z "$MENUCORPUS" ] || [ -z "$WORKDIR" ]; then
+	echo "Usage: scaling.sh <menugen> <menucorpus> <workdir> [<base> [<steps> [<tolerance %>]]]"
+	exit 1
+fi
+
+mkdir -p "$WORKDIR" || exit 1
+
+failures=0
+
+# Run the corpora with and without embedded tags, as the dialogue boxes are
+# linked differently in each case.
+
+for options in "-d -m" "none"; do
+	flags=$options
+	[ "$flags" = "none" ] && flags=""
+
+	echo "Options: $options"
+
+	previous=""
+	size=$BASE
+	step=0
+
+	while [ $step -lt $STEPS ]; do
+		corpus="$WORKDIR/scale$size.def"
+		output="$WORKDIR/scale$size.mnu"
+		stats="$WORKDIR/scale$size.json"
+		counts="$WORKDIR/scale$size-$(echo "$options" | tr -d ' -').txt"
+
+		dboxnames=$((size / 8))
+		[ $dboxnames -lt 1 ] && dboxnames=1
+
+		"$MENUCORPUS" "$corpus" -menus "$size" -dboxes $((size / 4)) -dboxnames $dboxnames || exit 1
+		"$MENUGEN" "$corpus" "$output" $flags -stats "$stats" > /dev/null 2>&1 || exit 1
+
+		sed -n 's/.*"counters":{\([^[]*\),"commands".*/\1/p' "$stats" | tr ',' '\n' | tr -d '"' | tr ':' ' ' > "$counts"
+
+		if [ ! -s "$counts" ]; then
+			echo "No counters in statistics: build MenuGen with COUNTERS=1"
+			exit 1
+		fi
+
+		if [ -n "$previous" ]; then
+			awk -v size=$size '
+				FNR == NR { before[$1] = $2; next }
+				{
+					ratio = (before[$1] > 0) ? $2 / before[$1] : 0
+					printf "  %-7d %-24s %12d %12d %8.2f\n", size, $1, before[$1], $2, ratio
+				}' "$previous" "$counts"
+		else
+			first=$counts
+		fi
+
+		previous=$counts
+		size=$((size * 2))
+		step=$((step + 1))
+	done
+
+	# Hash table loading makes the probe counts wobble from step to step,
+	# so judge the growth across the whole range of sizes.
+
+	awk -v growth=$((size / BASE / 2)) -v tolerance=$TOLERANCE '
+		FNR == NR { first[$1] = $2; next }
+		first[$1] > 0 && $2 / first[$1] > growth * (1 + tolerance / 100) {
+			printf "  %-32s grew %.1f times for %d times the input: NONLINEAR\n", $1, $2 / first[$1], growth
+			failed++
+		}
+		END { exit (failed > 0) }' "$first" "$previous" || failures=$((failures + 1))
+done
+
+if [ $failures -gt 0 ]; then
+	echo "Operation counts grew faster than the input."
+	exit 1
+fi
+
+echo "All operation counts scale linearly."
@@ -53,11 +53,134 @@ struct file_head_block {
 
 struct file_extended_head_block {
 	int				zero;				/**< Zero to signify new data format.		*/
-	int				flags;				/**< File format flags (unused at present).	*/
+	int				flags;				/**< File format flags.				*/
 	int				menus;				/**< Offset to the menu list.			*/
 	int				end;				/**< Zero to indicate the end of the header.	*/
 };
 
+/**
+ * Extended file head flags.
+ */
+
+#define FILE_FLAGS_RELOCATED 0x00000001				/**< The offsets in the file are absolute addresses.	*/
+#define FILE_FLAGS_COMPRESSED 0x00000002			/**< The file is a compressed container.		*/
+#define FILE_FLAGS_COMPACT 0x00000004				/**< The file uses the compact format.			*/
+
+/**
+ * Relocation head block, which follows the extended file head block in
+ * files with FILE_FLAGS_RELOCATED set. In these files, every offset has
+ * been replaced by its address when the file is loaded at the base address,
+ * the indirected text, validation strings and submenus have been linked
+ * in, and the submenu offsets in the menu blocks are -1. Only dialogue
+ * boxes must still be linked in by the application.
+ */
+
+struct file_relocation_head_block {
+	int				base;				/**< The address at which to load the file.	*/
+};
+
+/**
+ * Compression head block, which follows the extended file head block in
+ * files with FILE_FLAGS_COMPRESSED set. The rest of the file is the whole of
+ * the uncompressed Menus file, packed by MenuGen's LZ compressor. The other
+ * words in the container's head blocks are copied from the uncompressed
+ * file, for information, with -1 for any which it doesn't have.
+ */
+
+struct file_compression_head_block {
+	int				length;				/**< The length of the uncompressed file.	*/
+};
+
+/**
+ * Compact relocation table, which follows the menus in files with
+ * FILE_FLAGS_COMPACT set and is found from the indirection offset in the
+ * file head. In these files, the menu blocks don't have the next and
+ * submenu words, so each Wimp menu block is followed by its items and then
+ * by the next menu, up to the start of the table. The indirected text,
+ * validation strings and submenus are already linked in as offsets from the
+ * start of the file, and every word holding one is listed in the table in
+ * ascending order. Adding the load address to each listed word makes the
+ * menus usable; the submenu offsets of items which open dialogue boxes are
+ * left as -1.
+ *
+ * Each entry is the number of words since the previous entry, or since the
+ * start of the file for the first, stored seven bits to a byte, least
+ * significant first, with the top bit set on all but the last byte.
+ *
+ * The table is padded to a word boundary, and followed by the string pool,
+ * found from the validation offset in the file head. This holds the
+ * indirected text buffers, the validation strings with duplicates removed,
+ * and then any dialogue box and menu names, packed without alignment and
+ * padded to a word boundary at the end.
+ */
+
+struct file_compact_relocation_block {
+	int				relocations;			/**< The number of entries in the table.	*/
+	unsigned char			words[];			/**< The encoded offsets of the words.		*/
+};
+
+/**
+ * Compact dialogue table head block, found from the dialogue offset in the
+ * file head, and followed by a chain block for each dialogue box. If the
+ * names aren't embedded, there is a single chain holding every item which
+ * opens a dialogue box, in the order that the handles must be supplied.
+ */
+
+struct file_compact_dialogue_block {
+	int				chains;				/**< The number of chain blocks which follow.	*/
+	int				names;				/**< Offset to the first name in the pool, or -1. */
+};
+
+/**
+ * Compact dialogue chain block, padded to a word boundary. The offsets of
+ * the items' submenu words are encoded in the same way as the relocation
+ * table, and the names of the dialogue boxes follow each other in the
+ * string pool, in the same order as the chain blocks.
+ */
+
+struct file_compact_chain_block {
+	int				dialogues;			/**< The number of items in the chain.		*/
+	unsigned char			items[];			/**< The encoded offsets of the items.		*/
+};
+
+/**
+ * Compact menu table, found from the menu offset in the extended file head.
+ * The names of the menus follow each other in the string pool, in the same
+ * order as the offsets.
+ */
+
+struct file_compact_tag_block {
+	int				menus;				/**< The number of menus in the table.		*/
+	int				names;				/**< Offset to the first name in the pool.	*/
+	int				offsets[];			/**< Offsets to the menu blocks.		*/
+};
+
+/**
+ * Shard manifest head block. A manifest accompanies a set of Menus files
+ * which have been split along the submenu tree, and is followed by a link
+ * block for each submenu which is in a different file from its parent item.
+ * The first shard is the core file; shard n is in a file whose name is the
+ * core file's name with n appended.
+ */
+
+struct file_manifest_head_block {
+	int				shards;				/**< The number of shards, including the core.	*/
+	int				links;				/**< The number of link blocks which follow.	*/
+};
+
+/**
+ * Shard manifest link block. In its own shard, the item's submenu offset
+ * is -1 and the item has the submenu warning flag set, so the application
+ * can load the submenu's shard when it is first opened.
+ */
+
+struct file_manifest_link_block {
+	int				item_shard;			/**< The shard holding the menu item.		*/
+	int				item;				/**< Offset to the item's submenu pointer.	*/
+	int				menu_shard;			/**< The shard holding the submenu.		*/
+	int				menu;				/**< Offset to the submenu's menu block.	*/
+};
+
 /**
  * The block of icon data associated with an indirected text icon in a Wimp
  * icon block.
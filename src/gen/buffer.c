@@ -0,0 +1,381 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+/**
+ * Memory buffers, used so that source files can be read and output files
+ * written in a single operation each, rather than a byte or a block at
+ * a time.
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/* Local source headers. */
+
+#include "buffer.h"
+#include "memory.h"
+
+/**
+ * The size by which an output buffer grows if it runs out of space.
+ */
+
+#define BUFFER_ALLOCATION_STEP 4096
+
+/**
+ * The filename used to refer to standard input or standard output.
+ */
+
+#define BUFFER_STANDARD_STREAM "-"
+
+struct buffer_block {
+	struct memory_block	*memory;	/**< The memory block to allocate from.		*/
+	char			*data;		/**< The buffer contents.			*/
+	size_t			size;		/**< The space allocated to the buffer.		*/
+	size_t			length;		/**< The number of bytes currently in use.	*/
+};
+
+static char *buffer_load_stream(FILE *file, struct memory_block *memory, size_t *length);
+
+/**
+ * Load a file into memory, returning a pointer to a block which must be
+ * freed with memory_release() and optionally the size of the data. The
+ * block is zero-terminated, so that it can be treated as a string if
+ * required. A filename of "-" reads from standard input.
+ *
+ * \param *filename	Pointer to the name of the file to load.
+ * \param *memory	The memory block to record the allocation in, or NULL.
+ * \param *length	Pointer to a variable to take the block length, or NULL.
+ * \return		Pointer to the loaded block, or NULL on failure.
+ */
+
+char *buffer_load_file(char *filename, struct memory_block *memory, size_t *length)
+{
+	FILE	*file;
+	long	len;
+	char	*data;
+
+	if (length != NULL)
+		*length = 0;
+
+	if (filename == NULL)
+		return NULL;
+
+	if (buffer_is_standard_stream(filename))
+		return buffer_load_stream(stdin, memory, length);
+
+	file = fopen(filename, "rb");
+	if (file == NULL)
+		return NULL;
+
+	fseek(file, 0, SEEK_END);
+	len = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	if (len < 0) {
+		fclose(file);
+		return NULL;
+	}
+
+	/* Claim the required memory, then load the file in one go. */
+
+	data = memory_claim(memory, MEMORY_BUFFERS, len + 1);
+	if (data != NULL && fread(data, sizeof(char), len, file) != len) {
+		memory_release(memory, data);
+		data = NULL;
+	} else if (data != NULL) {
+		data[len] = '\0';
+
+		if (length != NULL)
+			*length = len;
+	}
+
+	fclose(file);
+
+	return data;
+}
+
+/**
+ * Load the contents of a stream which can't be sized in advance, such as a
+ * pipe, into memory in the same form as buffer_load_file().
+ *
+ * \param *file		The stream to read from.
+ * \param *memory	The memory block to record the allocation in, or NULL.
+ * \param *length	Pointer to a variable to take the block length, or NULL.
+ * \return		Pointer to the loaded block, or NULL on failure.
+ */
+
+static char *buffer_load_stream(FILE *file, struct memory_block *memory, size_t *length)
+{
+	char	*data, *block;
+	size_t	size = BUFFER_ALLOCATION_STEP * 4, len = 0;
+
+	data = memory_claim(memory, MEMORY_BUFFERS, size);
+	if (data == NULL)
+		return NULL;
+
+	do {
+		if (len + 1 >= size) {
+			size += BUFFER_ALLOCATION_STEP * 4;
+
+			block = memory_resize(memory, data, size);
+			if (block == NULL) {
+				memory_release(memory, data);
+				return NULL;
+			}
+
+			data = block;
+		}
+
+		len += fread(data + len, sizeof(char), size - len - 1, file);
+	} while (!feof(file) && !ferror(file));
+
+	if (ferror(file)) {
+		memory_release(memory, data);
+		return NULL;
+	}
+
+	data[len] = '\0';
+
+	if (length != NULL)
+		*length = len;
+
+	return data;
+}
+
+/**
+ * Test whether a filename refers to standard input or standard output.
+ *
+ * \param *filename	The filename to test.
+ * \return		True if the filename is "-"; else False.
+ */
+
+bool buffer_is_standard_stream(char *filename)
+{
+	return (filename != NULL && strcmp(filename, BUFFER_STANDARD_STREAM) == 0) ? true : false;
+}
+
+/**
+ * Create a new, empty output buffer.
+ *
+ * \param *memory	The memory block to record the buffer's allocations
+ *			in, or NULL.
+ * \param size		The number of bytes expected to be written to the
+ *			buffer, or 0 if this isn't known.
+ * \return		Pointer to the new buffer, or NULL on failure.
+ */
+
+struct buffer_block *buffer_create(struct memory_block *memory, size_t size)
+{
+	struct buffer_block	*buffer;
+
+	buffer = memory_claim(memory, MEMORY_BUFFERS, sizeof(struct buffer_block));
+	if (buffer == NULL)
+		return NULL;
+
+	if (size == 0)
+		size = BUFFER_ALLOCATION_STEP;
+
+	buffer->memory = memory;
+	buffer->data = memory_claim(memory, MEMORY_BUFFERS, size);
+	buffer->size = size;
+	buffer->length = 0;
+
+	if (buffer->data == NULL) {
+		memory_release(memory, buffer);
+		return NULL;
+	}
+
+	return buffer;
+}
+
+/**
+ * Destroy an output buffer, freeing the memory that it uses.
+ *
+ * \param *buffer	The buffer to destroy.
+ */
+
+void buffer_destroy(struct buffer_block *buffer)
+{
+	if (buffer == NULL)
+		return;
+
+	memory_release(buffer->memory, buffer->data);
+	memory_release(buffer->memory, buffer);
+}
+
+/**
+ * Claim a zeroed block of memory on the end of an output buffer, so that
+ * it can be filled in by the caller. The pointer returned is only valid
+ * until the next call to buffer_claim() on the same buffer.
+ *
+ * \param *buffer	The buffer to claim memory from.
+ * \param length	The number of bytes to claim.
+ * \return		Pointer to the claimed memory, or NULL on failure.
+ */
+
+void *buffer_claim(struct buffer_block *buffer, size_t length)
+{
+	char	*block;
+	size_t	size;
+
+	if (buffer == NULL)
+		return NULL;
+
+	if (buffer->length + length > buffer->size) {
+		size = buffer->length + length + BUFFER_ALLOCATION_STEP;
+
+		block = memory_resize(buffer->memory, buffer->data, size);
+		if (block == NULL)
+			return NULL;
+
+		buffer->data = block;
+		buffer->size = size;
+	}
+
+	block = buffer->data + buffer->length;
+	buffer->length += length;
+
+	memset(block, 0, length);
+
+	return block;
+}
+
+/**
+ * Return the contents of an output buffer. The pointer returned is only
+ * valid until the buffer is next written to.
+ *
+ * \param *buffer	The buffer to return the contents of.
+ * \param *length	Pointer to a variable to take the number of bytes in
+ *			use, or NULL.
+ * \return		Pointer to the contents, or NULL on failure.
+ */
+
+void *buffer_get_data(struct buffer_block *buffer, size_t *length)
+{
+	if (length != NULL)
+		*length = (buffer != NULL) ? buffer->length : 0;
+
+	return (buffer != NULL) ? buffer->data : NULL;
+}
+
+/**
+ * Append formatted text to the end of an output buffer. The text is not
+ * terminated, so that further calls follow on directly from it.
+ *
+ * \param *buffer	The buffer to write to.
+ * \param *format	The printf() format string.
+ * \param ...		Parameters for the format string.
+ * \return		True if the text was added OK; else False.
+ */
+
+bool buffer_printf(struct buffer_block *buffer, char *format, ...)
+{
+	va_list	ap;
+	int	length;
+	char	*block;
+
+	if (buffer == NULL || format == NULL)
+		return false;
+
+	va_start(ap, format);
+	length = vsnprintf(NULL, 0, format, ap);
+	va_end(ap);
+
+	if (length < 0)
+		return false;
+
+	/* Claim space for the terminator which vsnprintf() will write, then
+	 * give it back so that the next block follows on.
+	 */
+
+	block = buffer_claim(buffer, length + 1);
+	if (block == NULL)
+		return false;
+
+	va_start(ap, format);
+	vsnprintf(block, length + 1, format, ap);
+	va_end(ap);
+
+	buffer->length--;
+
+	return true;
+}
+
+/**
+ * Write the contents of an output buffer to a file. A filename of "-"
+ * writes to standard output.
+ *
+ * \param *buffer	The buffer to be written.
+ * \param *filename	The name of the file to write to.
+ * \param changes_only	True to leave the file untouched if it already
+ *			holds the same data as the buffer; else False.
+ *			Ignored when writing to standard output.
+ * \return		True if the file was written OK; else False.
+ */
+
+bool buffer_save_file(struct buffer_block *buffer, char *filename, bool changes_only)
+{
+	FILE	*file;
+	char	*existing;
+	size_t	length;
+	bool	success;
+
+	if (buffer == NULL || filename == NULL)
+		return false;
+
+	if (buffer_is_standard_stream(filename)) {
+		success = (fwrite(buffer->data, sizeof(char), buffer->length, stdout) == buffer->length) ? true : false;
+
+		if (fflush(stdout) != 0)
+			success = false;
+
+		return success;
+	}
+
+	if (changes_only) {
+		existing = buffer_load_file(filename, buffer->memory, &length);
+
+		success = (existing != NULL && length == buffer->length &&
+				memcmp(existing, buffer->data, length) == 0) ? true : false;
+
+		memory_release(buffer->memory, existing);
+
+		if (success)
+			return true;
+	}
+
+	file = fopen(filename, "wb");
+	if (file == NULL)
+		return false;
+
+	success = (fwrite(buffer->data, sizeof(char), buffer->length, file) == buffer->length) ? true : false;
+
+	if (fclose(file) != 0)
+		success = false;
+
+	return success;
+}
+
@@ -0,0 +1,44 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+#ifndef MENUGEN_BUFFER_H
+#define MENUGEN_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "memory.h"
+
+struct buffer_block;
+
+char *buffer_load_file(char *filename, struct memory_block *memory, size_t *length);
+bool buffer_is_standard_stream(char *filename);
+struct buffer_block *buffer_create(struct memory_block *memory, size_t size);
+void buffer_destroy(struct buffer_block *buffer);
+void *buffer_claim(struct buffer_block *buffer, size_t length);
+void *buffer_get_data(struct buffer_block *buffer, size_t *length);
+bool buffer_printf(struct buffer_block *buffer, char *format, ...);
+bool buffer_save_file(struct buffer_block *buffer, char *filename, bool changes_only);
+
+#endif
+
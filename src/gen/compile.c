@@ -0,0 +1,435 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+/**
+ * The MenuGen library interface.
+ *
+ * All of the state for a compilation is held in a compile context, so
+ * any number of contexts can exist at once and separate contexts can be
+ * used from separate threads without any locking. A single context must
+ * not be used from more than one thread at a time.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+/* Local source headers. */
+
+#include "compile.h"
+
+#include "counters.h"
+#include "data.h"
+#include "memory.h"
+#include "messages.h"
+#include "parse.h"
+#include "report.h"
+
+/**
+ * A compile context, holding everything required to compile a single
+ * menu definition file.
+ */
+
+struct compile_context {
+	struct report_block	*report;	/**< The report block for messages.		*/
+	struct data_block	*data;		/**< The data block holding the menus.		*/
+	struct memory_block	*memory;	/**< The memory block counting allocations.	*/
+	struct counter_block	counters;	/**< The hot-path counters.			*/
+	struct parse_statistics	source;		/**< Statistics about the parsed source file.	*/
+	struct messages_block	*messages;	/**< The messages for the current locale, or NULL.	*/
+};
+
+/**
+ * Create a new compile context.
+ *
+ * \param handler	The handler to receive diagnostic messages, or NULL
+ *			to have them written to stderr.
+ * \param *handle	A handle to be passed to the handler.
+ * \return		Pointer to the new context, or NULL on failure.
+ */
+
+struct compile_context *compile_create(report_handler handler, void *handle)
+{
+	struct compile_context	*context;
+
+	context = malloc(sizeof(struct compile_context));
+	if (context == NULL)
+		return NULL;
+
+	context->report = report_create(handler, handle);
+	counters_initialise(&context->counters);
+
+	context->memory = memory_create();
+	context->data = (context->report != NULL) ? data_create(context->report, context->memory, &context->counters) : NULL;
+
+	context->source.bytes = 0;
+	context->source.lines = 0;
+	context->source.statements = 0;
+
+	context->messages = NULL;
+
+	if (context->report == NULL || context->memory == NULL || context->data == NULL) {
+		data_destroy(context->data);
+		memory_destroy(context->memory);
+		report_destroy(context->report);
+		free(context);
+		return NULL;
+	}
+
+	return context;
+}
+
+/**
+ * Destroy a compile context, freeing all of the resources that it uses.
+ *
+ * \param *context	The context to destroy.
+ */
+
+void compile_destroy(struct compile_context *context)
+{
+	if (context == NULL)
+		return;
+
+	data_destroy(context->data);
+	messages_destroy(context->messages);
+	memory_destroy(context->memory);
+	report_destroy(context->report);
+
+	free(context);
+}
+
+/**
+ * Set the subsystems in a compile context whose verbose messages are to
+ * be reported. By default, all of them are.
+ *
+ * \param *context	The context to update.
+ * \param subsystems	A mask of report subsystems.
+ */
+
+void compile_set_verbose(struct compile_context *context, unsigned subsystems)
+{
+	if (context == NULL)
+		return;
+
+	report_set_verbose(context->report, subsystems);
+}
+
+/**
+ * Parse a menu definition file into a compile context. Only one file
+ * should be parsed into each context.
+ *
+ * \param *context	The context to parse the file into.
+ * \param *filename	The name of the file to parse.
+ * \param verbose	True to report details of the parsing; else False.
+ * \return		True if the file parsed without errors; else False.
+ */
+
+bool compile_parse_file(struct compile_context *context, char *filename, bool verbose)
+{
+	bool	success;
+
+	if (context == NULL)
+		return false;
+
+	report_set_file(context->report, filename);
+
+	success = parse_process_file(context->data, context->report, context->memory, &context->counters, filename, verbose, &context->source);
+
+	report_flush(context->report);
+
+	return success;
+}
+
+/**
+ * Parse a menu definition held in memory into a compile context. Only one
+ * definition should be parsed into each context.
+ *
+ * \param *context	The context to parse the definition into.
+ * \param *name		A name for the definition, used in messages, or NULL.
+ * \param *buffer	The menu definition to parse.
+ * \param length		The length of the definition, in bytes.
+ * \param verbose	True to report details of the parsing; else False.
+ * \return		True if the definition parsed without errors; else False.
+ */
+
+bool compile_parse_buffer(struct compile_context *context, char *name, char *buffer, size_t length, bool verbose)
+{
+	bool	success;
+
+	if (context == NULL)
+		return false;
+
+	report_set_file(context->report, name);
+
+	success = parse_process_buffer(context->data, context->report, context->memory, &context->counters, buffer, length, verbose, &context->source);
+
+	report_flush(context->report);
+
+	return success;
+}
+
+/**
+ * Check the references between the menus in a compile context.
+ *
+ * \param *context	The context to check.
+ * \return		True if the references are valid; else False.
+ */
+
+bool compile_check_references(struct compile_context *context)
+{
+	bool	success;
+
+	if (context == NULL)
+		return false;
+
+	success = data_check_references(context->data);
+
+	report_flush(context->report);
+
+	return success;
+}
+
+/**
+ * Set the locale for the menus in a compile context, looking up any message
+ * tokens in their titles and items and transcoding the text into the
+ * target encoding. This must be done before the menus are collated, and
+ * can be done again to produce the menus for another locale.
+ *
+ * \param *context	The context to localise.
+ * \param *filename	The name of the Messages file to use, or NULL to
+ *			use the text from the source.
+ * \param encoding	The encoding to transcode the text into.
+ * \return		True if all of the text was resolved; else False.
+ */
+
+bool compile_localise(struct compile_context *context, char *filename, enum encoding_target encoding)
+{
+	struct messages_block	*messages = NULL;
+	bool			success = true;
+
+	if (context == NULL)
+		return false;
+
+	if (filename != NULL) {
+		messages = messages_load(filename, context->memory);
+
+		if (messages == NULL) {
+			report_error(context->report, REPORT_CHECK, 0, 0, "Bad messages file '%s'", filename);
+			success = false;
+		}
+	}
+
+	/* The text is switched to the new messages before the old ones are
+	 * freed, as it may still point into them until then.
+	 */
+
+	if (!data_localise(context->data, messages, encoding))
+		success = false;
+
+	messages_destroy(context->messages);
+	context->messages = messages;
+
+	report_flush(context->report);
+
+	return success;
+}
+
+/**
+ * Collate the menus in a compile context, ready for output. A context can
+ * be collated more than once with different options, to write several
+ * variants of the same menus without parsing the source again.
+ *
+ * \param *context	The context to collate.
+ * \param embed_tag	True if menu tags should be embedded; else False.
+ * \param embed_dbox	True if dialogue box names should be embeded; else False.
+ * \param relocate	True if the file should be relocated to a fixed
+ *			address; else False.
+ * \param base		The address to relocate the file to.
+ * \param compact	True if the file should use the compact format; else
+ *			False.
+ * \param verbose	True if verbose output is required; else False.
+ * \return		True if collation completed successfully; else False.
+ */
+
+bool compile_collate(struct compile_context *context, bool embed_tag, bool embed_dbox, bool relocate, unsigned base, bool compact, bool verbose)
+{
+	bool	success;
+
+	if (context == NULL)
+		return false;
+
+	success = data_collate_structures(context->data, embed_tag, embed_dbox, relocate, base, compact, verbose);
+
+	report_flush(context->report);
+
+	return success;
+}
+
+/**
+ * Report details of the collated menus in a compile context.
+ *
+ * \param *context	The context to report on.
+ */
+
+void compile_print_report(struct compile_context *context)
+{
+	if (context == NULL)
+		return;
+
+	data_print_structure_report(context->data);
+
+	report_flush(context->report);
+}
+
+/**
+ * Collect statistics about a compilation. The output sizes are only valid
+ * once the menus have been collated.
+ *
+ * \param *context	The context to report on.
+ * \param *statistics	Pointer to a block to take the statistics.
+ */
+
+void compile_get_statistics(struct compile_context *context, struct compile_statistics *statistics)
+{
+	if (context == NULL || statistics == NULL)
+		return;
+
+	statistics->source = context->source;
+	data_get_statistics(context->data, &statistics->output);
+	memory_get_statistics(context->memory, &statistics->memory);
+	statistics->counters = context->counters;
+}
+
+/**
+ * Write the collated menus in a compile context to a Menus file, or to a
+ * C or assembler source file holding the Menus file's contents.
+ *
+ * \param *context	The context to write.
+ * \param *filename	The name of the file to write.
+ * \param format	The form in which to write the file.
+ * \param *symbol	The symbol to give the data in source formats, or NULL.
+ * \param compress	True to write the file in a compressed container;
+ *			else False.
+ * \param changes_only	True to leave the file untouched if its contents
+ *			would not change; else False.
+ * \return		True if the file was written successfully; else False.
+ */
+
+bool compile_write_file(struct compile_context *context, char *filename, enum data_format format, char *symbol, bool compress, bool changes_only)
+{
+	bool	success;
+
+	if (context == NULL)
+		return false;
+
+	success = data_write_standard_menu_file(context->data, filename, format, symbol, compress, changes_only);
+
+	report_flush(context->report);
+
+	return success;
+}
+
+/**
+ * Write a C header file describing the Menus file which was last written
+ * from a compile context.
+ *
+ * \param *context	The compile context to use.
+ * \param *filename	The header file to write.
+ * \param *menus	The name of the Menus file being described.
+ * \param changes_only	True to leave the file untouched if its contents
+ *			would not change; else False.
+ * \return		True if the file was written OK; else False.
+ */
+
+bool compile_write_header(struct compile_context *context, char *filename, char *menus, bool changes_only)
+{
+	bool	success;
+
+	if (context == NULL)
+		return false;
+
+	success = data_write_c_header(context->data, filename, menus, changes_only);
+
+	report_flush(context->report);
+
+	return success;
+}
+
+/**
+ * Split the menus in a compile context into shards along the submenu tree,
+ * ready to be selected, collated and written out one at a time.
+ *
+ * \param *context	The context to split.
+ * \return		The number of shards, or 0 if there are no menus.
+ */
+
+int compile_assign_shards(struct compile_context *context)
+{
+	if (context == NULL)
+		return 0;
+
+	return data_assign_shards(context->data);
+}
+
+/**
+ * Select the shard whose menus are to be collated and written next.
+ *
+ * \param *context	The context to update.
+ * \param shard		The shard to select, or DATA_ALL_SHARDS to select
+ *			all of the menus again.
+ * \return		True if the shard was selected; else False.
+ */
+
+bool compile_select_shard(struct compile_context *context, int shard)
+{
+	if (context == NULL)
+		return false;
+
+	return data_select_shard(context->data, shard);
+}
+
+/**
+ * Write the manifest describing the links between the shards which were
+ * last written from a compile context.
+ *
+ * \param *context	The compile context to use.
+ * \param *filename	The manifest file to write.
+ * \param changes_only	True to leave the file untouched if its contents
+ *			would not change; else False.
+ * \return		True if the file was written OK; else False.
+ */
+
+bool compile_write_manifest(struct compile_context *context, char *filename, bool changes_only)
+{
+	bool	success;
+
+	if (context == NULL)
+		return false;
+
+	success = data_write_shard_manifest(context->data, filename, changes_only);
+
+	report_flush(context->report);
+
+	return success;
+}
+
@@ -0,0 +1,67 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+#ifndef MENUGEN_COMPILE_H
+#define MENUGEN_COMPILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "counters.h"
+#include "data.h"
+#include "encoding.h"
+#include "memory.h"
+#include "parse.h"
+#include "report.h"
+
+struct compile_context;
+
+/**
+ * Statistics about a compilation.
+ */
+
+struct compile_statistics {
+	struct parse_statistics	source;		/**< Statistics about the source file.		*/
+	struct data_statistics	output;		/**< Statistics about the menus and output.	*/
+	struct memory_statistics memory;	/**< Statistics about the memory used.		*/
+	struct counter_block	counters;	/**< The hot-path counters, if compiled in.	*/
+};
+
+struct compile_context *compile_create(report_handler handler, void *handle);
+void compile_destroy(struct compile_context *context);
+void compile_set_verbose(struct compile_context *context, unsigned subsystems);
+bool compile_parse_file(struct compile_context *context, char *filename, bool verbose);
+bool compile_parse_buffer(struct compile_context *context, char *name, char *buffer, size_t length, bool verbose);
+bool compile_check_references(struct compile_context *context);
+bool compile_localise(struct compile_context *context, char *filename, enum encoding_target encoding);
+bool compile_collate(struct compile_context *context, bool embed_tag, bool embed_dbox, bool relocate, unsigned base, bool compact, bool verbose);
+void compile_print_report(struct compile_context *context);
+void compile_get_statistics(struct compile_context *context, struct compile_statistics *statistics);
+bool compile_write_file(struct compile_context *context, char *filename, enum data_format format, char *symbol, bool compress, bool changes_only);
+bool compile_write_header(struct compile_context *context, char *filename, char *menus, bool changes_only);
+int compile_assign_shards(struct compile_context *context);
+bool compile_select_shard(struct compile_context *context, int shard);
+bool compile_write_manifest(struct compile_context *context, char *filename, bool changes_only);
+
+#endif
+
@@ -0,0 +1,230 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+/**
+ * LZ compression, used to pack Menus files into the compressed container.
+ *
+ * The compressed data is a sequence of blocks, each holding a run of
+ * literal bytes followed by a match which copies bytes from earlier in the
+ * output. A block starts with a token byte, whose top four bits give the
+ * number of literals and bottom four the match length less four; a value
+ * of 15 in either is followed by further bytes which are added on, up to
+ * and including the first which isn't 255. The literals then follow the
+ * token and any extra length bytes, and are followed by the two-byte, low
+ * byte first, distance back to the start of the match and then the extra
+ * match length bytes. The final block has literals but no match, and ends
+ * at the end of the data.
+ *
+ * This is the same block layout as LZ4, chosen because it can be unpacked
+ * with a few byte copies and no tables at all; the compressor only has to
+ * be reasonable, so it takes the first match that it finds.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local source headers. */
+
+#include "compress.h"
+
+#include "buffer.h"
+
+/**
+ * The number of bits in a hash of four input bytes.
+ */
+
+#define COMPRESS_HASH_BITS 14
+
+/**
+ * The shortest match which is worth encoding.
+ */
+
+#define COMPRESS_MIN_MATCH 4
+
+/**
+ * The furthest back that a match can be found.
+ */
+
+#define COMPRESS_MAX_DISTANCE 65535
+
+static bool compress_write_block(struct buffer_block *output, uint8_t *literals, size_t count, size_t distance, size_t length);
+static bool compress_write_length(struct buffer_block *output, size_t length);
+static uint32_t compress_hash(uint8_t *data);
+
+/**
+ * Compress a block of data, appending the result to an output buffer.
+ *
+ * \param *output	The buffer to write the compressed data to.
+ * \param *input	Pointer to the data to compress.
+ * \param length	The number of bytes to compress.
+ * \return		True if the data was compressed OK; else False.
+ */
+
+bool compress_block(struct buffer_block *output, void *input, size_t length)
+{
+	uint8_t		*data = input;
+	long		*table;
+	size_t		position = 0, anchor = 0, match;
+	long		candidate;
+	int		entry;
+	bool		success = true;
+
+	if (output == NULL || (data == NULL && length > 0))
+		return false;
+
+	/* The table holds the last position at which each hash was seen. */
+
+	table = malloc(sizeof(long) << COMPRESS_HASH_BITS);
+	if (table == NULL)
+		return false;
+
+	for (entry = 0; entry < (1 << COMPRESS_HASH_BITS); entry++)
+		table[entry] = -1;
+
+	while (success && position + COMPRESS_MIN_MATCH <= length) {
+		entry = compress_hash(data + position);
+		candidate = table[entry];
+		table[entry] = position;
+
+		if (candidate < 0 || position - candidate > COMPRESS_MAX_DISTANCE ||
+				memcmp(data + candidate, data + position, COMPRESS_MIN_MATCH) != 0) {
+			position++;
+			continue;
+		}
+
+		match = COMPRESS_MIN_MATCH;
+
+		while (position + match < length && data[candidate + match] == data[position + match])
+			match++;
+
+		success = compress_write_block(output, data + anchor, position - anchor, position - candidate, match);
+
+		position += match;
+		anchor = position;
+	}
+
+	/* The final block holds the remaining literals, with no match. */
+
+	if (success)
+		success = compress_write_block(output, data + anchor, length - anchor, 0, 0);
+
+	free(table);
+
+	return success;
+}
+
+/**
+ * Write a block of compressed data, consisting of a run of literal bytes
+ * and an optional match.
+ *
+ * \param *output	The buffer to write the block to.
+ * \param *literals	Pointer to the literal bytes.
+ * \param count		The number of literal bytes.
+ * \param distance	The distance back to the start of the match.
+ * \param length	The length of the match, or 0 for none.
+ * \return		True if the block was written OK; else False.
+ */
+
+static bool compress_write_block(struct buffer_block *output, uint8_t *literals, size_t count, size_t distance, size_t length)
+{
+	uint8_t	*block;
+	size_t	match = (length > 0) ? length - COMPRESS_MIN_MATCH : 0;
+
+	block = buffer_claim(output, 1);
+	if (block == NULL)
+		return false;
+
+	*block = ((count < 15) ? count : 15) << 4 | ((match < 15) ? match : 15);
+
+	if (count >= 15 && !compress_write_length(output, count - 15))
+		return false;
+
+	if (count > 0) {
+		block = buffer_claim(output, count);
+		if (block == NULL)
+			return false;
+
+		memcpy(block, literals, count);
+	}
+
+	if (length == 0)
+		return true;
+
+	block = buffer_claim(output, 2);
+	if (block == NULL)
+		return false;
+
+	block[0] = distance & 0xff;
+	block[1] = (distance >> 8) & 0xff;
+
+	if (match >= 15 && !compress_write_length(output, match - 15))
+		return false;
+
+	return true;
+}
+
+/**
+ * Write the extra bytes for a literal or match length which didn't fit
+ * into the token: a run of 255s, followed by the remainder.
+ *
+ * \param *output	The buffer to write the bytes to.
+ * \param length	The length remaining to be written.
+ * \return		True if the bytes were written OK; else False.
+ */
+
+static bool compress_write_length(struct buffer_block *output, size_t length)
+{
+	uint8_t	*block;
+
+	block = buffer_claim(output, length / 255 + 1);
+	if (block == NULL)
+		return false;
+
+	while (length >= 255) {
+		*block++ = 255;
+		length -= 255;
+	}
+
+	*block = length;
+
+	return true;
+}
+
+/**
+ * Hash the four bytes at a position in the input.
+ *
+ * \param *data		Pointer to the bytes to hash.
+ * \return		The hash, in the range of the table.
+ */
+
+static uint32_t compress_hash(uint8_t *data)
+{
+	uint32_t	value;
+
+	value = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24);
+
+	return (value * 2654435761u) >> (32 - COMPRESS_HASH_BITS);
+}
+
@@ -0,0 +1,82 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+/* Local source headers. */
+
+#include "counters.h"
+
+/**
+ * The names of the counters, in the order of enum counter_id.
+ */
+
+static char *counters_names[] = {
+#define COUNTER(id, name) name,
+	COUNTER_LIST
+#undef COUNTER
+};
+
+/**
+ * Initialise a set of counters, setting them all to zero.
+ *
+ * \param *counters	The counters to initialise.
+ */
+
+void counters_initialise(struct counter_block *counters)
+{
+	if (counters != NULL)
+		memset(counters, 0, sizeof(struct counter_block));
+}
+
+/**
+ * Report whether the counters have been compiled in.
+ *
+ * \return		True if the counters are available; else False.
+ */
+
+bool counters_enabled(void)
+{
+#ifdef MENUGEN_COUNTERS
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Return the name of a counter.
+ *
+ * \param id		The counter to name.
+ * \return		Pointer to the name of the counter.
+ */
+
+char *counters_name(enum counter_id id)
+{
+	if (id < 0 || id >= COUNTER_COUNT)
+		return "unknown";
+
+	return counters_names[id];
+}
+
@@ -0,0 +1,102 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+/**
+ * Hot-path counters, which are only compiled in if MENUGEN_COUNTERS is
+ * defined at build time (use "make COUNTERS=1"). When they are not, the
+ * COUNTER_* macros expand to nothing and their arguments aren't evaluated.
+ */
+
+#ifndef MENUGEN_COUNTERS_H
+#define MENUGEN_COUNTERS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The list of counters, in the form COUNTER(id, name). The ids are used
+ * with the COUNTER_ADD() macro, and the names appear in the output.
+ */
+
+#define COUNTER_LIST \
+	COUNTER(LEX_BYTES,		"lex_bytes")			\
+	COUNTER(LEX_COMMENTS,		"lex_comments")			\
+	COUNTER(STATEMENTS,		"statements")			\
+	COUNTER(COMMAND_PROBES,		"command_table_probes")		\
+	COUNTER(MENU_TAG_LOOKUPS,	"menu_tag_lookups")		\
+	COUNTER(MENU_TAG_PROBES,	"menu_tag_probes")		\
+	COUNTER(DBOX_TAG_LOOKUPS,	"dbox_tag_lookups")		\
+	COUNTER(DBOX_TAG_PROBES,	"dbox_tag_probes")		\
+	COUNTER(SUBMENU_LINK_STEPS,	"submenu_link_steps")		\
+	COUNTER(DBOX_LINK_STEPS,	"dbox_link_steps")		\
+	COUNTER(DBOX_ORDER_STEPS,	"dbox_order_steps")
+
+enum counter_id {
+#define COUNTER(id, name) COUNTER_##id,
+	COUNTER_LIST
+#undef COUNTER
+	COUNTER_COUNT
+};
+
+/**
+ * The number of commands for which dispatch counts can be kept.
+ */
+
+#define COUNTER_MAX_COMMANDS 32
+
+/**
+ * A set of counters, for a single compilation.
+ */
+
+struct counter_block {
+	unsigned long	value[COUNTER_COUNT];			/**< The values of the counters.		*/
+	unsigned long	command[COUNTER_MAX_COMMANDS];		/**< The dispatch counts for each command.	*/
+	char		*command_name[COUNTER_MAX_COMMANDS];	/**< The names of the commands.			*/
+};
+
+#ifdef MENUGEN_COUNTERS
+
+#define COUNTER_ADD(counters, id, n) \
+	do { if ((counters) != NULL) (counters)->value[COUNTER_##id] += (n); } while (0)
+
+#define COUNTER_POINTER(counters, id) \
+	(((counters) != NULL) ? &((counters)->value[COUNTER_##id]) : NULL)
+
+#define COUNTER_COMMAND(counters, index, name) \
+	do { if ((counters) != NULL && (index) >= 0 && (index) < COUNTER_MAX_COMMANDS) { \
+		(counters)->command[(index)]++; (counters)->command_name[(index)] = (name); } } while (0)
+
+#else
+
+#define COUNTER_ADD(counters, id, n) do { } while (0)
+#define COUNTER_POINTER(counters, id) (NULL)
+#define COUNTER_COMMAND(counters, index, name) do { } while (0)
+
+#endif
+
+void counters_initialise(struct counter_block *counters);
+bool counters_enabled(void);
+char *counters_name(enum counter_id id);
+
+#endif
+
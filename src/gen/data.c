@@ -21,6 +21,7 @@
  * permissions and limitations under the Licence.
  */
 
+#include <ctype.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -34,11 +35,39 @@
 
 #include "data.h"
 
+#include "buffer.h"
+#include "compress.h"
+#include "counters.h"
+#include "encoding.h"
+#include "hash.h"
+#include "memory.h"
+#include "messages.h"
+#include "report.h"
+
 #include "../file.h"
 
 #define NULL_OFFSET -1
 #define NO_SUBMENU  -1
 
+/**
+ * The longest message token which can be used for a title or item.
+ */
+
+#define MAX_TOKEN_LEN 64
+
+/**
+ * Text longer than this is indirected automatically.
+ */
+
+#define MAX_DIRECT_TEXT 12
+
+/**
+ * The longest identifier, including its terminator, which will be written
+ * into a C header file.
+ */
+
+#define MAX_IDENTIFIER_LEN 64
+
 /**
  * Internal data structures, used to collect the information together
  * prior to building the menu defs file.
@@ -49,6 +78,16 @@ struct item_definition {
 	int			text_len; /* 0 for non-indirected. */
 	char			*validation;
 
+	char			*source_text; /* The text as given in the source. */
+	char			*source_validation;
+	int			indirection; /* The indirected size requested, or -1. */
+
+	char			*encoded_text; /* Transcoded copies, or NULL. */
+	char			*encoded_validation;
+
+	int			line; /* Where the item was defined. */
+	int			column;
+
 	wimp_menu_flags		menu_flags;
 	wimp_icon_flags		icon_flags;
 
@@ -57,6 +96,8 @@ struct item_definition {
 
 	char			submenu_tag[MAX_TAG_LEN];
 	bool			submenu_dbox; /* True if the item is a dbox. */
+	int			submenu_line; /* Where the submenu was specified. */
+	int			submenu_column;
 
 	struct menu_definition	*submenu;
 	struct dbox_chain_data	*dbox;
@@ -73,6 +114,14 @@ struct menu_definition {
 	char			*title;
 	int			title_len; /* 0 for non-indirected. */
 
+	char			*source_title; /* The title as given in the source. */
+	int			indirection; /* The indirected size requested, or -1. */
+
+	char			*encoded_title; /* A transcoded copy, or NULL. */
+
+	int			line; /* Where the menu was defined. */
+	int			column;
+
 	bool			reversed;
 
 	int			item_width;
@@ -91,7 +140,11 @@ struct menu_definition {
 
 	int			file_offset; /* Where this menu resides. */
 
-	struct menu_definition	*next;
+	int			shard; /* The shard holding the menu. */
+	struct menu_definition	*next_queued; /* The next menu waiting to be sharded. */
+
+	struct menu_definition	*next; /* The next menu in the selected shard. */
+	struct menu_definition	*next_defined; /* The next menu in the source. */
 };
 
 struct indirection_data {
@@ -151,39 +204,318 @@ struct menu_tag_data {
 	struct menu_tag_data	*next;
 };
 
-static struct menu_definition	*menu_list = NULL;
-static struct indirection_data	*indirection_list = NULL;
-static struct validation_data	*validation_list = NULL;
-static struct submenu_data	*submenu_list = NULL;
-static struct dbox_data		*dbox_list = NULL;
-static struct dbox_chain_data	*dbox_chain_list = NULL;
-static struct menu_tag_data	*menu_tag_list = NULL;
+/**
+ * A data block, holding the menu structures for one compilation.
+ */
+
+struct data_block {
+	struct report_block	*report;
+	struct memory_block	*memory;
+	struct counter_block	*counters;
+
+	struct menu_definition	*menu_list;
+	struct menu_definition	*defined_list;
+	struct indirection_data	*indirection_list;
+	struct validation_data	*validation_list;
+	struct submenu_data	*submenu_list;
+	struct dbox_data	*dbox_list;
+	struct dbox_chain_data	*dbox_chain_list;
+	struct menu_tag_data	*menu_tag_list;
+
+	struct hash_table	*menu_index;
+	struct hash_table	*dbox_chain_index;
+
+	struct menu_definition	*current_menu;
+	struct item_definition	*current_item;
+
+	int			shards; /* The number of shards assigned. */
+	int			shard; /* The selected shard, or DATA_ALL_SHARDS. */
+
+	int			dbox_offset;
+
+	int			longest_indirection;
+	int			longest_validation;
+	int			longest_dbox_chain;
+	int			longest_menu_tag;
+
+	bool			extended_head; /* True if the file has an extended head. */
+	bool			relocate; /* True if the offsets are to be relocated. */
+	unsigned		base; /* The address to relocate to. */
+	bool			compact; /* True if the file uses the compact format. */
+	int			relocations; /* The entries in the compact relocation table. */
+
+	int			menus_offset;
+	int			indirection_offset;
+	int			validation_offset;
+	int			dbox_chain_offset;
+	int			menu_tag_offset;
+	int			file_length;
+};
+
+static void			data_discard_collation(struct data_block *data);
+static struct menu_definition	*data_find_menu_from_tag(struct data_block *data, char *tag);
+static struct dbox_chain_data	*data_find_dbox_chain_from_tag(struct data_block *data, char *tag);
+static struct dbox_data		*data_reverse_dbox_list(struct data_block *data, struct dbox_data *list);
+static bool			data_resolve_text(struct data_block *data, struct messages_block *messages, char *source, char **text, int line, int column);
+static bool			data_encode_text(struct data_block *data, enum encoding_target encoding, char **buffer, char **text, int line, int column);
+static int			data_indirected_length(char *text, int indirection);
+static char			*data_make_identifier(struct hash_table *names, char *buffer, char *text, char end, int index, bool lower);
+static bool			data_collate_compact(struct data_block *data, bool embed_tag, bool embed_dbox, int offset);
+static int			data_build_relocation_table(struct data_block *data, unsigned char *buffer, int *relocations);
+static int			data_build_dialogue_chain(struct data_block *data, struct dbox_chain_data *dbox_chain, unsigned char *buffer, int *dialogues);
+static int			data_encode_compact_offset(unsigned char *buffer, int length, int offset, int *previous);
+static void			data_fill_shard(struct data_block *data, struct menu_definition *menu, int shard);
+static struct menu_definition	*data_find_shard_link(struct data_block *data, struct item_definition *item);
+static bool			data_write_standard_sections(struct data_block *data, struct buffer_block *file);
+static bool			data_write_compact_sections(struct data_block *data, struct buffer_block *file);
+static void			data_relocate_image(struct data_block *data, int *image);
+static void			data_relocate_word(int *image, int offset, int value, unsigned base);
+static struct buffer_block	*data_compress_image(struct data_block *data, struct buffer_block *file);
+static bool			data_save_image(struct data_block *data, struct buffer_block *file, char *filename, enum data_format format, char *symbol, bool changes_only);
+static char			*data_boolean_yes_no(int value);
 
-static struct menu_definition	*current_menu = NULL;
-static struct item_definition	*current_item = NULL;
+/**
+ * Create a new, empty, data block to hold the menu structures for a
+ * compilation.
+ *
+ * \param *report	The report block to send messages to.
+ * \param *memory	The memory block to record allocations in, or NULL.
+ * \param *counters	The counters to update, or NULL.
+ * \return		Pointer to the new block, or NULL on failure.
+ */
 
-static int			dbox_offset = NULL_OFFSET;
+struct data_block *data_create(struct report_block *report, struct memory_block *memory, struct counter_block *counters)
+{
+	struct data_block	*data;
+
+	data = malloc(sizeof(struct data_block));
+	if (data == NULL)
+		return NULL;
+
+	data->report = report;
+	data->memory = memory;
+	data->counters = counters;
+
+	data->menu_list = NULL;
+	data->defined_list = NULL;
+	data->indirection_list = NULL;
+	data->validation_list = NULL;
+	data->submenu_list = NULL;
+	data->dbox_list = NULL;
+	data->dbox_chain_list = NULL;
+	data->menu_tag_list = NULL;
+
+	data->menu_index = hash_create(memory, COUNTER_POINTER(counters, MENU_TAG_PROBES));
+	data->dbox_chain_index = hash_create(memory, COUNTER_POINTER(counters, DBOX_TAG_PROBES));
+
+	if (data->menu_index == NULL || data->dbox_chain_index == NULL) {
+		hash_destroy(data->menu_index);
+		hash_destroy(data->dbox_chain_index);
+		free(data);
+		return NULL;
+	}
 
-static int			longest_indirection = 0;
-static int			longest_validation = 0;
-static int			longest_dbox_chain = 0;
-static int			longest_menu_tag = 0;
+	data->current_menu = NULL;
+	data->current_item = NULL;
 
-struct menu_definition		*data_find_menu_from_tag(char *tag);
-struct dbox_chain_data		*data_find_dbox_chain_from_tag(char *tag);
-static char			*data_boolean_yes_no(int value);
+	data->shards = 0;
+	data->shard = DATA_ALL_SHARDS;
+
+	data->dbox_offset = NULL_OFFSET;
+
+	data->longest_indirection = 0;
+	data->longest_validation = 0;
+	data->longest_dbox_chain = 0;
+	data->longest_menu_tag = 0;
+
+	data->extended_head = false;
+	data->relocate = false;
+	data->base = 0;
+	data->compact = false;
+	data->relocations = 0;
+
+	data->menus_offset = 0;
+	data->indirection_offset = 0;
+	data->validation_offset = 0;
+	data->dbox_chain_offset = 0;
+	data->menu_tag_offset = 0;
+	data->file_length = 0;
+
+	return data;
+}
+
+/**
+ * Destroy a data block, freeing all of the menu structures held in it.
+ *
+ * \param *data		The data block to destroy.
+ */
+
+void data_destroy(struct data_block *data)
+{
+	struct menu_definition	*menu;
+	struct item_definition	*item;
+
+	if (data == NULL)
+		return;
+
+	data_discard_collation(data);
+	data_select_shard(data, DATA_ALL_SHARDS);
+
+	hash_destroy(data->menu_index);
+	hash_destroy(data->dbox_chain_index);
+
+	while (data->menu_list != NULL) {
+		menu = data->menu_list;
+		data->menu_list = menu->next;
+
+		while (menu->first_item != NULL) {
+			item = menu->first_item;
+			menu->first_item = item->next;
+
+			if (item->source_text != NULL)
+				memory_release(data->memory, item->source_text);
+			if (item->source_validation != NULL)
+				memory_release(data->memory, item->source_validation);
+			if (item->encoded_text != NULL)
+				memory_release(data->memory, item->encoded_text);
+			if (item->encoded_validation != NULL)
+				memory_release(data->memory, item->encoded_validation);
+			memory_release(data->memory, item);
+		}
+
+		if (menu->source_title != NULL)
+			memory_release(data->memory, menu->source_title);
+		if (menu->encoded_title != NULL)
+			memory_release(data->memory, menu->encoded_title);
+		memory_release(data->memory, menu);
+	}
+
+	free(data);
+}
+
+/**
+ * Discard the results of any previous collation, freeing the section lists
+ * and unlinking the submenu and dialogue box chains, so that the menus can
+ * be collated again with different options. The parsed menus are left
+ * untouched.
+ *
+ * Param:  *data	The data block to reset.
+ */
+
+static void data_discard_collation(struct data_block *data)
+{
+	struct menu_definition	*menu;
+	struct item_definition	*item;
+	struct indirection_data	*indirection;
+	struct validation_data	*validation;
+	struct submenu_data	*submenu;
+	struct dbox_data	*dbox;
+	struct dbox_chain_data	*dbox_chain;
+	struct menu_tag_data	*menu_tag;
+
+	while (data->indirection_list != NULL) {
+		indirection = data->indirection_list;
+		data->indirection_list = indirection->next;
+		memory_release(data->memory, indirection);
+	}
+
+	while (data->validation_list != NULL) {
+		validation = data->validation_list;
+		data->validation_list = validation->next;
+		memory_release(data->memory, validation);
+	}
+
+	while (data->submenu_list != NULL) {
+		submenu = data->submenu_list;
+		data->submenu_list = submenu->next;
+		memory_release(data->memory, submenu);
+	}
+
+	while (data->dbox_list != NULL) {
+		dbox = data->dbox_list;
+		data->dbox_list = dbox->next;
+		memory_release(data->memory, dbox);
+	}
+
+	/* The tags in the chain and tag lists point in to the menu and item
+	 * data, so aren't freed separately.
+	 */
+
+	hash_clear(data->dbox_chain_index);
+
+	while (data->dbox_chain_list != NULL) {
+		dbox_chain = data->dbox_chain_list;
+		data->dbox_chain_list = dbox_chain->next;
+		memory_release(data->memory, dbox_chain);
+	}
+
+	while (data->menu_tag_list != NULL) {
+		menu_tag = data->menu_tag_list;
+		data->menu_tag_list = menu_tag->next;
+		memory_release(data->memory, menu_tag);
+	}
+
+	/* Unlink the chains which were threaded through the menus, and clear
+	 * the indirection flags and file offsets, as the titles and text may
+	 * not be indirected, or even the same length, next time around. This
+	 * covers every menu, not just those in the selected shard.
+	 */
+
+	for (menu = data->defined_list; menu != NULL; menu = menu->next_defined) {
+		menu->first_submenu = NULL_OFFSET;
+		menu->file_offset = NULL_OFFSET;
+
+		for (item = menu->first_item; item != NULL; item = item->next) {
+			item->menu_flags &= ~wimp_MENU_TITLE_INDIRECTED;
+			item->icon_flags &= ~wimp_ICON_INDIRECTED;
+
+			item->submenu = NULL;
+			item->dbox = NULL;
+			item->next_submenu = NULL_OFFSET;
+			item->file_offset = NULL_OFFSET;
+		}
+	}
+
+	data->dbox_offset = NULL_OFFSET;
+
+	data->longest_indirection = 0;
+	data->longest_validation = 0;
+	data->longest_dbox_chain = 0;
+	data->longest_menu_tag = 0;
+
+	data->extended_head = false;
+	data->relocate = false;
+	data->base = 0;
+	data->compact = false;
+	data->relocations = 0;
+
+	data->menus_offset = 0;
+	data->indirection_offset = 0;
+	data->validation_offset = 0;
+	data->dbox_chain_offset = 0;
+	data->menu_tag_offset = 0;
+	data->file_length = 0;
+}
 
 /**
  * Go through the assembled menu structures, filling in the missing data and
- * getting the contents ready to write out the menu block.
+ * getting the contents ready to write out the menu block. The structures
+ * can be collated again with different options, in which case the results
+ * of the previous collation are discarded first.
  *
+ * \param *data		The data block to use.
  * \param embed_tag	True if menu tags should be embedded; else False.
  * \param embed_dbox	True if dialogue box names should be embeded; else False.
+ * \param relocate	True if the file should be relocated to a fixed
+ *			address; else False.
+ * \param base		The address to relocate the file to.
+ * \param compact	True if the file should use the compact format; else
+ *			False.
  * \param verbose	True if verbose output is required; else False.
  * \return		True if collation completed successfully; else False.
  */
 
-bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
+bool data_collate_structures(struct data_block *data, bool embed_tag, bool embed_dbox, bool relocate, unsigned base, bool compact, bool verbose)
 {
 	struct menu_definition	*menu;
 	struct item_definition	*item;
@@ -195,9 +527,11 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 	struct menu_tag_data	*menu_tag;
 	int			width, offset, item_offset, chain;
 
-	if (menu_list == NULL)
+	if (data->menu_list == NULL)
 		return false;
 
+	data_discard_collation(data);
+
 	/**
 	 * Start by filling in the menu and items blocks, and collecting
 	 * together preliminary details of where indirected data, validation
@@ -206,11 +540,22 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 
 	offset = sizeof(struct file_head_block);
 
-	if (embed_tag) {
+	data->extended_head = (embed_tag || relocate || compact) ? true : false;
+	data->relocate = relocate;
+	data->base = base;
+	data->compact = compact;
+
+	if (data->extended_head) {
 		offset += sizeof(struct file_extended_head_block);
 	}
 
-	menu = menu_list;
+	if (relocate) {
+		offset += sizeof(struct file_relocation_head_block);
+	}
+
+	data->menus_offset = offset;
+
+	menu = data->menu_list;
 
 	while (menu != NULL) {
 		item = menu->first_item;
@@ -218,19 +563,29 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 		/* Create a dummy menu item if there isn't one. */
 
 		if (item == NULL) {
-			item = (struct item_definition *) malloc(sizeof(struct item_definition));
+			item = memory_claim(data->memory, MEMORY_ITEMS, sizeof(struct item_definition));
 
 			if (item != NULL) {
-				item->text = (char *) malloc(1);
+				item->text = memory_claim(data->memory, MEMORY_STRINGS, 1);
 
 				if (item->text == NULL) {
-					free(item);
+					memory_release(data->memory, item);
 					item = NULL;
 				} else {
 					*(item->text) = '\0';
 					item->validation = NULL;
 					item->text_len = 0;
 
+					item->source_text = item->text;
+					item->source_validation = NULL;
+					item->indirection = -1;
+
+					item->encoded_text = NULL;
+					item->encoded_validation = NULL;
+
+					item->line = menu->line;
+					item->column = menu->column;
+
 					item->file_offset = NULL_OFFSET;
 
 					item->menu_flags = 0;
@@ -238,6 +593,8 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 
 					*(item->submenu_tag) = '\0';
 					item->submenu_dbox = false;
+					item->submenu_line = 0;
+					item->submenu_column = 0;
 
 					item->submenu = NULL;
 					item->dbox = NULL;
@@ -260,16 +617,23 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 		if (menu->title_len > 0 && item != NULL) {
 			item->menu_flags |= wimp_MENU_TITLE_INDIRECTED;
 
-			indirection = (struct indirection_data *) malloc(sizeof(struct indirection_data));
+			indirection = memory_claim(data->memory, MEMORY_SECTIONS, sizeof(struct indirection_data));
 			if (indirection != NULL) {
 				indirection->menu = menu;
 				indirection->item = NULL;
-				indirection->next = indirection_list;
-				indirection_list = indirection;
+				indirection->next = data->indirection_list;
+				data->indirection_list = indirection;
 			}
 		}
 
-		/* Calculate an offset for the menu block in the file. */
+		/* Calculate an offset for the menu block in the file. Compact
+		 * files leave out the next and submenu words, so the offset
+		 * is taken from where they would have been, leaving the Wimp
+		 * menu block and items in their usual places.
+		 */
+
+		if (compact)
+			offset -= 8;
 
 		menu->file_offset = offset;
 
@@ -279,7 +643,7 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 		/* Create an entry in the embedded menu tags if applicable. */
 
 		if (embed_tag) {
-			menu_tag = malloc(sizeof(struct menu_tag_data));
+			menu_tag = memory_claim(data->memory, MEMORY_SECTIONS, sizeof(struct menu_tag_data));
 			
 			if (menu_tag != NULL) {
 				menu_tag->tag = menu->tag;
@@ -287,8 +651,8 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 				menu_tag->file_offset = 0;
 				menu_tag->block_length = 0;
 
-				menu_tag->next = menu_tag_list;
-				menu_tag_list = menu_tag;
+				menu_tag->next = data->menu_tag_list;
+				data->menu_tag_list = menu_tag;
 			}
 		}
 
@@ -317,33 +681,41 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 
 			if (*(item->submenu_tag) != '\0') {
 				if (item->submenu_dbox) {
-					dbox = (struct dbox_data *) malloc(sizeof(struct dbox_data));
-					item->dbox = data_find_dbox_chain_from_tag(item->submenu_tag);
+					dbox = memory_claim(data->memory, MEMORY_SECTIONS, sizeof(struct dbox_data));
+					item->dbox = data_find_dbox_chain_from_tag(data, item->submenu_tag);
 					if (dbox != NULL) {
 						dbox->item = item;
-						dbox->next = dbox_list;
-						dbox_list = dbox;
+						dbox->next = data->dbox_list;
+						data->dbox_list = dbox;
 
 						if (item->dbox == NULL) {
-							item->dbox = (struct dbox_chain_data *) malloc(sizeof(struct dbox_chain_data));
+							item->dbox = memory_claim(data->memory, MEMORY_SECTIONS, sizeof(struct dbox_chain_data));
 							if (item->dbox != NULL) {
 								(item->dbox)->tag = item->submenu_tag; /* Point to the data in the item block. */
 								(item->dbox)->first_dbox = NULL_OFFSET;
 								(item->dbox)->file_offset = 0;
 								(item->dbox)->block_length = 0;
 
-								(item->dbox)->next = dbox_chain_list;
-								dbox_chain_list = item->dbox;
+								(item->dbox)->next = data->dbox_chain_list;
+								data->dbox_chain_list = item->dbox;
+
+								hash_insert(data->dbox_chain_index, (item->dbox)->tag, item->dbox);
 							}
 						}
 					}
 				} else {
-					submenu = (struct submenu_data *) malloc(sizeof(struct submenu_data));
-					item->submenu = data_find_menu_from_tag(item->submenu_tag);
+					submenu = memory_claim(data->memory, MEMORY_SECTIONS, sizeof(struct submenu_data));
+					item->submenu = data_find_menu_from_tag(data, item->submenu_tag);
+
+					/* Links to other shards go in the manifest instead. */
+
+					if (data_find_shard_link(data, item) != NULL)
+						item->submenu = NULL;
+
 					if (submenu != NULL) {
 						submenu->item = item;
-						submenu->next = submenu_list;
-						submenu_list = submenu;
+						submenu->next = data->submenu_list;
+						data->submenu_list = submenu;
 					}
 				}
 			}
@@ -353,21 +725,21 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 			if (item->text_len > 0) {
 				item->icon_flags |= wimp_ICON_INDIRECTED;
 
-				indirection = (struct indirection_data *) malloc(sizeof(struct indirection_data));
+				indirection = memory_claim(data->memory, MEMORY_SECTIONS, sizeof(struct indirection_data));
 				if (indirection != NULL) {
 					indirection->menu = NULL;
 					indirection->item = item;
-					indirection->next = indirection_list;
-					indirection_list = indirection;
+					indirection->next = data->indirection_list;
+					data->indirection_list = indirection;
 				}
 
 				if (item->validation != NULL) {
-					validation = (struct validation_data *) malloc(sizeof(struct validation_data));
+					validation = memory_claim(data->memory, MEMORY_SECTIONS, sizeof(struct validation_data));
 					if (validation != NULL) {
 						validation->item = item;
 						validation->string_len = strlen(item->validation) + 1;
-						validation->next = validation_list;
-						validation_list = validation;
+						validation->next = data->validation_list;
+						data->validation_list = validation;
 					}
 				}
 			}
@@ -386,31 +758,33 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 	}
 
 	/**
-	 * Link up the submenu chains.
+	 * Compact files have no submenu or dialogue box chains, and lay out
+	 * the sections which follow the menus in their own way.
+	 */
+
+	if (compact)
+		return data_collate_compact(data, embed_tag, embed_dbox, offset);
+
+	/**
+	 * Link up the submenu chains, in a single pass over the submenu
+	 * list: each item is pushed on to the front of its target menu's
+	 * chain, so the chains end up in the reverse order of the list.
 	 *
 	 * The dialogue box chain(s) are left un-linked for now, as the
 	 * structure will depend on the final file format.
 	 */
 
-	menu = menu_list;
-
-	while (menu != NULL) {
-		submenu = submenu_list;
-		chain = NULL_OFFSET;
+	submenu = data->submenu_list;
 
-		while (submenu != NULL) {
-			if ((submenu->item)->submenu == menu) {
-				(submenu->item)->next_submenu = chain;
-				chain = (submenu->item)->file_offset + 4;
-			}
+	while (submenu != NULL) {
+		COUNTER_ADD(data->counters, SUBMENU_LINK_STEPS, 1);
 
-			submenu = submenu->next;
+		if ((submenu->item)->submenu != NULL) {
+			(submenu->item)->next_submenu = ((submenu->item)->submenu)->first_submenu;
+			((submenu->item)->submenu)->first_submenu = (submenu->item)->file_offset + 4;
 		}
 
-		if (chain != NULL_OFFSET)
-			menu->first_submenu = chain;
-
-		menu = menu->next;
+		submenu = submenu->next;
 	}
 
 	/**
@@ -418,25 +792,17 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 	 */
 
 	if (embed_dbox) {
-		dbox_chain = dbox_chain_list;
-
-		while (dbox_chain != NULL) {
-			dbox = dbox_list;
-			chain = NULL_OFFSET;
+		dbox = data->dbox_list;
 
-			while (dbox != NULL) {
-				if ((dbox->item)->dbox == dbox_chain) {
-					(dbox->item)->next_submenu = chain;
-					chain = (dbox->item)->file_offset + 4;
-				}
+		while (dbox != NULL) {
+			COUNTER_ADD(data->counters, DBOX_LINK_STEPS, 1);
 
-				dbox = dbox->next;
+			if ((dbox->item)->dbox != NULL) {
+				(dbox->item)->next_submenu = ((dbox->item)->dbox)->first_dbox;
+				((dbox->item)->dbox)->first_dbox = (dbox->item)->file_offset + 4;
 			}
 
-			if (chain != NULL_OFFSET)
-				dbox_chain->first_dbox = chain;
-
-			dbox_chain = dbox_chain->next;
+			dbox = dbox->next;
 		}
 	} else {
 		/**
@@ -445,7 +811,7 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 		 * the older BASIC versions of MenuGen.
 	 	*/
 
-		dbox = dbox_list;
+		dbox = data->dbox_list;
 		chain = NULL_OFFSET;
 
 		while (dbox != NULL) {
@@ -456,7 +822,7 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 		}
 
 		if (chain != NULL_OFFSET) {
-			dbox_offset = chain;
+			data->dbox_offset = chain;
 		}
 	}
 
@@ -465,7 +831,9 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 	 * to follow it.
 	 */
 
-	indirection = indirection_list;
+	data->indirection_offset = offset;
+
+	indirection = data->indirection_list;
 
 	while (indirection != NULL) {
 		if (indirection->menu != NULL) {
@@ -482,20 +850,22 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 			offset += indirection->block_length;
 		}
 
-		if (indirection->block_length > longest_indirection)
-			longest_indirection = indirection->block_length;
+		if (indirection->block_length > data->longest_indirection)
+			data->longest_indirection = indirection->block_length;
 
 		indirection = indirection->next;
 	}
 
-	if (indirection_list != NULL)
+	if (data->indirection_list != NULL)
 		offset += 4;
 
 	/**
 	 * Next, build up the validation string data block to follow that.
 	 */
 
-	validation = validation_list;
+	data->validation_offset = offset;
+
+	validation = data->validation_list;
 
 	while (validation != NULL) {
 		if (validation->item != NULL) {
@@ -506,13 +876,13 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 			offset += validation->block_length;
 		}
 
-		if (validation->block_length > longest_validation)
-			longest_validation = validation->block_length;
+		if (validation->block_length > data->longest_validation)
+			data->longest_validation = validation->block_length;
 
 		validation = validation->next;
 	}
 
-	if (validation_list != NULL)
+	if (data->validation_list != NULL)
 		offset += 4;
 
 	/**
@@ -520,10 +890,13 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 	 * embedded list of tag names.
 	 */
 
+	data->dbox_chain_offset = offset;
+
 	if (embed_dbox) {
-		dbox_chain = dbox_chain_list;
+		dbox_chain = data->dbox_chain_list;
 
-		offset+= 4; /* Allow space for a 0 word at the head of the list. */
+		if (data->dbox_chain_list != NULL)
+			offset+= 4; /* Allow space for a 0 word at the head of the list. */
 
 		while (dbox_chain != NULL) {
 			dbox_chain->file_offset = offset;
@@ -531,19 +904,20 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 
 			offset += dbox_chain->block_length;
 
-			if (dbox_chain->block_length > longest_dbox_chain)
-				longest_dbox_chain = dbox_chain->block_length;
+			if (dbox_chain->block_length > data->longest_dbox_chain)
+				data->longest_dbox_chain = dbox_chain->block_length;
 
 			dbox_chain = dbox_chain->next;
 		}
 
-		if (dbox_chain_list != NULL)
+		if (data->dbox_chain_list != NULL)
 			offset += 4;
 	}
 
+	data->menu_tag_offset = offset;
 
 	if (embed_tag) {
-		menu_tag = menu_tag_list;
+		menu_tag = data->menu_tag_list;
 
 		while (menu_tag != NULL) {
 			menu_tag->file_offset = offset;
@@ -551,567 +925,1935 @@ bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose)
 
 			offset += menu_tag->block_length;
 
-			if (menu_tag->block_length > longest_menu_tag)
-				longest_menu_tag = menu_tag->block_length;
+			if (menu_tag->block_length > data->longest_menu_tag)
+				data->longest_menu_tag = menu_tag->block_length;
 
 			menu_tag = menu_tag->next;
 		}
 
 		/* Include space for terminating -1. */
 
-		if (menu_tag_list != NULL)
+		if (data->menu_tag_list != NULL)
 			offset += 4;
 	}
 
+	/* Record the final size, so that the file can be built in one go. */
 
-	return true;
-}
-
-
-/**
- * Return the menu block corresponding to the given tag.
- *
- * Param:  *tag		The tag to find a block for.
- * Return:		A pointer to the menu block; or NULL if not found.
- */
-
-struct menu_definition *data_find_menu_from_tag(char *tag)
-{
-	struct menu_definition	*menu;
-
-	menu = menu_list;
-
-	while (menu != NULL && strcmp(tag, menu->tag) != 0)
-		menu = menu->next;
-
-	return menu;
-}
-
-/**
- * Return the dbox chain block corresponding to the given tag.
- *
- * Param:  *tag		The tag to find a block for.
- * Return:		A pointer to the dbox chain block; or NULL if not found.
- */
-
-struct dbox_chain_data		*data_find_dbox_chain_from_tag(char *tag)
-{
-	struct dbox_chain_data	*dbox_chain;
-
-	dbox_chain = dbox_chain_list;
-
-	while (dbox_chain != NULL && strcmp(tag, dbox_chain->tag) != 0)
-		dbox_chain = dbox_chain->next;
+	data->file_length = offset;
 
-	return dbox_chain;
+	return true;
 }
 
 
 /**
- * Print details of the menu structures to stdout.
+ * Lay out the sections which follow the menus in a compact format file:
+ * the relocation table, the string pool, and the dialogue box and menu
+ * tables.
  *
+ * Param:  *data	The data block to use.
+ * Param:  embed_tag	True if menu tags should be embedded; else False.
+ * Param:  embed_dbox	True if dialogue box names should be embeded; else False.
+ * Param:  offset	The offset of the end of the menus.
+ * Return:		True if collation completed successfully; else False.
  */
 
-void data_print_structure_report(void)
+static bool data_collate_compact(struct data_block *data, bool embed_tag, bool embed_dbox, int offset)
 {
-	struct menu_definition	*menu;
-	struct item_definition	*item;
 	struct indirection_data	*indirection;
-	struct validation_data	*validation;
-	struct submenu_data	*submenu;
-	struct dbox_data	*dbox;
+	struct validation_data	*validation, *match;
 	struct dbox_chain_data	*dbox_chain;
 	struct menu_tag_data	*menu_tag;
+	struct hash_table	*strings;
+	int			dialogues;
 
-	/* Print the contents of the menu structures. */
+	strings = hash_create(data->memory, NULL);
+	if (strings == NULL)
+		return false;
 
-	menu = menu_list;
+	/**
+	 * The relocation table lists every pointer in the menus, in the
+	 * order in which they appear in the file. The statistics see it
+	 * as the indirected data, and the string pool as the validation
+	 * strings.
+	 */
 
-	if (menu != NULL) {
-		printf("================================================================================\n");
-		printf("Menu Blocks\n");
-		printf("--------------------------------------------------------------------------------\n");
-	}
+	data->indirection_offset = offset;
 
-	while (menu != NULL) {
-		printf("Menu tag:             %s\n", menu->tag);
-		printf("Title:                %s\n", menu->title);
-		printf("Indirected:           %s\n", data_boolean_yes_no(menu->title_len > 0));
-		if (menu->title_len > 0)
-			printf("Indirected length:    %d bytes\n", menu->title_len);
-		printf("Reversed:             %s\n", data_boolean_yes_no(menu->reversed));
-		printf("Item width:           %d OS units\n", menu->item_width);
-		printf("Item height:          %d OS units\n", menu->item_height);
-		printf("Item gap:             %d OS units\n", menu->item_gap);
-		printf("Title foreground:     Colour %d\n", menu->title_foreground);
-		printf("Title background:     Colour %d\n", menu->title_background);
-		printf("Work Area foreground: Colour %d\n", menu->work_area_foreground);
-		printf("Work Area foreground: Colour %d\n", menu->work_area_background);
-		printf("File block offset:    %d bytes\n", menu->file_offset);
-		printf("Items:                %d\n", menu->items);
+	offset += sizeof(struct file_compact_relocation_block) + ((data_build_relocation_table(data, NULL, &(data->relocations)) + 3) & (~3));
 
-		item = menu->first_item;
+	/**
+	 * The string pool holds the indirected text buffers, followed by
+	 * the validation strings with any duplicates sharing a copy, and
+	 * then the names of the dialogue boxes and menus.
+	 */
 
-		while (item != NULL) {
-			printf("  ------------------------------------------------------------------------------\n");
-			printf("  Item text:          %s\n", item->text);
-			printf("  Indirected:         %s\n", data_boolean_yes_no(item->text_len > 0));
-			if (item->text_len > 0)
-				printf("  Indirected length:  %d bytes\n", item->text_len);
-			if (item->validation != NULL)
-				printf("  Validation string:  %s\n", item->validation);
-			if (*(item->submenu_tag) != '\0') {
-				if (item->submenu_dbox) {
-					printf ("  Dialogue box:       %s\n", item->submenu_tag);
-				} else {
-					printf ("  Submenu:            %s (%s)\n", item->submenu_tag, (item->submenu)->title);
-				}
-			}
-			printf("  Ticked:             %s\n", data_boolean_yes_no(item->menu_flags & wimp_MENU_TICKED));
-			printf("  Dotted:             %s\n", data_boolean_yes_no(item->menu_flags & wimp_MENU_SEPARATE));
-			printf("  Shaded:             %s\n", data_boolean_yes_no(item->icon_flags & wimp_ICON_SHADED));
-			printf("  Writable:           %s\n", data_boolean_yes_no(item->menu_flags & wimp_MENU_WRITABLE));
-			printf("  Sprite:             %s\n", data_boolean_yes_no(item->icon_flags & wimp_ICON_SPRITE));
-			if (item->icon_flags & wimp_ICON_SPRITE)
-				printf("  Half size:          %s\n", data_boolean_yes_no(item->menu_flags & wimp_ICON_HALF_SIZE));
-			printf("  Submenu message:    %s\n", data_boolean_yes_no(item->menu_flags & wimp_MENU_GIVE_WARNING));
-			printf("  Always open:        %s\n", data_boolean_yes_no(item->menu_flags & wimp_MENU_SUB_MENU_WHEN_SHADED));
-			printf("  Item foreground:    Colour %d\n", item->icon_foreground);
-			printf("  Item background:    Colour %d\n", item->icon_background);
-			printf("  File block offset:  %d bytes\n", item->file_offset);
+	data->validation_offset = offset;
 
-			item = item->next;
+	for (indirection = data->indirection_list; indirection != NULL; indirection = indirection->next) {
+		if (indirection->menu != NULL) {
+			indirection->block_length = (indirection->menu)->title_len;
+			indirection->target = (indirection->menu)->file_offset + 8;
+		} else if (indirection->item != NULL) {
+			indirection->block_length = (indirection->item)->text_len;
+			indirection->target = (indirection->item)->file_offset + 12;
 		}
 
-		printf("--------------------------------------------------------------------------------\n");
+		indirection->file_offset = offset;
+		offset += indirection->block_length;
 
-		menu = menu->next;
+		if (indirection->block_length > data->longest_indirection)
+			data->longest_indirection = indirection->block_length;
 	}
 
-	/* Print out the list of submenu links. */
+	for (validation = data->validation_list; validation != NULL; validation = validation->next) {
+		validation->target = (validation->item)->file_offset + 16;
 
-	submenu = submenu_list;
+		match = hash_find(strings, (validation->item)->validation);
 
-	if (submenu != NULL) {
-		printf("================================================================================\n");
-		printf("Submenu References\n");
-		printf("--------------------------------------------------------------------------------\n");
-	}
+		if (match != NULL) {
+			validation->file_offset = match->file_offset;
+			validation->block_length = 0;
+		} else {
+			validation->file_offset = offset;
+			validation->block_length = validation->string_len;
+			offset += validation->block_length;
 
-	while (submenu != NULL) {
-		if (submenu->item != NULL) {
-			printf("Item text:            %s\n", (submenu->item)->text);
-			printf("Submenu tag:          %s\n", (submenu->item)->submenu_tag);
+			hash_insert(strings, (validation->item)->validation, validation);
 		}
 
-		printf("--------------------------------------------------------------------------------\n");
-
-		submenu = submenu->next;
+		if (validation->block_length > data->longest_validation)
+			data->longest_validation = validation->block_length;
 	}
 
-	/* Print the contents of the menu tag chain. */
+	hash_destroy(strings);
 
-	menu_tag = menu_tag_list;
+	/* A non-zero file offset marks the dialogue box names as embedded. */
 
-	if (menu_tag != NULL) {
-		printf("================================================================================\n");
-		printf("Menu Tag List\n");
-		printf("--------------------------------------------------------------------------------\n");
+	if (embed_dbox) {
+		for (dbox_chain = data->dbox_chain_list; dbox_chain != NULL; dbox_chain = dbox_chain->next) {
+			dbox_chain->file_offset = offset;
+			offset += strlen(dbox_chain->tag) + 1;
+		}
 	}
 
-	while (menu_tag != NULL) {
-		printf("Menu tag:             %s\n", menu_tag->tag);
-		printf("Target offset:        %d bytes\n", menu_tag->menu_offset);
-		printf("Block Length in file: %d bytes\n", menu_tag->block_length);
-		printf("File block offset:    %d bytes\n", menu_tag->file_offset);
-
-		printf("--------------------------------------------------------------------------------\n");
+	if (embed_tag) {
+		for (menu_tag = data->menu_tag_list; menu_tag != NULL; menu_tag = menu_tag->next) {
+			menu_tag->file_offset = offset;
+			menu_tag->block_length = strlen(menu_tag->tag) + 1;
+			offset += menu_tag->block_length;
 
-		menu_tag = menu_tag->next;
+			if (menu_tag->block_length > data->longest_menu_tag)
+				data->longest_menu_tag = menu_tag->block_length;
+		}
 	}
 
-	/* Print the contents of the dialogue box chain. */
+	offset = (offset + 3) & (~3);
 
-	dbox_chain = dbox_chain_list;
+	/**
+	 * The dialogue box table has a chain for each dialogue box if the
+	 * names are embedded, or a single chain of every item if not. The
+	 * position of each chain is held in its first_dbox field.
+	 */
 
-	if (dbox_chain != NULL) {
-		printf("================================================================================\n");
-		printf("Dialogue Box Chain\n");
-		printf("--------------------------------------------------------------------------------\n");
-	}
+	data->dbox_chain_offset = offset;
 
-	while (dbox_chain != NULL) {
-		printf("Box tag:              %s\n", dbox_chain->tag);
-		printf("First target offset:  %d bytes\n", dbox_chain->first_dbox);
-		printf("Block Length in file: %d bytes\n", dbox_chain->block_length);
-		printf("File block offset:    %d bytes\n", dbox_chain->file_offset);
+	if (data->dbox_list != NULL)
+		offset += sizeof(struct file_compact_dialogue_block);
 
-		printf("--------------------------------------------------------------------------------\n");
+	if (data->dbox_list != NULL && embed_dbox) {
+		for (dbox_chain = data->dbox_chain_list; dbox_chain != NULL; dbox_chain = dbox_chain->next) {
+			dbox_chain->first_dbox = offset;
+			dbox_chain->block_length = sizeof(struct file_compact_chain_block) + ((data_build_dialogue_chain(data, dbox_chain, NULL, &dialogues) + 3) & (~3));
+			offset += dbox_chain->block_length;
 
-		dbox_chain = dbox_chain->next;
+			if (dbox_chain->block_length > data->longest_dbox_chain)
+				data->longest_dbox_chain = dbox_chain->block_length;
+		}
+	} else if (data->dbox_list != NULL) {
+		offset += sizeof(struct file_compact_chain_block) + ((data_build_dialogue_chain(data, NULL, NULL, &dialogues) + 3) & (~3));
 	}
 
-	/* Print out the list of dbox linls. */
+	/* The menu table holds an offset for each menu. */
 
-	dbox = dbox_list;
+	data->menu_tag_offset = offset;
 
-	if (dbox != NULL) {
-		printf("================================================================================\n");
-		printf("Dialogue Box References\n");
-		printf("--------------------------------------------------------------------------------\n");
+	if (data->menu_tag_list != NULL) {
+		offset += sizeof(struct file_compact_tag_block);
+
+		for (menu_tag = data->menu_tag_list; menu_tag != NULL; menu_tag = menu_tag->next)
+			offset += sizeof(int);
 	}
 
-	while (dbox != NULL) {
-		if (dbox->item != NULL) {
-			printf("Item text:            %s\n", (dbox->item)->text);
-			printf("DBox tag:             %s\n", (dbox->item)->submenu_tag);
-		}
+	/* Record the final size, so that the file can be built in one go. */
 
-		printf("--------------------------------------------------------------------------------\n");
+	data->file_length = offset;
 
-		dbox = dbox->next;
-	}
+	return true;
+}
 
-	/* Print the indirection blocks. */
 
-	indirection = indirection_list;
+/**
+ * Build the relocation table for a compact format file, listing every word
+ * in the menus which holds an offset, in ascending order.
+ *
+ * Param:  *data		The data block to use.
+ * Param:  *buffer		Pointer to a buffer to take the encoded table,
+ *				or NULL to just find its size.
+ * Param:  *relocations		Pointer to a variable to take the number of
+ *				entries in the table.
+ * Return:			The length of the encoded table, in bytes.
+ */
 
-	if (indirection != NULL) {
-		printf("================================================================================\n");
-		printf("Indirected Data Blocks\n");
-		printf("--------------------------------------------------------------------------------\n");
-	}
+static int data_build_relocation_table(struct data_block *data, unsigned char *buffer, int *relocations)
+{
+	struct menu_definition	*menu;
+	struct item_definition	*item;
+	int			length = 0, previous = 0;
 
-	while (indirection != NULL) {
-		if (indirection->menu != NULL) {
-			printf("Menu title:           %s\n", (indirection->menu)->title);
-			printf("Maximum length:       %d bytes\n", (indirection->menu)->title_len);
-		} else if (indirection->item != NULL) {
-			printf("Item text:            %s\n", (indirection->item)->text);
-			printf("Maximum length:       %d bytes\n", (indirection->item)->text_len);
+	*relocations = 0;
+
+	for (menu = data->menu_list; menu != NULL; menu = menu->next) {
+		if (menu->title_len > 0) {
+			length = data_encode_compact_offset(buffer, length, menu->file_offset + 8, &previous);
+			(*relocations)++;
 		}
 
-		printf("Target offset:        %d bytes\n", indirection->target);
-		printf("Block Length in file: %d bytes\n", indirection->block_length);
-		printf("File block offset:    %d bytes\n", indirection->file_offset);
+		for (item = menu->first_item; item != NULL; item = item->next) {
+			if (item->submenu != NULL) {
+				length = data_encode_compact_offset(buffer, length, item->file_offset + 4, &previous);
+				(*relocations)++;
+			}
 
-		printf("--------------------------------------------------------------------------------\n");
+			if (item->text_len > 0) {
+				length = data_encode_compact_offset(buffer, length, item->file_offset + 12, &previous);
+				(*relocations)++;
+			}
 
-		indirection = indirection->next;
+			if (item->text_len > 0 && item->validation != NULL) {
+				length = data_encode_compact_offset(buffer, length, item->file_offset + 16, &previous);
+				(*relocations)++;
+			}
+		}
 	}
 
-	/* Print the validation blocks. */
+	return length;
+}
 
-	validation = validation_list;
+
+/**
+ * Build a dialogue box chain for a compact format file, listing the
+ * submenu words of the items which open the dialogue box in ascending
+ * order, which is also the order in which they were defined.
+ *
+ * Param:  *data		The data block to use.
+ * Param:  *dbox_chain		The dialogue box to build the chain for, or
+ *				NULL to include every item which opens one.
+ * Param:  *buffer		Pointer to a buffer to take the encoded chain,
+ *				or NULL to just find its size.
+ * Param:  *dialogues		Pointer to a variable to take the number of
+ *				entries in the chain.
+ * Return:			The length of the encoded chain, in bytes.
+ */
+
+static int data_build_dialogue_chain(struct data_block *data, struct dbox_chain_data *dbox_chain, unsigned char *buffer, int *dialogues)
+{
+	struct menu_definition	*menu;
+	struct item_definition	*item;
+	int			length = 0, previous = 0;
+
+	*dialogues = 0;
+
+	for (menu = data->menu_list; menu != NULL; menu = menu->next) {
+		for (item = menu->first_item; item != NULL; item = item->next) {
+			if (*(item->submenu_tag) == '\0' || !item->submenu_dbox || item->dbox == NULL)
+				continue;
+
+			if (dbox_chain != NULL && item->dbox != dbox_chain)
+				continue;
+
+			length = data_encode_compact_offset(buffer, length, item->file_offset + 4, &previous);
+			(*dialogues)++;
+		}
+	}
+
+	return length;
+}
+
+
+/**
+ * Encode the offset of a word into a compact format file's relocation table
+ * or dialogue box chain, as the number of words since the previous entry.
+ *
+ * Param:  *buffer		Pointer to the buffer holding the table, or NULL
+ *				to just find the length of the encoding.
+ * Param:  length		The length of the table so far.
+ * Param:  offset		The offset of the word to add to the table.
+ * Param:  *previous		Pointer to the offset of the previous entry,
+ *				which is updated to the new one.
+ * Return:			The length of the table with the new entry.
+ */
+
+static int data_encode_compact_offset(unsigned char *buffer, int length, int offset, int *previous)
+{
+	unsigned	words;
+
+	words = (offset - *previous) / 4;
+	*previous = offset;
+
+	do {
+		if (buffer != NULL)
+			buffer[length] = (words & 0x7f) | ((words > 0x7f) ? 0x80 : 0);
+
+		length++;
+		words >>= 7;
+	} while (words != 0);
+
+	return length;
+}
+
+
+/**
+ * Check the references between the menu structures, reporting any menu
+ * tags which are defined more than once and any submenus which refer to
+ * menus which don't exist.
+ *
+ * \param *data		The data block to use.
+ * \return		True if the references are all valid; else False.
+ */
+
+bool data_check_references(struct data_block *data)
+{
+	struct menu_definition	*menu, *match;
+	struct item_definition	*item;
+	bool			success = true;
+
+	menu = data->menu_list;
+
+	while (menu != NULL) {
+		match = data_find_menu_from_tag(data, menu->tag);
+
+		if (match != menu) {
+			report_error(data->report, REPORT_CHECK, menu->line, menu->column, "Duplicate menu '%s' (first defined at line %d)", menu->tag, match->line);
+			success = false;
+		}
+
+		item = menu->first_item;
+
+		while (item != NULL) {
+			if (*(item->submenu_tag) != '\0' && !item->submenu_dbox && data_find_menu_from_tag(data, item->submenu_tag) == NULL) {
+				report_error(data->report, REPORT_CHECK, item->submenu_line, item->submenu_column, "Undefined submenu '%s'", item->submenu_tag);
+				success = false;
+			}
+
+			item = item->next;
+		}
+
+		menu = menu->next;
+	}
+
+	return success;
+}
+
+/**
+ * Set the text of the menu titles and items for a locale, replacing any
+ * message tokens with the text from a Messages file, transcoding it into
+ * the target encoding and recalculating the indirected buffer sizes to
+ * suit. Text starting with @ is a token, optionally followed by a colon
+ * and a default to use if the token isn't found; text starting with @@ is
+ * a literal @. Without any messages, the text from the source is used.
+ *
+ * \param *data		The data block to localise.
+ * \param *messages	The messages to look the tokens up in, or NULL.
+ * \param encoding	The encoding to transcode the text into.
+ * \return		True if all of the text was resolved; else False.
+ */
+
+bool data_localise(struct data_block *data, struct messages_block *messages, enum encoding_target encoding)
+{
+	struct menu_definition	*menu;
+	struct item_definition	*item;
+	bool			success = true;
+
+	for (menu = data->menu_list; menu != NULL; menu = menu->next) {
+		if (!data_resolve_text(data, messages, menu->source_title, &(menu->title), menu->line, menu->column))
+			success = false;
+
+		if (!data_encode_text(data, encoding, &(menu->encoded_title), &(menu->title), menu->line, menu->column))
+			success = false;
+
+		menu->title_len = data_indirected_length(menu->title, menu->indirection);
+
+		for (item = menu->first_item; item != NULL; item = item->next) {
+			if (!data_resolve_text(data, messages, item->source_text, &(item->text), item->line, item->column))
+				success = false;
+
+			if (!data_encode_text(data, encoding, &(item->encoded_text), &(item->text), item->line, item->column))
+				success = false;
+
+			item->text_len = data_indirected_length(item->text, item->indirection);
+
+			item->validation = item->source_validation;
+
+			if (!data_encode_text(data, encoding, &(item->encoded_validation), &(item->validation), item->line, item->column))
+				success = false;
+		}
+	}
+
+	return success;
+}
+
+/**
+ * Return the menu block corresponding to the given tag. If the tag has
+ * been defined more than once, the first definition is returned.
+ *
+ * Param:  *data	The data block to search.
+ * Param:  *tag		The tag to find a block for.
+ * Return:		A pointer to the menu block; or NULL if not found.
+ */
+
+static struct menu_definition *data_find_menu_from_tag(struct data_block *data, char *tag)
+{
+	COUNTER_ADD(data->counters, MENU_TAG_LOOKUPS, 1);
+
+	return hash_find(data->menu_index, tag);
+}
+
+/**
+ * Return the dbox chain block corresponding to the given tag.
+ *
+ * Param:  *data	The data block to search.
+ * Param:  *tag		The tag to find a block for.
+ * Return:		A pointer to the dbox chain block; or NULL if not found.
+ */
+
+static struct dbox_chain_data *data_find_dbox_chain_from_tag(struct data_block *data, char *tag)
+{
+	COUNTER_ADD(data->counters, DBOX_TAG_LOOKUPS, 1);
+
+	return hash_find(data->dbox_chain_index, tag);
+}
+
+
+/**
+ * Report details of the menu structures, as verbose messages.
+ *
+ * \param *data		The data block to use.
+ */
+
+void data_print_structure_report(struct data_block *data)
+{
+	struct menu_definition	*menu, *shard_link;
+	struct item_definition	*item;
+	struct indirection_data	*indirection;
+	struct validation_data	*validation;
+	struct submenu_data	*submenu;
+	struct dbox_data	*dbox;
+	struct dbox_chain_data	*dbox_chain;
+	struct menu_tag_data	*menu_tag;
+
+	if (!report_wants(data->report, REPORT_LEVEL_VERBOSE, REPORT_STRUCTURE))
+		return;
+
+	/* Print the contents of the menu structures. */
+
+	menu = data->menu_list;
+
+	if (menu != NULL) {
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "================================================================================");
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Menu Blocks");
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "--------------------------------------------------------------------------------");
+	}
+
+	while (menu != NULL) {
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Menu tag:             %s", menu->tag);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Title:                %s", menu->title);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Indirected:           %s", data_boolean_yes_no(menu->title_len > 0));
+		if (menu->title_len > 0)
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "Indirected length:    %d bytes", menu->title_len);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Reversed:             %s", data_boolean_yes_no(menu->reversed));
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Item width:           %d OS units", menu->item_width);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Item height:          %d OS units", menu->item_height);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Item gap:             %d OS units", menu->item_gap);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Title foreground:     Colour %d", menu->title_foreground);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Title background:     Colour %d", menu->title_background);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Work Area foreground: Colour %d", menu->work_area_foreground);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Work Area foreground: Colour %d", menu->work_area_background);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "File block offset:    %d bytes", menu->file_offset);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Items:                %d", menu->items);
+
+		item = menu->first_item;
+
+		while (item != NULL) {
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "  ------------------------------------------------------------------------------");
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "  Item text:          %s", item->text);
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "  Indirected:         %s", data_boolean_yes_no(item->text_len > 0));
+			if (item->text_len > 0)
+				report_verbose(data->report, REPORT_STRUCTURE, 0, "  Indirected length:  %d bytes", item->text_len);
+			if (item->validation != NULL)
+				report_verbose(data->report, REPORT_STRUCTURE, 0, "  Validation string:  %s", item->validation);
+			if (*(item->submenu_tag) != '\0') {
+				if (item->submenu_dbox) {
+					report_verbose(data->report, REPORT_STRUCTURE, 0, "  Dialogue box:       %s", item->submenu_tag);
+				} else if (item->submenu != NULL) {
+					report_verbose(data->report, REPORT_STRUCTURE, 0, "  Submenu:            %s (%s)", item->submenu_tag, (item->submenu)->title);
+				} else {
+					shard_link = data_find_shard_link(data, item);
+					if (shard_link != NULL)
+						report_verbose(data->report, REPORT_STRUCTURE, 0, "  Submenu:            %s (in shard %d)", item->submenu_tag, shard_link->shard);
+				}
+			}
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "  Ticked:             %s", data_boolean_yes_no(item->menu_flags & wimp_MENU_TICKED));
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "  Dotted:             %s", data_boolean_yes_no(item->menu_flags & wimp_MENU_SEPARATE));
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "  Shaded:             %s", data_boolean_yes_no(item->icon_flags & wimp_ICON_SHADED));
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "  Writable:           %s", data_boolean_yes_no(item->menu_flags & wimp_MENU_WRITABLE));
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "  Sprite:             %s", data_boolean_yes_no(item->icon_flags & wimp_ICON_SPRITE));
+			if (item->icon_flags & wimp_ICON_SPRITE)
+				report_verbose(data->report, REPORT_STRUCTURE, 0, "  Half size:          %s", data_boolean_yes_no(item->menu_flags & wimp_ICON_HALF_SIZE));
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "  Submenu message:    %s", data_boolean_yes_no(item->menu_flags & wimp_MENU_GIVE_WARNING));
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "  Always open:        %s", data_boolean_yes_no(item->menu_flags & wimp_MENU_SUB_MENU_WHEN_SHADED));
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "  Item foreground:    Colour %d", item->icon_foreground);
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "  Item background:    Colour %d", item->icon_background);
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "  File block offset:  %d bytes", item->file_offset);
+
+			item = item->next;
+		}
+
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "--------------------------------------------------------------------------------");
+
+		menu = menu->next;
+	}
+
+	/* Print out the list of submenu links. */
+
+	submenu = data->submenu_list;
+
+	if (submenu != NULL) {
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "================================================================================");
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Submenu References");
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "--------------------------------------------------------------------------------");
+	}
+
+	while (submenu != NULL) {
+		if (submenu->item != NULL) {
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "Item text:            %s", (submenu->item)->text);
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "Submenu tag:          %s", (submenu->item)->submenu_tag);
+		}
+
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "--------------------------------------------------------------------------------");
+
+		submenu = submenu->next;
+	}
+
+	/* Print the contents of the menu tag chain. */
+
+	menu_tag = data->menu_tag_list;
+
+	if (menu_tag != NULL) {
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "================================================================================");
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Menu Tag List");
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "--------------------------------------------------------------------------------");
+	}
+
+	while (menu_tag != NULL) {
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Menu tag:             %s", menu_tag->tag);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Target offset:        %d bytes", menu_tag->menu_offset);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Block Length in file: %d bytes", menu_tag->block_length);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "File block offset:    %d bytes", menu_tag->file_offset);
+
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "--------------------------------------------------------------------------------");
+
+		menu_tag = menu_tag->next;
+	}
+
+	/* Print the contents of the dialogue box chain. */
+
+	dbox_chain = data->dbox_chain_list;
+
+	if (dbox_chain != NULL) {
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "================================================================================");
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Dialogue Box Chain");
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "--------------------------------------------------------------------------------");
+	}
+
+	while (dbox_chain != NULL) {
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Box tag:              %s", dbox_chain->tag);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "First target offset:  %d bytes", dbox_chain->first_dbox);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Block Length in file: %d bytes", dbox_chain->block_length);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "File block offset:    %d bytes", dbox_chain->file_offset);
+
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "--------------------------------------------------------------------------------");
+
+		dbox_chain = dbox_chain->next;
+	}
+
+	/* Print out the list of dbox linls. */
+
+	dbox = data->dbox_list;
+
+	if (dbox != NULL) {
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "================================================================================");
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Dialogue Box References");
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "--------------------------------------------------------------------------------");
+	}
+
+	while (dbox != NULL) {
+		if (dbox->item != NULL) {
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "Item text:            %s", (dbox->item)->text);
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "DBox tag:             %s", (dbox->item)->submenu_tag);
+		}
+
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "--------------------------------------------------------------------------------");
+
+		dbox = dbox->next;
+	}
+
+	/* Print the indirection blocks. */
+
+	indirection = data->indirection_list;
+
+	if (indirection != NULL) {
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "================================================================================");
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Indirected Data Blocks");
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "--------------------------------------------------------------------------------");
+	}
+
+	while (indirection != NULL) {
+		if (indirection->menu != NULL) {
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "Menu title:           %s", (indirection->menu)->title);
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "Maximum length:       %d bytes", (indirection->menu)->title_len);
+		} else if (indirection->item != NULL) {
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "Item text:            %s", (indirection->item)->text);
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "Maximum length:       %d bytes", (indirection->item)->text_len);
+		}
+
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Target offset:        %d bytes", indirection->target);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Block Length in file: %d bytes", indirection->block_length);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "File block offset:    %d bytes", indirection->file_offset);
+
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "--------------------------------------------------------------------------------");
+
+		indirection = indirection->next;
+	}
+
+	/* Print the validation blocks. */
+
+	validation = data->validation_list;
 
 	if (validation != NULL) {
-		printf("================================================================================\n");
-		printf("Validation Strings\n");
-		printf("--------------------------------------------------------------------------------\n");
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "================================================================================");
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Validation Strings");
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "--------------------------------------------------------------------------------");
+	}
+
+	while (validation != NULL) {
+		if (validation->item != NULL) {
+			report_verbose(data->report, REPORT_STRUCTURE, 0, "Validation string:    %s", (validation->item)->validation);
+		}
+
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "String length:        %d bytes", validation->string_len);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Target offset:        %d bytes", validation->target);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "Block Length in file: %d bytes", validation->block_length);
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "File block offset:    %d bytes", validation->file_offset);
+
+		report_verbose(data->report, REPORT_STRUCTURE, 0, "--------------------------------------------------------------------------------");
+
+		validation = validation->next;
+	}
+
+	report_verbose(data->report, REPORT_STRUCTURE, 0, "================================================================================");
+}
+
+/**
+ * Collect statistics about the menus in a data block. The section sizes
+ * are only valid once the structures have been collated.
+ *
+ * \param *data		The data block to use.
+ * \param *statistics	Pointer to a block to take the statistics.
+ */
+
+void data_get_statistics(struct data_block *data, struct data_statistics *statistics)
+{
+	struct menu_definition	*menu;
+	struct item_definition	*item;
+
+	if (data == NULL || statistics == NULL)
+		return;
+
+	statistics->menus = 0;
+	statistics->items = 0;
+	statistics->indirected = 0;
+	statistics->validations = 0;
+	statistics->dialogues = 0;
+
+	for (menu = data->menu_list; menu != NULL; menu = menu->next) {
+		statistics->menus++;
+
+		if (menu->title_len > 0)
+			statistics->indirected++;
+
+		for (item = menu->first_item; item != NULL; item = item->next) {
+			statistics->items++;
+
+			if (item->text_len > 0) {
+				statistics->indirected++;
+
+				if (item->validation != NULL)
+					statistics->validations++;
+			}
+
+			if (*(item->submenu_tag) != '\0' && item->submenu_dbox)
+				statistics->dialogues++;
+		}
+	}
+
+	if (data->file_length > 0) {
+		statistics->head_bytes = data->menus_offset;
+		statistics->menu_bytes = data->indirection_offset - data->menus_offset;
+		statistics->indirection_bytes = data->validation_offset - data->indirection_offset;
+		statistics->validation_bytes = data->dbox_chain_offset - data->validation_offset;
+		statistics->dialogue_tag_bytes = data->menu_tag_offset - data->dbox_chain_offset;
+		statistics->menu_tag_bytes = data->file_length - data->menu_tag_offset;
+	} else {
+		statistics->head_bytes = 0;
+		statistics->menu_bytes = 0;
+		statistics->indirection_bytes = 0;
+		statistics->validation_bytes = 0;
+		statistics->dialogue_tag_bytes = 0;
+		statistics->menu_tag_bytes = 0;
 	}
 
-	while (validation != NULL) {
-		if (validation->item != NULL) {
-			printf("Validation string:    %s\n", (validation->item)->validation);
+	statistics->file_bytes = data->file_length;
+
+	statistics->longest_indirection = data->longest_indirection;
+	statistics->longest_validation = data->longest_validation;
+	statistics->longest_dbox_chain = data->longest_dbox_chain;
+	statistics->longest_menu_tag = data->longest_menu_tag;
+}
+
+
+/**
+ * Find an output format from its name.
+ *
+ * \param *name		The name of the format.
+ * \return		The format, or DATA_FORMAT_UNKNOWN.
+ */
+
+enum data_format data_find_format(char *name)
+{
+	if (strcmp(name, "menus") == 0)
+		return DATA_FORMAT_MENUS;
+	else if (strcmp(name, "c") == 0)
+		return DATA_FORMAT_C;
+	else if (strcmp(name, "asm") == 0)
+		return DATA_FORMAT_ASM;
+
+	return DATA_FORMAT_UNKNOWN;
+}
+
+
+/**
+ * Write a menu definition file. The file is assembled in memory and then
+ * written out in a single operation, either as it stands or as source code
+ * which can be built into an application.
+ *
+ * \param *data		The data block to use.
+ * \param *filename	The file to write.
+ * \param format	The form in which to write the file.
+ * \param *symbol	The symbol to give the data in source code formats,
+ *			or NULL for the default.
+ * \param compress	True to write the file in a compressed container;
+ *			else False.
+ * \param changes_only	True to leave the file untouched if its contents
+ *			would not change; else False.
+ * \return		True if the file was created OK; else False;
+ */
+
+bool data_write_standard_menu_file(struct data_block *data, char *filename, enum data_format format, char *symbol, bool compress, bool changes_only)
+{
+	struct buffer_block		*file, *packed;
+
+	int				offset;
+	bool				success;
+
+	struct menu_definition		*menu;
+	struct item_definition		*item;
+	struct dbox_data		*dbox;
+
+	struct file_head_block		*head_block;
+	struct file_extended_head_block	*extended_head_block;
+	struct file_relocation_head_block	*relocation_head_block;
+	struct file_menu_block		*menu_block;
+	struct file_item_block		*item_block;
+
+	file = buffer_create(data->memory, data->file_length);
+
+	if (file == NULL)
+		return false;
+
+	/* Write the file header. */
+
+	head_block = buffer_claim(file, sizeof(struct file_head_block));
+	if (head_block == NULL) {
+		buffer_destroy(file);
+		return false;
+	}
+
+	/* If there is a dbox_chain and the first item has a non-zero file
+	 * offset, then we're using the embedded format.  The offset in the
+	 * header is a word ahead of the first block, and points to the
+	 * leading zero. Compact files point to their own tables instead.
+	 */
+
+	if (data->compact) {
+		head_block->dialogues = (data->dbox_list != NULL) ? data->dbox_chain_offset : NULL_OFFSET;
+		head_block->indirection = data->indirection_offset;
+		head_block->validation = data->validation_offset;
+	} else {
+		if (data->dbox_chain_list != NULL && data->dbox_chain_list->file_offset != 0)
+			head_block->dialogues = data->dbox_chain_list->file_offset - 4;
+		else
+			head_block->dialogues = data->dbox_offset;
+
+		if (data->indirection_list != NULL)
+			head_block->indirection = data->indirection_list->file_offset;
+		else
+			head_block->indirection = NULL_OFFSET;
+
+		if (data->validation_list != NULL)
+			head_block->validation = data->validation_list->file_offset;
+		else
+			head_block->validation = NULL_OFFSET;
+	}
+
+	/* If there's a menu tag list, or the file is to be relocated or is
+	 * compact, this is a new format file with an extended head block.
+	 */
+
+	if (data->extended_head) {
+		extended_head_block = buffer_claim(file, sizeof(struct file_extended_head_block));
+		if (extended_head_block == NULL) {
+			buffer_destroy(file);
+			return false;
+		}
+
+		extended_head_block->zero = 0;
+		extended_head_block->flags = (data->relocate) ? FILE_FLAGS_RELOCATED : 0;
+
+		if (data->compact) {
+			extended_head_block->flags |= FILE_FLAGS_COMPACT;
+			extended_head_block->menus = (data->menu_tag_list != NULL) ? data->menu_tag_offset : NULL_OFFSET;
+		} else {
+			extended_head_block->menus = (data->menu_tag_list != NULL) ? data->menu_tag_list->file_offset : NULL_OFFSET;
+		}
+		extended_head_block->end = 0;
+	}
+
+	if (data->relocate) {
+		relocation_head_block = buffer_claim(file, sizeof(struct file_relocation_head_block));
+		if (relocation_head_block == NULL) {
+			buffer_destroy(file);
+			return false;
+		}
+
+		relocation_head_block->base = (int) data->base;
+	}
+
+	/* Write the menu & item blocks. */
+
+	menu = data->menu_list;
+
+	while (menu != NULL) {
+		/* Compact menu blocks start at the title, so the first two
+		 * words of the block returned are left alone.
+		 */
+
+		if (data->compact)
+			menu_block = buffer_claim(file, sizeof(struct file_menu_block) - 8);
+		else
+			menu_block = buffer_claim(file, sizeof(struct file_menu_block));
+
+		if (menu_block == NULL) {
+			buffer_destroy(file);
+			return false;
+		}
+
+		if (data->compact) {
+			menu_block = (struct file_menu_block *) ((char *) menu_block - 8);
+		} else {
+			if (menu->next == NULL)
+				menu_block->next = NULL_OFFSET;
+			else
+				menu_block->next = (menu->next)->file_offset + 8;
+
+			menu_block->submenus = menu->first_submenu;
+		}
+
+		if (menu->title_len == 0) {
+			strncpy(menu_block->title_data.text, menu->title, FILE_ITEM_TEXT_LENGTH);
+		} else {
+			menu_block->title_data.indirected_text.indirection = 0;
+			menu_block->title_data.indirected_text.validation = -1;
+			menu_block->title_data.indirected_text.size = menu->title_len;
+		}
+
+		menu_block->title_fg = (wimp_colour) menu->title_foreground;
+		menu_block->title_bg = (wimp_colour) menu->title_background;
+		menu_block->work_fg = (wimp_colour) menu->work_area_foreground;
+		menu_block->work_bg = (wimp_colour) menu->work_area_background;
+		menu_block->width = menu->item_width;
+		menu_block->height = menu->item_height;
+		menu_block->gap = menu->item_gap;
+
+		item = menu->first_item;
+
+		while (item != NULL) {
+			item_block = buffer_claim(file, sizeof(struct file_item_block));
+			if (item_block == NULL) {
+				buffer_destroy(file);
+				return false;
+			}
+
+			if (item->text_len == 0) {
+				strncpy(item_block->icon_data.text, item->text, FILE_ITEM_TEXT_LENGTH);
+			} else {
+				item_block->icon_data.indirected_text.indirection = 0;
+				item_block->icon_data.indirected_text.validation = -1;
+				item_block->icon_data.indirected_text.size = item->text_len;
+			}
+
+			item_block->menu_flags = item->menu_flags;
+
+			/* Submenus in other shards are loaded on demand, so the
+			 * application must be warned when they are opened.
+			 */
+
+			if (data_find_shard_link(data, item) != NULL)
+				item_block->menu_flags |= wimp_MENU_GIVE_WARNING;
+
+			item_block->icon_flags = item->icon_flags;
+
+			/* Compact files link the submenus in directly. */
+
+			if (!data->compact)
+				item_block->submenu_file_offset = item->next_submenu;
+			else if (item->submenu != NULL)
+				item_block->submenu_file_offset = (item->submenu)->file_offset + 8;
+			else
+				item_block->submenu_file_offset = NO_SUBMENU;
+
+			item = item->next;
+		}
+
+		menu = menu->next;
+	}
+
+	/* Write the sections which follow the menus. */
+
+	if (data->compact)
+		success = data_write_compact_sections(data, file);
+	else
+		success = data_write_standard_sections(data, file);
+
+	if (!success) {
+		buffer_destroy(file);
+		return false;
+	}
+
+	/* Relocate the file if required, then write the assembled data out
+	 * to disc in one go.
+	 */
+
+	if (data->relocate)
+		data_relocate_image(data, buffer_get_data(file, NULL));
+
+	if (compress) {
+		packed = data_compress_image(data, file);
+		buffer_destroy(file);
+
+		if (packed == NULL)
+			return false;
+
+		file = packed;
+	}
+
+	if (format == DATA_FORMAT_MENUS && !buffer_save_file(file, filename, changes_only)) {
+		buffer_destroy(file);
+		return false;
+	} else if (format != DATA_FORMAT_MENUS && !data_save_image(data, file, filename, format, symbol, changes_only)) {
+		buffer_destroy(file);
+		return false;
+	}
+
+	buffer_destroy(file);
+
+	/* Output dialogue box details. */
+
+	if (data->dbox_chain_list != NULL && data->dbox_chain_list->file_offset != 0) {
+		report_info(data->report, REPORT_OUTPUT, "Dialogue box tags embedded into file.");
+	} else if (data->dbox_list != NULL) {
+		report_info(data->report, REPORT_OUTPUT, "Dialogue boxes required in order:");
+
+		/**
+		 * The list must be printed in reverse order so that it is
+		 * compatible with the way that the original BASIC versions of
+		 * MenuGen worked, so reverse it in place, print it, and then
+		 * put it back as it was.
+		 */
+
+		data->dbox_list = data_reverse_dbox_list(data, data->dbox_list);
+
+		offset = 0;
+
+		for (dbox = data->dbox_list; dbox != NULL; dbox = dbox->next)
+			report_info(data->report, REPORT_OUTPUT, "%4d : %s", 4*offset++, (dbox->item)->submenu_tag);
+
+		data->dbox_list = data_reverse_dbox_list(data, data->dbox_list);
+	}
+
+	/* Output the list of menus in data block order. */
+
+	report_info(data->report, REPORT_OUTPUT, "Menus created in order:");
+
+	menu = data->menu_list;
+	offset = 0;
+
+	while (menu != NULL) {
+		report_info(data->report, REPORT_OUTPUT, "%4d : %s (%s)", 4*offset++, menu->tag, menu->title);
+		menu = menu->next;
+	}
+
+	return true;
+}
+
+
+/**
+ * Write the indirected text, validation strings, dialogue box tags and menu
+ * tags which follow the menus in a standard format file.
+ *
+ * Param:  *data	The data block to use.
+ * Param:  *file	The buffer holding the file.
+ * Return:		True if the sections were written OK; else False.
+ */
+
+static bool data_write_standard_sections(struct data_block *data, struct buffer_block *file)
+{
+	struct indirection_data		*indirection;
+	struct validation_data		*validation;
+	struct dbox_chain_data		*dbox_chain;
+	struct menu_tag_data		*menu_tag;
+
+	struct file_indirection_block	*indirection_block;
+	struct file_validation_block	*validation_block;
+	struct file_dialogue_head_block	*dbox_head_block;
+	struct file_dialogue_tag_block	*dbox_tag_block;
+	struct file_menu_tag_block	*menu_tag_block;
+
+	/* Write the indirected data blocks. */
+
+	indirection = data->indirection_list;
+
+	while (indirection != NULL) {
+		indirection_block = buffer_claim(file, indirection->block_length);
+		if (indirection_block == NULL) {
+			return false;
+		}
+
+		indirection_block->location = indirection->target;
+		if (indirection->menu != NULL)
+			strncpy(indirection_block->data, (indirection->menu)->title, indirection->block_length - sizeof(struct file_indirection_block));
+		else if (indirection->item != NULL)
+			strncpy(indirection_block->data, (indirection->item)->text, indirection->block_length - sizeof(struct file_indirection_block));
+
+		indirection = indirection->next;
+	}
+
+	if (data->indirection_list != NULL) {
+		indirection_block = buffer_claim(file, 4);
+		if (indirection_block == NULL) {
+			return false;
+		}
+
+		indirection_block->location = NULL_OFFSET;
+	}
+
+	/* Write the validation string blocks. */
+
+	validation = data->validation_list;
+
+	while (validation != NULL) {
+		validation_block = buffer_claim(file, validation->block_length);
+		if (validation_block == NULL) {
+			return false;
+		}
+
+		validation_block->location = validation->target;
+		validation_block->length = validation->block_length;
+		if (validation->item != NULL && (validation->item)->validation != NULL)
+			strncpy(validation_block->data, (validation->item)->validation, validation->block_length - sizeof(struct file_validation_block));
+
+		validation = validation->next;
+	}
+
+	if (data->validation_list != NULL) {
+		validation_block = buffer_claim(file, 4);
+		if (validation_block == NULL) {
+			return false;
+		}
+
+		validation_block->location = NULL_OFFSET;
+	}
+
+	/* Write the dialogue data blocks. */
+
+	if (data->dbox_chain_list != NULL && data->dbox_chain_list->file_offset != 0) {
+		dbox_head_block = buffer_claim(file, 4);
+		if (dbox_head_block == NULL) {
+			return false;
+		}
+
+		dbox_head_block->zero = 0;
+
+		dbox_chain = data->dbox_chain_list;
+
+		while (dbox_chain != NULL) {
+			dbox_tag_block = buffer_claim(file, dbox_chain->block_length);
+			if (dbox_tag_block == NULL) {
+				return false;
+			}
+
+			dbox_tag_block->dialogues = dbox_chain->first_dbox;
+			if (dbox_chain->tag != NULL)
+				strncpy(dbox_tag_block->tag, dbox_chain->tag, dbox_chain->block_length - sizeof(struct file_dialogue_tag_block));
+
+			dbox_chain = dbox_chain->next;
+		}
+
+		dbox_tag_block = buffer_claim(file, 4);
+		if (dbox_tag_block == NULL) {
+			return false;
+		}
+
+		dbox_tag_block->dialogues = NULL_OFFSET;
+	}
+
+	if (data->menu_tag_list != NULL && data->menu_tag_list->file_offset != 0) {
+		menu_tag = data->menu_tag_list;
+
+		while (menu_tag != NULL) {
+			menu_tag_block = buffer_claim(file, menu_tag->block_length);
+			if (menu_tag_block == NULL) {
+				return false;
+			}
+
+			menu_tag_block->menu = menu_tag->menu_offset;
+			if (menu_tag->tag != NULL)
+				strncpy(menu_tag_block->tag, menu_tag->tag, menu_tag->block_length - sizeof(struct file_menu_tag_block));
+
+			menu_tag = menu_tag->next;
+		}
+
+		/* Write the terminating -1 at the end of the list. */
+
+		menu_tag_block = buffer_claim(file, 4);
+		if (menu_tag_block == NULL) {
+			return false;
+		}
+
+		menu_tag_block->menu = NULL_OFFSET;
+	}
+
+	return true;
+}
+
+
+/**
+ * Write the relocation table, string pool and dialogue box and menu tables
+ * which follow the menus in a compact format file, linking the strings
+ * into the menus as they go.
+ *
+ * Param:  *data	The data block to use.
+ * Param:  *file	The buffer holding the file.
+ * Return:		True if the sections were written OK; else False.
+ */
+
+static bool data_write_compact_sections(struct data_block *data, struct buffer_block *file)
+{
+	struct indirection_data			*indirection;
+	struct validation_data			*validation;
+	struct dbox_chain_data			*dbox_chain;
+	struct menu_tag_data			*menu_tag;
+
+	struct file_compact_relocation_block	*relocation_block;
+	struct file_compact_dialogue_block	*dbox_block;
+	struct file_compact_chain_block		*chain_block;
+	struct file_compact_tag_block		*tag_block;
+
+	char					*image;
+	int					*words;
+
+	/* Claim the rest of the file in one go, so that it can be filled in
+	 * out of order.
+	 */
+
+	if (buffer_claim(file, data->file_length - data->indirection_offset) == NULL)
+		return false;
+
+	image = buffer_get_data(file, NULL);
+	words = (int *) image;
+
+	/* Copy the strings into the pool, and link them into the menus. */
+
+	for (indirection = data->indirection_list; indirection != NULL; indirection = indirection->next) {
+		words[indirection->target / 4] = indirection->file_offset;
+
+		/* Leave room for a terminator, as the buffers are packed together. */
+
+		if (indirection->block_length == 0)
+			continue;
+
+		if (indirection->menu != NULL)
+			strncpy(image + indirection->file_offset, (indirection->menu)->title, indirection->block_length - 1);
+		else if (indirection->item != NULL)
+			strncpy(image + indirection->file_offset, (indirection->item)->text, indirection->block_length - 1);
+	}
+
+	for (validation = data->validation_list; validation != NULL; validation = validation->next) {
+		words[validation->target / 4] = validation->file_offset;
+
+		if (validation->block_length > 0)
+			strcpy(image + validation->file_offset, (validation->item)->validation);
+	}
+
+	for (dbox_chain = data->dbox_chain_list; dbox_chain != NULL && dbox_chain->file_offset != 0; dbox_chain = dbox_chain->next)
+		strcpy(image + dbox_chain->file_offset, dbox_chain->tag);
+
+	for (menu_tag = data->menu_tag_list; menu_tag != NULL; menu_tag = menu_tag->next)
+		strcpy(image + menu_tag->file_offset, menu_tag->tag);
+
+	/* Build the relocation table. */
+
+	relocation_block = (struct file_compact_relocation_block *) (image + data->indirection_offset);
+	data_build_relocation_table(data, relocation_block->words, &(relocation_block->relocations));
+
+	/* Build the dialogue box table. */
+
+	if (data->dbox_list != NULL) {
+		dbox_block = (struct file_compact_dialogue_block *) (image + data->dbox_chain_offset);
+
+		if (data->dbox_chain_list != NULL && data->dbox_chain_list->file_offset != 0) {
+			dbox_block->names = data->dbox_chain_list->file_offset;
+
+			for (dbox_chain = data->dbox_chain_list; dbox_chain != NULL; dbox_chain = dbox_chain->next) {
+				chain_block = (struct file_compact_chain_block *) (image + dbox_chain->first_dbox);
+				data_build_dialogue_chain(data, dbox_chain, chain_block->items, &(chain_block->dialogues));
+				dbox_block->chains++;
+			}
+		} else {
+			dbox_block->names = NULL_OFFSET;
+			dbox_block->chains = 1;
+
+			chain_block = (struct file_compact_chain_block *) (dbox_block + 1);
+			data_build_dialogue_chain(data, NULL, chain_block->items, &(chain_block->dialogues));
+		}
+	}
+
+	/* Build the menu table, with the names in the same order. */
+
+	if (data->menu_tag_list != NULL) {
+		tag_block = (struct file_compact_tag_block *) (image + data->menu_tag_offset);
+		tag_block->names = data->menu_tag_list->file_offset;
+
+		for (menu_tag = data->menu_tag_list; menu_tag != NULL; menu_tag = menu_tag->next)
+			tag_block->offsets[tag_block->menus++] = menu_tag->menu_offset;
+	}
+
+	return true;
+}
+
+
+/**
+ * Pack an assembled menu definition file into a compressed container.
+ *
+ * Param:  *data	The data block to use.
+ * Param:  *file	The buffer holding the assembled file.
+ * Return:		A new buffer holding the container, or NULL on failure.
+ */
+
+static struct buffer_block *data_compress_image(struct data_block *data, struct buffer_block *file)
+{
+	struct buffer_block			*packed;
+	struct file_head_block			*head_block;
+	struct file_extended_head_block		*extended_head_block;
+	struct file_compression_head_block	*compression_head_block;
+	int					*image;
+	size_t					length;
+
+	image = buffer_get_data(file, &length);
+
+	packed = buffer_create(data->memory, length);
+	if (packed == NULL)
+		return NULL;
+
+	/* Each block is filled in before the next is claimed, as claiming
+	 * can move the buffer.
+	 */
+
+	head_block = buffer_claim(packed, sizeof(struct file_head_block));
+	if (head_block == NULL) {
+		buffer_destroy(packed);
+		return NULL;
+	}
+
+	memcpy(head_block, image, sizeof(struct file_head_block));
+
+	extended_head_block = buffer_claim(packed, sizeof(struct file_extended_head_block));
+	if (extended_head_block == NULL) {
+		buffer_destroy(packed);
+		return NULL;
+	}
+
+	if (data->extended_head)
+		memcpy(extended_head_block, image + sizeof(struct file_head_block) / 4, sizeof(struct file_extended_head_block));
+	else
+		extended_head_block->menus = NULL_OFFSET;
+
+	extended_head_block->flags |= FILE_FLAGS_COMPRESSED;
+
+	compression_head_block = buffer_claim(packed, sizeof(struct file_compression_head_block));
+	if (compression_head_block == NULL) {
+		buffer_destroy(packed);
+		return NULL;
+	}
+
+	compression_head_block->length = length;
+
+	if (!compress_block(packed, image, length)) {
+		buffer_destroy(packed);
+		return NULL;
+	}
+
+	return packed;
+}
+
+
+/**
+ * Relocate an assembled menu definition file to the base address, turning
+ * each of its offsets into an absolute address and linking in the indirected
+ * text, validation strings and submenus in the same way that an application
+ * would do when loading it. The dialogue box chains are relocated, but are
+ * left for the application to link in.
+ *
+ * Param:		The data block to use.
+ * Param:		Pointer to the assembled file.
+ */
+
+static void data_relocate_image(struct data_block *data, int *image)
+{
+	struct menu_definition	*menu;
+	struct item_definition	*item;
+	struct indirection_data	*indirection;
+	struct validation_data	*validation;
+	struct dbox_chain_data	*dbox_chain;
+	struct menu_tag_data	*menu_tag;
+
+	if (image == NULL)
+		return;
+
+	/* The file head and extended file head. */
+
+	data_relocate_word(image, 0, image[0], data->base);
+	data_relocate_word(image, 4, image[1], data->base);
+	data_relocate_word(image, 8, image[2], data->base);
+
+	if (data->extended_head)
+		data_relocate_word(image, sizeof(struct file_head_block) + 8, image[(sizeof(struct file_head_block) + 8) / 4], data->base);
+
+	/* The menu chain, and the submenus and dialogue chains in the items. */
+
+	for (menu = data->menu_list; menu != NULL; menu = menu->next) {
+		data_relocate_word(image, menu->file_offset, image[menu->file_offset / 4], data->base);
+		image[menu->file_offset / 4 + 1] = NULL_OFFSET;
+
+		for (item = menu->first_item; item != NULL; item = item->next) {
+			if (item->submenu != NULL)
+				data_relocate_word(image, item->file_offset + 4, (item->submenu)->file_offset + 8, data->base);
+			else
+				data_relocate_word(image, item->file_offset + 4, image[(item->file_offset + 4) / 4], data->base);
+		}
+	}
+
+	/* The indirected text and validation strings, which are linked into
+	 * the icon data that they belong to.
+	 */
+
+	for (indirection = data->indirection_list; indirection != NULL; indirection = indirection->next) {
+		data_relocate_word(image, indirection->file_offset, indirection->target, data->base);
+		data_relocate_word(image, indirection->target, indirection->file_offset + 4, data->base);
+	}
+
+	for (validation = data->validation_list; validation != NULL; validation = validation->next) {
+		data_relocate_word(image, validation->file_offset, validation->target, data->base);
+		data_relocate_word(image, validation->target, validation->file_offset + 8, data->base);
+	}
+
+	/* The embedded dialogue box and menu tag lists. */
+
+	for (dbox_chain = data->dbox_chain_list; dbox_chain != NULL && dbox_chain->file_offset != 0; dbox_chain = dbox_chain->next)
+		data_relocate_word(image, dbox_chain->file_offset, image[dbox_chain->file_offset / 4], data->base);
+
+	for (menu_tag = data->menu_tag_list; menu_tag != NULL && menu_tag->file_offset != 0; menu_tag = menu_tag->next)
+		data_relocate_word(image, menu_tag->file_offset, image[menu_tag->file_offset / 4], data->base);
+}
+
+
+/**
+ * Store an offset into a word of an assembled menu definition file as an
+ * absolute address, leaving null offsets untouched.
+ *
+ * Param:		Pointer to the assembled file.
+ * Param:		The offset of the word to update.
+ * Param:		The offset to store in the word, or -1.
+ * Param:		The base address of the file.
+ */
+
+static void data_relocate_word(int *image, int offset, int value, unsigned base)
+{
+	image[offset / 4] = (value == NULL_OFFSET) ? NULL_OFFSET : (int) (base + (unsigned) value);
+}
+
+
+/**
+ * Write an assembled menu definition file out as C or assembler source, so
+ * that it can be linked into an application instead of being loaded from
+ * disc. The data is a writable, word-aligned block which can be fixed up in
+ * place, with a symbol for the whole file, one for its length in bytes and
+ * one for each menu: in C these are pointers into the array, while in
+ * assembler they are labels within the data.
+ *
+ * Param:		The data block to use.
+ * Param:		The buffer holding the assembled file.
+ * Param:		The file to write.
+ * Param:		The form in which to write the file.
+ * Param:		The symbol to give the data, or NULL for the default.
+ * Param:		True to leave the file untouched if its contents
+ *			would not change; else False.
+ * Return:		True if the file was written OK; else False.
+ */
+
+static bool data_save_image(struct data_block *data, struct buffer_block *file, char *filename, enum data_format format, char *symbol, bool changes_only)
+{
+	struct buffer_block	*source;
+	struct hash_table	*names;
+	struct menu_definition	*menu;
+	char			*image, *menu_names;
+	size_t			length, offset;
+	unsigned int		word;
+	int			count, index, column;
+	bool			success;
+
+	if (symbol == NULL || *symbol == '\0')
+		symbol = "menus";
+
+	image = buffer_get_data(file, &length);
+
+	/* Give each menu a symbol based on its tag. The length symbol is
+	 * entered into the table first, so that no menu can take its name.
+	 */
+
+	count = 0;
+
+	for (menu = data->menu_list; menu != NULL; menu = menu->next)
+		count++;
+
+	menu_names = memory_claim(data->memory, MEMORY_SCRATCH, (count + 1) * MAX_IDENTIFIER_LEN);
+	names = hash_create(data->memory, NULL);
+	source = buffer_create(data->memory, length * 4);
+
+	if (image == NULL || menu_names == NULL || names == NULL || source == NULL) {
+		memory_release(data->memory, menu_names);
+		hash_destroy(names);
+		buffer_destroy(source);
+		return false;
+	}
+
+	data_make_identifier(names, menu_names, "size", '\0', 0, true);
+
+	for (menu = data->menu_list, index = 1; menu != NULL; menu = menu->next, index++)
+		data_make_identifier(names, menu_names + index * MAX_IDENTIFIER_LEN, menu->tag, '\0', index, true);
+
+	/* Write the data as words, in the byte order of the host. */
+
+	if (format == DATA_FORMAT_C) {
+		success = buffer_printf(source, "/* Menus file, generated by MenuGen.\n *\n"
+				" * This file is written automatically, and should not be edited.\n */\n\n"
+				"unsigned int %s[] = {", symbol);
+
+		for (offset = 0; offset < length; offset += sizeof(word)) {
+			memcpy(&word, image + offset, sizeof(word));
+			success = success && buffer_printf(source, "%s0x%08x%s", (offset % 32 == 0) ? "\n\t" : " ",
+					word, (offset + sizeof(word) < length) ? "," : "");
+		}
+
+		success = success && buffer_printf(source, "\n};\n\nconst int %s_%s = %u;\n\n", symbol, menu_names, (unsigned) length);
+
+		for (menu = data->menu_list, index = 1; menu != NULL; menu = menu->next, index++)
+			success = success && buffer_printf(source, "char *const %s_%s = (char *) %s + %d;\n",
+					symbol, menu_names + index * MAX_IDENTIFIER_LEN, symbol, menu->file_offset + 8);
+	} else {
+		success = buffer_printf(source, "/* Menus file, generated by MenuGen.\n *\n"
+				" * This file is written automatically, and should not be edited.\n */\n\n"
+				"\t.data\n\t.balign\t4\n\n\t.global\t%s_%s\n%s_%s:\n\t.long\t%u\n\n"
+				"\t.global\t%s\n\t.type\t%s, %%object\n\t.size\t%s, %u\n%s:",
+				symbol, menu_names, symbol, menu_names, (unsigned) length,
+				symbol, symbol, symbol, (unsigned) length, symbol);
+
+		menu = data->menu_list;
+		index = 1;
+		column = 0;
+
+		for (offset = 0; offset < length; offset += sizeof(word)) {
+			if (menu != NULL && offset == menu->file_offset + 8) {
+				success = success && buffer_printf(source, "\n\t.global\t%s_%s\n%s_%s:",
+						symbol, menu_names + index * MAX_IDENTIFIER_LEN, symbol, menu_names + index * MAX_IDENTIFIER_LEN);
+				menu = menu->next;
+				index++;
+				column = 0;
+			}
+
+			memcpy(&word, image + offset, sizeof(word));
+			success = success && buffer_printf(source, "%s0x%08x", (column == 0) ? "\n\t.long\t" : ", ", word);
+			column = (column + 1) % 8;
+		}
+
+		success = success && buffer_printf(source, "\n");
+	}
+
+	memory_release(data->memory, menu_names);
+	hash_destroy(names);
+
+	if (success)
+		success = buffer_save_file(source, filename, changes_only);
+
+	buffer_destroy(source);
+
+	return success;
+}
+
+
+/**
+ * Write a C header file describing the menu definition file, so that
+ * applications can refer to menus, items and dialogue boxes by name
+ * instead of using hard-coded indices and offsets. The structures must
+ * have been collated for the same options as the menu file.
+ *
+ * \param *data		The data block to use.
+ * \param *filename	The header file to write.
+ * \param *menus	The name of the menu file being described.
+ * \param changes_only	True to leave the file untouched if its contents
+ *			would not change; else False.
+ * \return		True if the file was created OK; else False;
+ */
+
+bool data_write_c_header(struct data_block *data, char *filename, char *menus, bool changes_only)
+{
+	struct buffer_block	*file;
+	struct hash_table	*menu_names, *local_names;
+	struct menu_definition	*menu;
+	struct item_definition	*item;
+	struct dbox_data	*dbox;
+	struct dbox_chain_data	*dbox_chain;
+	char			*names, *name, *menu_name, *leaf, guard[MAX_IDENTIFIER_LEN];
+	int			count, index;
+	bool			success = true, embedded;
+
+	if (data == NULL || filename == NULL)
+		return false;
+
+	/* Claim space for every identifier which might be written, so that
+	 * they can be checked for clashes as they are generated.
+	 */
+
+	count = 0;
+
+	for (menu = data->menu_list; menu != NULL; menu = menu->next)
+		count += 1 + menu->items;
+
+	for (dbox = data->dbox_list; dbox != NULL; dbox = dbox->next)
+		count++;
+
+	names = memory_claim(data->memory, MEMORY_SCRATCH, (count + 1) * MAX_IDENTIFIER_LEN);
+	menu_names = hash_create(data->memory, NULL);
+	local_names = hash_create(data->memory, NULL);
+	file = buffer_create(data->memory, 0);
+
+	if (names == NULL || menu_names == NULL || local_names == NULL || file == NULL) {
+		memory_release(data->memory, names);
+		hash_destroy(menu_names);
+		hash_destroy(local_names);
+		buffer_destroy(file);
+		return false;
+	}
+
+	/* The include guard is based on the leafname of the header. */
+
+	leaf = filename + strlen(filename);
+	while (leaf > filename && *(leaf - 1) != '/' && *(leaf - 1) != ':')
+		leaf--;
+
+	data_make_identifier(NULL, guard, leaf, '\0', 0, false);
+	if (buffer_is_standard_stream(filename))
+		strcpy(guard, "MENUS");
+
+	success = buffer_printf(file, "/* Menu indices and offsets for '%s', generated by MenuGen.\n"
+			" *\n * This file is written automatically, and should not be edited.\n */\n\n"
+			"#ifndef MENUGEN_%s\n#define MENUGEN_%s\n", (menus != NULL) ? menus : "", guard, guard);
+
+	/* Write the menu indices, in file order. */
+
+	name = names;
+
+	if (data->menu_list != NULL)
+		success = success && buffer_printf(file, "\n/* The menus, in the order that they appear in the file. */\n\nenum {\n");
+
+	for (menu = data->menu_list, index = 0; menu != NULL; menu = menu->next, index++) {
+		data_make_identifier(menu_names, name, menu->tag, '\0', index, false);
+		success = success && buffer_printf(file, "\tMENU_%s = %d,\n", name, index);
+		name += MAX_IDENTIFIER_LEN;
+	}
+
+	if (data->menu_list != NULL)
+		success = success && buffer_printf(file, "};\n");
+
+	/* Write the menu block offset and the item details for each menu.
+	 * The item names are generated once, into the space following the
+	 * menu names, and then used for both the indices and the offsets.
+	 */
+
+	for (menu = data->menu_list, index = 0; menu != NULL; menu = menu->next, index++) {
+		menu_name = names + index * MAX_IDENTIFIER_LEN;
+
+		success = success && buffer_printf(file, "\n/* Menu '%s'. */\n\n#define MENU_OFFSET_%s %d\n", menu->tag, menu_name, menu->file_offset + 8);
+
+		if (menu->first_item == NULL)
+			continue;
+
+		hash_clear(local_names);
+
+		success = success && buffer_printf(file, "\nenum {\n");
+
+		for (item = menu->first_item, count = 0; item != NULL; item = item->next, count++) {
+			if (item->source_text[0] == '@' && item->source_text[1] != '@')
+				data_make_identifier(local_names, name + count * MAX_IDENTIFIER_LEN, item->source_text + 1, ':', count, false);
+			else
+				data_make_identifier(local_names, name + count * MAX_IDENTIFIER_LEN, item->source_text, '\0', count, false);
+
+			success = success && buffer_printf(file, "\tITEM_%s_%s = %d,\n", menu_name, name + count * MAX_IDENTIFIER_LEN, count);
 		}
 
-		printf("String length:        %d bytes\n", validation->string_len);
-		printf("Target offset:        %d bytes\n", validation->target);
-		printf("Block Length in file: %d bytes\n", validation->block_length);
-		printf("File block offset:    %d bytes\n", validation->file_offset);
+		success = success && buffer_printf(file, "};\n\n");
 
-		printf("--------------------------------------------------------------------------------\n");
+		for (item = menu->first_item, count = 0; item != NULL; item = item->next, count++)
+			success = success && buffer_printf(file, "#define ITEM_OFFSET_%s_%s %d\n", menu_name, name + count * MAX_IDENTIFIER_LEN, item->file_offset);
 
-		validation = validation->next;
+		name += count * MAX_IDENTIFIER_LEN;
 	}
 
-	printf("================================================================================\n");
-}
+	/* Write the dialogue box indices. If the names are embedded, these
+	 * follow the order of the tag list; if not, they follow the order in
+	 * which the application must supply the dialogue box handles, which
+	 * will have one entry for every item which refers to a dialogue box.
+	 */
 
-/**
- * Write a menu definition file.
- *
- * \param *filename	The file to write.
- * \return		True if the file was created OK; else False;
- */
+	embedded = (data->dbox_chain_list != NULL && data->dbox_chain_list->file_offset != 0) ? true : false;
 
-bool data_write_standard_menu_file(char *filename)
-{
-	FILE				*file;
+	if (data->dbox_list != NULL) {
+		hash_clear(local_names);
 
-	int				offset;
+		success = success && buffer_printf(file, "\n/* The dialogue boxes, in the order of the %s. */\n\nenum {\n",
+				(embedded) ? "embedded dialogue box list" : "dialogue box handles in the file");
+	}
 
-	struct menu_definition		*menu;
-	struct item_definition		*item;
-	struct indirection_data		*indirection;
-	struct validation_data		*validation;
-	struct dbox_data		*dbox, *tail;
-	struct dbox_chain_data		*dbox_chain;
-	struct menu_tag_data		*menu_tag;
+	if (embedded) {
+		for (dbox_chain = data->dbox_chain_list, index = 0; dbox_chain != NULL; dbox_chain = dbox_chain->next, index++) {
+			data_make_identifier(local_names, name, dbox_chain->tag, '\0', index, false);
+			success = success && buffer_printf(file, "\tDBOX_%s = %d,\n", name, index);
+			name += MAX_IDENTIFIER_LEN;
+		}
+	} else if (data->dbox_list != NULL) {
+		data->dbox_list = data_reverse_dbox_list(data, data->dbox_list);
 
-	struct file_head_block		head_block;
-	struct file_extended_head_block	extended_head_block;
-	struct file_menu_block		menu_block;
-	struct file_item_block		item_block;
-	struct file_dialogue_head_block	dbox_head_block;
-
-	struct file_indirection_block	*indirection_block = NULL;
-	struct file_validation_block	*validation_block = NULL;
-	struct file_dialogue_tag_block	*dbox_tag_block = NULL;
-	struct file_menu_tag_block	*menu_tag_block = NULL;
-
-	indirection_block = malloc(longest_indirection);
-	validation_block = malloc(longest_validation);
-	dbox_tag_block = malloc(longest_dbox_chain);
-	menu_tag_block = malloc(longest_menu_tag);
-
-	if (indirection_block == NULL || validation_block == NULL || dbox_tag_block == NULL || menu_tag_block == NULL) {
-		if (indirection_block != NULL)
-			free(indirection_block);
-		if (validation_block != NULL)
-			free(validation_block);
-		if (dbox_tag_block != NULL)
-			free(dbox_tag_block);
-		if (menu_tag_block != NULL)
-			free(menu_tag_block);
+		for (dbox = data->dbox_list, index = 0; dbox != NULL; dbox = dbox->next, index++) {
+			data_make_identifier(local_names, name, (dbox->item)->submenu_tag, '\0', index, false);
+			success = success && buffer_printf(file, "\tDBOX_%s = %d,\n", name, index);
+			name += MAX_IDENTIFIER_LEN;
+		}
 
-		return false;
+		data->dbox_list = data_reverse_dbox_list(data, data->dbox_list);
 	}
 
-	file = fopen(filename, "w");
+	if (data->dbox_list != NULL)
+		success = success && buffer_printf(file, "};\n");
 
-	if (file == NULL)
-		return false;
-
-	/* Write the file header. */
+	success = success && buffer_printf(file, "\n#endif\n\n");
 
-	/* If there is a dbox_chain and the first item has a non-zero file
-	 * offset, then we're using the embedded format.  The offset in the
-	 * header is a word ahead of the first block, and points to the
-	 * leading zero.
-	 */
+	memory_release(data->memory, names);
+	hash_destroy(menu_names);
+	hash_destroy(local_names);
 
-	if (dbox_chain_list != NULL && dbox_chain_list->file_offset != 0)
-		head_block.dialogues = dbox_chain_list->file_offset - 4;
-	else
-		head_block.dialogues = dbox_offset;
+	if (success)
+		success = buffer_save_file(file, filename, changes_only);
 
-	if (indirection_list != NULL)
-		head_block.indirection = indirection_list->file_offset;
-	else
-		head_block.indirection = NULL_OFFSET;
+	buffer_destroy(file);
 
-	if (validation_list != NULL)
-		head_block.validation = validation_list->file_offset;
-	else
-		head_block.validation = NULL_OFFSET;
+	return success;
+}
 
-	fwrite(&head_block, sizeof(struct file_head_block), 1, file);
 
-	/* If there's a menu tag list, this is a new format file with
-	 * an extended head block.
-	 */
+/**
+ * Split the menus into shards along the submenu tree, so that they can be
+ * written to separate files and loaded on demand. The root menus, which
+ * aren't the submenu of any other menu, go into the core shard (shard 0);
+ * each submenu of a core menu which isn't already in a shard then starts a
+ * new shard, which takes every menu that can be reached from it that isn't
+ * already in one. Menus which can only be reached round a loop of submenus
+ * from no root are moved into the core, one at a time, until every menu is
+ * in a shard.
+ *
+ * The shard assignment is only used once a shard has been selected with
+ * data_select_shard().
+ *
+ * \param *data		The data block to use.
+ * \return		The number of shards, or 0 if there are no menus.
+ */
 
-	if (menu_tag_list != NULL) {
-		extended_head_block.zero = 0;
-		extended_head_block.flags = 0;	/* Future expansion. */
-		extended_head_block.menus = menu_tag_list->file_offset;
-		extended_head_block.end = 0;
+int data_assign_shards(struct data_block *data)
+{
+	struct menu_definition	*menu, *submenu;
+	struct item_definition	*item;
 
-		fwrite(&extended_head_block, sizeof(struct file_extended_head_block), 1, file);
-	}
+	data->shards = 0;
 
-	/* Write the menu & item blocks. */
+	if (data->defined_list == NULL)
+		return 0;
 
-	menu = menu_list;
+	/* Find the root menus, by marking every menu which is the submenu
+	 * of another as unassigned (-1) and every other one as core (0).
+	 */
 
-	while (menu != NULL) {
-		if (menu->next == NULL)
-			menu_block.next = NULL_OFFSET;
-		else
-			menu_block.next = (menu->next)->file_offset + 8;
+	for (menu = data->defined_list; menu != NULL; menu = menu->next_defined)
+		menu->shard = 0;
 
-		menu_block.submenus = menu->first_submenu;
+	for (menu = data->defined_list; menu != NULL; menu = menu->next_defined) {
+		for (item = menu->first_item; item != NULL; item = item->next) {
+			if (*(item->submenu_tag) == '\0' || item->submenu_dbox)
+				continue;
 
-		if (menu->title_len == 0) {
-			strncpy(menu_block.title_data.text, menu->title, 12);
-		} else {
-			menu_block.title_data.indirected_text.indirection = 0;
-			menu_block.title_data.indirected_text.validation = -1;
-			menu_block.title_data.indirected_text.size = menu->title_len;
+			submenu = data_find_menu_from_tag(data, item->submenu_tag);
+			if (submenu != NULL && submenu != menu)
+				submenu->shard = -1;
 		}
+	}
 
-		menu_block.title_fg = (wimp_colour) menu->title_foreground;
-		menu_block.title_bg = (wimp_colour) menu->title_background;
-		menu_block.work_fg = (wimp_colour) menu->work_area_foreground;
-		menu_block.work_bg = (wimp_colour) menu->work_area_background;
-		menu_block.width = menu->item_width;
-		menu_block.height = menu->item_height;
-		menu_block.gap = menu->item_gap;
+	/* Give each unassigned submenu of a core menu a shard of its own. */
 
-		fwrite(&menu_block, sizeof(struct file_menu_block), 1, file);
+	data->shards = 1;
 
-		item = menu->first_item;
+	do {
+		for (menu = data->defined_list; menu != NULL; menu = menu->next_defined) {
+			if (menu->shard != 0)
+				continue;
 
-		while (item != NULL) {
-			if (item->text_len == 0) {
-				strncpy(item_block.icon_data.text, item->text, 12);
-			} else {
-				item_block.icon_data.indirected_text.indirection = 0;
-				item_block.icon_data.indirected_text.validation = -1;
-				item_block.icon_data.indirected_text.size = item->text_len;
+			for (item = menu->first_item; item != NULL; item = item->next) {
+				if (*(item->submenu_tag) == '\0' || item->submenu_dbox)
+					continue;
+
+				submenu = data_find_menu_from_tag(data, item->submenu_tag);
+				if (submenu != NULL && submenu->shard == -1)
+					data_fill_shard(data, submenu, data->shards++);
 			}
+		}
 
-			item_block.menu_flags = item->menu_flags;
-			item_block.icon_flags = item->icon_flags;
-			item_block.submenu_file_offset = item->next_submenu;
+		/* Move the first menu left over into the core, and go again. */
 
-			fwrite(&item_block, sizeof(struct file_item_block), 1, file);
+		for (menu = data->defined_list; menu != NULL && menu->shard != -1; menu = menu->next_defined);
 
-			item = item->next;
-		}
+		if (menu != NULL)
+			menu->shard = 0;
+	} while (menu != NULL);
 
-		menu = menu->next;
-	}
+	return data->shards;
+}
 
-	/* Write the indirected data blocks. */
 
-	indirection = indirection_list;
+/**
+ * Place a menu into a shard, along with every unassigned menu which can be
+ * reached from it through submenus. The menus are visited breadth first.
+ *
+ * Param:  *data	The data block to use.
+ * Param:  *menu	The menu to start the shard from.
+ * Param:  shard	The shard to place the menus in.
+ */
 
-	while (indirection != NULL) {
-		indirection_block->location = indirection->target;
-		if (indirection->menu != NULL)
-			strncpy(indirection_block->data, (indirection->menu)->title, indirection->block_length - sizeof(struct file_indirection_block));
-		else if (indirection->item != NULL)
-			strncpy(indirection_block->data, (indirection->item)->text, indirection->block_length - sizeof(struct file_indirection_block));
-		else
-			strncpy(indirection_block->data, "", indirection->block_length - sizeof(struct file_indirection_block));
+static void data_fill_shard(struct data_block *data, struct menu_definition *menu, int shard)
+{
+	struct menu_definition	*tail, *submenu;
+	struct item_definition	*item;
 
-		fwrite(indirection_block, indirection->block_length, 1, file);
+	menu->shard = shard;
+	menu->next_queued = NULL;
+	tail = menu;
 
-		indirection = indirection->next;
-	}
+	while (menu != NULL) {
+		for (item = menu->first_item; item != NULL; item = item->next) {
+			if (*(item->submenu_tag) == '\0' || item->submenu_dbox)
+				continue;
+
+			submenu = data_find_menu_from_tag(data, item->submenu_tag);
+			if (submenu == NULL || submenu->shard != -1)
+				continue;
+
+			submenu->shard = shard;
+			submenu->next_queued = NULL;
+			tail->next_queued = submenu;
+			tail = submenu;
+		}
 
-	if (indirection_list != NULL) {
-		indirection_block->location = NULL_OFFSET;
-		fwrite(indirection_block, 4, 1, file);
+		menu = menu->next_queued;
 	}
+}
 
-	/* Write the validation string blocks. */
-
-	validation = validation_list;
-
-	while (validation != NULL) {
-		validation_block->location = validation->target;
-		validation_block->length = validation->block_length;
-		if (validation->item != NULL && (validation->item)->validation != NULL)
-			strncpy(validation_block->data, (validation->item)->validation, validation->block_length - sizeof(struct file_validation_block));
-		else
-			strncpy(validation_block->data, "", validation->block_length - sizeof(struct file_validation_block));
 
-		fwrite(validation_block, validation->block_length, 1, file);
+/**
+ * Select the menus from a single shard, so that they can be collated and
+ * written out without the others. Submenu links to menus in other shards
+ * are left out of the collated file, to be recorded in the manifest.
+ *
+ * \param *data		The data block to use.
+ * \param shard		The shard to select, or DATA_ALL_SHARDS to
+ *			select every menu again.
+ * \return		True if the shard was selected; else False.
+ */
 
-		validation = validation->next;
-	}
+bool data_select_shard(struct data_block *data, int shard)
+{
+	struct menu_definition	*menu, *last = NULL;
 
-	if (validation_list != NULL) {
-		validation_block->location = NULL_OFFSET;
-		fwrite(validation_block, 4, 1, file);
-	}
+	if (shard != DATA_ALL_SHARDS && (shard < 0 || shard >= data->shards))
+		return false;
 
-	/* Write the dialogue data blocks. */
+	data->menu_list = NULL;
 
-	if (dbox_chain_list != NULL && dbox_chain_list->file_offset != 0) {
-		dbox_head_block.zero = 0;
-		fwrite(&dbox_head_block, 4, 1, file);
+	for (menu = data->defined_list; menu != NULL; menu = menu->next_defined) {
+		if (shard != DATA_ALL_SHARDS && menu->shard != shard)
+			continue;
 
-		dbox_chain = dbox_chain_list;
+		if (last != NULL)
+			last->next = menu;
+		else
+			data->menu_list = menu;
 
-		while (dbox_chain != NULL) {
-			dbox_tag_block->dialogues = dbox_chain->first_dbox;
-			if (dbox_chain->tag != NULL)
-				strncpy(dbox_tag_block->tag, dbox_chain->tag, dbox_chain->block_length - sizeof(struct file_dialogue_tag_block));
-			else
-				strncpy(dbox_tag_block->tag, "", dbox_chain->block_length - sizeof(struct file_dialogue_tag_block));
+		menu->next = NULL;
+		last = menu;
+	}
 
-			fwrite(dbox_tag_block, dbox_chain->block_length, 1, file);
+	data->shard = shard;
 
-			dbox_chain = dbox_chain->next;
-		}
+	return true;
+}
 
-		dbox_tag_block->dialogues = NULL_OFFSET;
-		fwrite(dbox_tag_block, 4, 1, file);
-	}
 
-	if (menu_tag_list != NULL && menu_tag_list->file_offset != 0) {
-		menu_tag = menu_tag_list;
-		
-		while (menu_tag != NULL) {
-			menu_tag_block->menu = menu_tag->menu_offset;
-			if (menu_tag->tag != NULL)
-				strncpy(menu_tag_block->tag, menu_tag->tag, menu_tag->block_length - sizeof(struct file_menu_tag_block));
-			else
-				strncpy(menu_tag_block->tag, "", menu_tag->block_length - sizeof(struct file_menu_tag_block));
+/**
+ * Find the submenu of a menu item, if it's in a different shard from the
+ * item when a shard has been selected.
+ *
+ * Param:  *data	The data block to use.
+ * Param:  *item	The item to test.
+ * Return:		Pointer to the submenu, or NULL if the item has
+ *			no submenu in another shard.
+ */
 
-			fwrite(menu_tag_block, menu_tag->block_length, 1, file);
+static struct menu_definition *data_find_shard_link(struct data_block *data, struct item_definition *item)
+{
+	struct menu_definition	*submenu;
 
-			menu_tag = menu_tag->next;
-		}
+	if (data->shard == DATA_ALL_SHARDS || *(item->submenu_tag) == '\0' || item->submenu_dbox)
+		return NULL;
 
-		/* Write the terminating -1 at the end of the list. */
+	submenu = data_find_menu_from_tag(data, item->submenu_tag);
 
-		menu_tag_block->menu = NULL_OFFSET;
-		fwrite(menu_tag_block, 4, 1, file);
-	}
+	return (submenu != NULL && submenu->shard != data->shard) ? submenu : NULL;
+}
 
-	fclose(file);
 
-	free(indirection_block);
-	free(validation_block);
-	free(dbox_tag_block);
-	free(menu_tag_block);
+/**
+ * Write a manifest for a set of shards, recording each submenu link which
+ * crosses from one shard to another. Every shard must have been collated
+ * and written in turn, so that the offsets of its menus and items are
+ * those in its own file.
+ *
+ * \param *data		The data block to use.
+ * \param *filename	The manifest file to write.
+ * \param changes_only	True to leave the file untouched if its contents
+ *			would not change; else False.
+ * \return		True if the file was created OK; else False;
+ */
 
-	/* Output dialogue box details. */
+bool data_write_shard_manifest(struct data_block *data, char *filename, bool changes_only)
+{
+	struct buffer_block			*file;
+	struct menu_definition			*menu, *submenu;
+	struct item_definition			*item;
+	struct file_manifest_head_block		*head_block;
+	struct file_manifest_link_block		*link_block;
+	int					links = 0;
+	bool					success;
+
+	file = buffer_create(data->memory, 0);
+	if (file == NULL)
+		return false;
 
-	if (dbox_chain_list != NULL && dbox_chain_list->file_offset != 0) {
-		printf("Dialogue box tags embedded into file.\n");
-	} else if (dbox_list != NULL) {
-		printf("Dialogue boxes required in order:\n");
+	head_block = buffer_claim(file, sizeof(struct file_manifest_head_block));
+	if (head_block == NULL) {
+		buffer_destroy(file);
+		return false;
+	}
 
-		/**
-		 * This is messy, as the list must be printed in reverse order
-		 * so that it is compatible with the way that the original
-		 * BASIC versions of MenuGen worked.
-		 */
+	head_block->shards = data->shards;
 
-		tail = NULL;
-		offset = 0;
+	for (menu = data->defined_list; menu != NULL; menu = menu->next_defined) {
+		for (item = menu->first_item; item != NULL; item = item->next) {
+			if (*(item->submenu_tag) == '\0' || item->submenu_dbox)
+				continue;
 
-		while (tail != dbox_list) {
-			dbox = dbox_list;
+			submenu = data_find_menu_from_tag(data, item->submenu_tag);
+			if (submenu == NULL || submenu->shard == menu->shard)
+				continue;
 
-			while (dbox != NULL && dbox->next != tail)
-				dbox = dbox->next;
+			link_block = buffer_claim(file, sizeof(struct file_manifest_link_block));
+			if (link_block == NULL) {
+				buffer_destroy(file);
+				return false;
+			}
 
-			printf("%4d : %s\n", 4*offset++, (dbox->item)->submenu_tag);
+			link_block->item_shard = menu->shard;
+			link_block->item = item->file_offset + 4;
+			link_block->menu_shard = submenu->shard;
+			link_block->menu = submenu->file_offset + 8;
 
-			tail = dbox;
+			links++;
 		}
 	}
 
-	/* Output the list of menus in data block order. */
+	/* The buffer may have moved since the head was claimed. */
 
-	printf("Menus created in order:\n");
+	head_block = buffer_get_data(file, NULL);
+	head_block->links = links;
 
-	menu = menu_list;
-	offset = 0;
+	success = buffer_save_file(file, filename, changes_only);
 
-	while (menu != NULL) {
-		printf("%4d : %s (%s)\n", 4*offset++, menu->tag, menu->title);
-		menu = menu->next;
-	}
+	buffer_destroy(file);
 
-	return true;
+	return success;
 }
 
 
@@ -1121,34 +2863,39 @@ bool data_write_standard_menu_file(char *filename)
  *
  * \param *tag		The internal tag used to identify the menu.
  * \param *title	The menu title.
+ * \param line		The line on which the menu was defined.
+ * \param column	The column at which the menu was defined.
  * \return		True if the menu created OK; else False.
  */
 
-bool data_create_new_menu(char *tag, char *title)
+bool data_create_new_menu(struct data_block *data, char *tag, char *title, int line, int column)
 {
 	struct menu_definition	*menu;
 
 	/* Allocate storage and get out if we fail. */
 
-	menu = (struct menu_definition *) malloc(sizeof(struct menu_definition));
+	menu = memory_claim(data->memory, MEMORY_MENUS, sizeof(struct menu_definition));
 
 	if (menu == NULL)
 		return false;
 
-	menu->title = (char *) malloc(strlen(title)+1);
+	menu->source_title = memory_claim(data->memory, MEMORY_STRINGS, strlen(title)+1);
 
-	if (menu->title == NULL) {
-		free(menu);
+	if (menu->source_title == NULL) {
+		memory_release(data->memory, menu);
 		return false;
 	}
 
 	strcpy(menu->tag, tag);
-	strcpy(menu->title, title);
+	strcpy(menu->source_title, title);
 
-	if (strlen(title) > 12)
-		menu->title_len = strlen(title) + 1;
-	else
-		menu->title_len = 0;
+	menu->title = menu->source_title;
+	menu->indirection = -1;
+	menu->encoded_title = NULL;
+	menu->title_len = data_indirected_length(menu->title, menu->indirection);
+
+	menu->line = line;
+	menu->column = column;
 
 	menu->items = 0;
 	menu->first_item = NULL;
@@ -1167,15 +2914,28 @@ bool data_create_new_menu(char *tag, char *title)
 
 	menu->first_submenu = NULL_OFFSET;
 
+	menu->shard = 0;
+	menu->next_queued = NULL;
+
 	menu->next = NULL;
+	menu->next_defined = NULL;
 
-	if (current_menu != NULL)
-		current_menu->next = menu;
-	else
-		menu_list = menu;
+	if (!hash_insert(data->menu_index, menu->tag, menu)) {
+		memory_release(data->memory, menu->source_title);
+		memory_release(data->memory, menu);
+		return false;
+	}
+
+	if (data->current_menu != NULL) {
+		data->current_menu->next = menu;
+		data->current_menu->next_defined = menu;
+	} else {
+		data->menu_list = menu;
+		data->defined_list = menu;
+	}
 
-	current_menu = menu;
-	current_item = NULL;
+	data->current_menu = menu;
+	data->current_item = NULL;
 
 	return true;
 }
@@ -1184,38 +2944,47 @@ bool data_create_new_menu(char *tag, char *title)
  * Create a new menu item in the current menu, giving it the supplied title
  * and making it the current menu item.
  *
- * \param *title	The menu item title.
+ * \param *data		The data block to use.
+ * \param *text		The menu item title.
+ * \param line		The line on which the item was defined.
+ * \param column	The column at which the item was defined.
  * \return		True if the item was created OK; else False.
  */
 
-bool data_create_new_item(char *text)
+bool data_create_new_item(struct data_block *data, char *text, int line, int column)
 {
 	struct item_definition	*item;
 
 	/* If there isn't a current menu, then we can't create a new item. */
 
-	if (current_menu == NULL)
+	if (data->current_menu == NULL)
 		return false;
 
-	item = (struct item_definition *) malloc(sizeof(struct item_definition));
+	item = memory_claim(data->memory, MEMORY_ITEMS, sizeof(struct item_definition));
 
 	if (item == NULL)
 		return false;
 
-	item->text = (char *) malloc(strlen(text)+1);
+	item->source_text = memory_claim(data->memory, MEMORY_STRINGS, strlen(text)+1);
 
-	if (item->text == NULL) {
-		free(item);
+	if (item->source_text == NULL) {
+		memory_release(data->memory, item);
 		return false;
 	}
 
-	strcpy(item->text, text);
+	strcpy(item->source_text, text);
+	item->source_validation = NULL;
 	item->validation = NULL;
 
-	if (strlen(text) > 12)
-		item->text_len = strlen(text) + 1;
-	else
-		item->text_len = 0;
+	item->text = item->source_text;
+	item->indirection = -1;
+
+	item->encoded_text = NULL;
+	item->encoded_validation = NULL;
+	item->text_len = data_indirected_length(item->text, item->indirection);
+
+	item->line = line;
+	item->column = column;
 
 	item->file_offset = NULL_OFFSET;
 
@@ -1224,6 +2993,8 @@ bool data_create_new_item(char *text)
 
 	*(item->submenu_tag) = '\0';
 	item->submenu_dbox = false;
+	item->submenu_line = 0;
+	item->submenu_column = 0;
 
 	item->submenu = NULL;
 	item->dbox = NULL;
@@ -1234,13 +3005,13 @@ bool data_create_new_item(char *text)
 
 	item->next = NULL;
 
-	if (current_item != NULL)
-		current_item->next = item;
+	if (data->current_item != NULL)
+		data->current_item->next = item;
 	else
-		current_menu->first_item = item;
+		data->current_menu->first_item = item;
 
-	current_item = item;
-	(current_menu->items)++;
+	data->current_item = item;
+	(data->current_menu->items)++;
 
 	return true;
 }
@@ -1248,21 +3019,26 @@ bool data_create_new_item(char *text)
 /**
  * Set the current item's submenu status.
  *
+ * \param *data		The data block to use.
  * \param *tag		The tag for the submenu.
  * \param dbox		True if the item is a dbox; else False.
+ * \param line		The line on which the submenu was specified.
+ * \param column	The column at which the submenu was specified.
  * \return		True if the tag was set correctly; else False.
  */
 
-bool data_set_item_submenu(char *tag, bool dbox)
+bool data_set_item_submenu(struct data_block *data, char *tag, bool dbox, int line, int column)
 {
-	if (current_item == NULL)
+	if (data->current_item == NULL)
 		return false;
 
 	if (strlen(tag)+1 > MAX_TAG_LEN)
 		return false;
 
-	strcpy(current_item->submenu_tag, tag);
-	current_item->submenu_dbox = dbox;
+	strcpy(data->current_item->submenu_tag, tag);
+	data->current_item->submenu_dbox = dbox;
+	data->current_item->submenu_line = line;
+	data->current_item->submenu_column = column;
 
 	return true;
 }
@@ -1270,17 +3046,20 @@ bool data_set_item_submenu(char *tag, bool dbox)
 /**
  * Set the current menu's title indirection status.
  *
+ * \param *data		The data block to use.
  * \param size		The indirected buffer size.
  * \return		True if the indirection was set correctly; else False.
  */
 
-bool data_set_menu_title_indirection(int size)
+bool data_set_menu_title_indirection(struct data_block *data, int size)
 {
-	if (current_menu == NULL)
+	if (data->current_menu == NULL)
 		return false;
 
-	if (size >= current_menu->title_len)
-		current_menu->title_len = size + 1;
+	if (size > data->current_menu->indirection)
+		data->current_menu->indirection = size;
+
+	data->current_menu->title_len = data_indirected_length(data->current_menu->title, data->current_menu->indirection);
 
 	return true;
 }
@@ -1288,17 +3067,20 @@ bool data_set_menu_title_indirection(int size)
 /**
  * Set the current item's indirection status.
  *
+ * \param *data		The data block to use.
  * \param size		The indirected buffer size.
  * \return		True if the indirection was set correctly; else False.
  */
 
-bool data_set_item_indirection(int size)
+bool data_set_item_indirection(struct data_block *data, int size)
 {
-	if (current_item == NULL)
+	if (data->current_item == NULL)
 		return false;
 
-	if (size >= current_item->text_len)
-		current_item->text_len = size + 1;
+	if (size > data->current_item->indirection)
+		data->current_item->indirection = size;
+
+	data->current_item->text_len = data_indirected_length(data->current_item->text, data->current_item->indirection);
 
 	return true;
 }
@@ -1306,16 +3088,17 @@ bool data_set_item_indirection(int size)
 /**
  * Make the current item writable.
  *
+ * \param *data		The data block to use.
  * \return		True if the writable status was set correctly; else False.
  */
 
-bool data_set_item_writable(void)
+bool data_set_item_writable(struct data_block *data)
 {
-	if (current_item == NULL)
+	if (data->current_item == NULL)
 		return false;
 
-	data_set_item_indirection(12);
-	current_item->menu_flags |= wimp_MENU_WRITABLE;
+	data_set_item_indirection(data, 12);
+	data->current_item->menu_flags |= wimp_MENU_WRITABLE;
 
 	return true;
 }
@@ -1323,24 +3106,26 @@ bool data_set_item_writable(void)
 /**
  * Set the current item's validation string.
  *
+ * \param *data		The data block to use.
  * \param *validation	The validation string.
  * \return		True if the validation string was set correctly; else False.
  */
 
-bool data_set_item_validation(char *validation)
+bool data_set_item_validation(struct data_block *data, char *validation)
 {
-	if ((current_item == NULL) ||
-			((current_item->menu_flags & wimp_MENU_WRITABLE) == 0) ||
-			(current_item->validation != NULL))
+	if ((data->current_item == NULL) ||
+			((data->current_item->menu_flags & wimp_MENU_WRITABLE) == 0) ||
+			(data->current_item->validation != NULL))
 		return false;
 
-	current_item->validation = (char *) malloc(strlen(validation) + 1);
+	data->current_item->source_validation = memory_claim(data->memory, MEMORY_STRINGS, strlen(validation) + 1);
 
-	if (current_item->validation == NULL) {
+	if (data->current_item->source_validation == NULL) {
 		return false;
 	}
 
-	strcpy(current_item->validation, validation);
+	strcpy(data->current_item->source_validation, validation);
+	data->current_item->validation = data->current_item->source_validation;
 
 	return true;
 
@@ -1349,6 +3134,7 @@ bool data_set_item_validation(char *validation)
 /**
  * Set the current menu's colours.
  *
+ * \param *data		The data block to use.
  * \param title_fg
  * \param title_bg
  * \param work_fg
@@ -1356,15 +3142,15 @@ bool data_set_item_validation(char *validation)
  * \return		True if the colours were set correctly; else False.
  */
 
-bool data_set_menu_colours(int title_fg, int title_bg, int work_fg, int work_bg)
+bool data_set_menu_colours(struct data_block *data, int title_fg, int title_bg, int work_fg, int work_bg)
 {
-	if (current_menu == NULL)
+	if (data->current_menu == NULL)
 		return false;
 
-	current_menu->title_foreground = title_fg;
-	current_menu->title_background = title_bg;
-	current_menu->work_area_foreground = work_fg;
-	current_menu->work_area_background = work_bg;
+	data->current_menu->title_foreground = title_fg;
+	data->current_menu->title_background = title_bg;
+	data->current_menu->work_area_foreground = work_fg;
+	data->current_menu->work_area_background = work_bg;
 
 	return true;
 }
@@ -1372,6 +3158,7 @@ bool data_set_menu_colours(int title_fg, int title_bg, int work_fg, int work_bg)
 /**
  * Set the current item's colours.
  *
+ * \param *data		The data block to use.
  * \param title_fg
  * \param title_bg
  * \param work_fg
@@ -1379,13 +3166,13 @@ bool data_set_menu_colours(int title_fg, int title_bg, int work_fg, int work_bg)
  * \return		True if the colours were set correctly; else False.
  */
 
-bool data_set_item_colours(int icon_fg, int icon_bg)
+bool data_set_item_colours(struct data_block *data, int icon_fg, int icon_bg)
 {
-	if (current_item == NULL)
+	if (data->current_item == NULL)
 		return false;
 
-	current_item->icon_foreground = icon_fg;
-	current_item->icon_background = icon_bg;
+	data->current_item->icon_foreground = icon_fg;
+	data->current_item->icon_background = icon_bg;
 
 	return true;
 }
@@ -1393,15 +3180,16 @@ bool data_set_item_colours(int icon_fg, int icon_bg)
 /**
  * Set the current item to be reversed.
  *
+ * \param *data		The data block to use.
  * \return		True if the state was set correctly; else False.
  */
 
-bool data_set_menu_reversed(void)
+bool data_set_menu_reversed(struct data_block *data)
 {
-	if (current_menu == NULL)
+	if (data->current_menu == NULL)
 		return false;
 
-	current_menu->reversed = true;
+	data->current_menu->reversed = true;
 
 	return true;
 }
@@ -1409,16 +3197,17 @@ bool data_set_menu_reversed(void)
 /**
  * Set the current menu's item height.
  *
+ * \param *data		The data block to use.
  * \param height	The new height.
  * \return		True if the height was set correctly; else False.
  */
 
-bool data_set_menu_item_height(int height)
+bool data_set_menu_item_height(struct data_block *data, int height)
 {
-	if (current_menu == NULL)
+	if (data->current_menu == NULL)
 		return false;
 
-	current_menu->item_height = height;
+	data->current_menu->item_height = height;
 
 	return true;
 }
@@ -1426,16 +3215,17 @@ bool data_set_menu_item_height(int height)
 /**
  * Set the current menu's item gap.
  *
+ * \param *data		The data block to use.
  * \param gap		The new gap.
  * \return		True if the gap was set correctly; else False.
  */
 
-bool data_set_menu_item_gap(int gap)
+bool data_set_menu_item_gap(struct data_block *data, int gap)
 {
-	if (current_menu == NULL)
+	if (data->current_menu == NULL)
 		return false;
 
-	current_menu->item_gap = gap;
+	data->current_menu->item_gap = gap;
 
 	return true;
 }
@@ -1443,15 +3233,16 @@ bool data_set_menu_item_gap(int gap)
 /**
  * Set the current item to be ticked.
  *
+ * \param *data		The data block to use.
  * \return		True if the status was set correctly; else False.
  */
 
-bool data_set_item_ticked(void)
+bool data_set_item_ticked(struct data_block *data)
 {
-	if (current_item == NULL)
+	if (data->current_item == NULL)
 		return false;
 
-	current_item->menu_flags |= wimp_MENU_TICKED;
+	data->current_item->menu_flags |= wimp_MENU_TICKED;
 
 	return true;
 }
@@ -1459,15 +3250,16 @@ bool data_set_item_ticked(void)
 /**
  * Set the current item to be dotted.
  *
+ * \param *data		The data block to use.
  * \return		True if the status was set correctly; else False.
  */
 
-bool data_set_item_dotted(void)
+bool data_set_item_dotted(struct data_block *data)
 {
-	if (current_item == NULL)
+	if (data->current_item == NULL)
 		return false;
 
-	current_item->menu_flags |= wimp_MENU_SEPARATE;
+	data->current_item->menu_flags |= wimp_MENU_SEPARATE;
 
 	return true;
 }
@@ -1475,15 +3267,16 @@ bool data_set_item_dotted(void)
 /**
  * Set the current item to give a submenu warning.
  *
+ * \param *data		The data block to use.
  * \return		True if the status was set correctly; else False.
  */
 
-bool data_set_item_warning(void)
+bool data_set_item_warning(struct data_block *data)
 {
-	if (current_item == NULL)
+	if (data->current_item == NULL)
 		return false;
 
-	current_item->menu_flags |= wimp_MENU_GIVE_WARNING;
+	data->current_item->menu_flags |= wimp_MENU_GIVE_WARNING;
 
 	return true;
 }
@@ -1491,15 +3284,16 @@ bool data_set_item_warning(void)
 /**
  * Set the current item to be available when shaded.
  *
+ * \param *data		The data block to use.
  * \return		True if the status was set correctly; else False.
  */
 
-bool data_set_item_when_shaded(void)
+bool data_set_item_when_shaded(struct data_block *data)
 {
-	if (current_item == NULL)
+	if (data->current_item == NULL)
 		return false;
 
-	current_item->menu_flags |= wimp_MENU_SUB_MENU_WHEN_SHADED;
+	data->current_item->menu_flags |= wimp_MENU_SUB_MENU_WHEN_SHADED;
 
 	return true;
 }
@@ -1507,20 +3301,242 @@ bool data_set_item_when_shaded(void)
 /**
  * Set the current item to be shaded.
  *
+ * \param *data		The data block to use.
  * \return		True if the status was set correctly; else False.
  */
 
-bool data_set_item_shaded(void)
+bool data_set_item_shaded(struct data_block *data)
+{
+	if (data->current_item == NULL)
+		return false;
+
+	data->current_item->icon_flags |= wimp_ICON_SHADED;
+
+	return true;
+}
+
+
+/**
+ * Reverse a list of dialogue box references in place.
+ *
+ * \param *data		The data block holding the list.
+ * \param *list		The first entry in the list to reverse.
+ * \return		The first entry in the reversed list.
+ */
+
+static struct dbox_data *data_reverse_dbox_list(struct data_block *data, struct dbox_data *list)
+{
+	struct dbox_data	*reversed = NULL, *dbox;
+
+	while (list != NULL) {
+		COUNTER_ADD(data->counters, DBOX_ORDER_STEPS, 1);
+
+		dbox = list;
+		list = dbox->next;
+
+		dbox->next = reversed;
+		reversed = dbox;
+	}
+
+	return reversed;
+}
+
+
+/**
+ * Resolve the text of a title or item from the source, looking up any
+ * message token that it contains.
+ *
+ * Param:  *data	The data block to report errors through.
+ * Param:  *messages	The messages to look tokens up in, or NULL.
+ * Param:  *source	The text as given in the source.
+ * Param:  **text	Pointer to a variable to take the resolved text.
+ * Param:  line		The line to report errors against.
+ * Param:  column	The column to report errors against.
+ * Return:		True if the text was resolved; else False.
+ */
+
+static bool data_resolve_text(struct data_block *data, struct messages_block *messages, char *source, char **text, int line, int column)
 {
-	if (current_item == NULL)
+	char	token[MAX_TOKEN_LEN], *fallback;
+	size_t	length;
+
+	*text = source;
+
+	if (messages == NULL || *source != '@')
+		return true;
+
+	if (*(source + 1) == '@') {
+		*text = source + 1;
+		return true;
+	}
+
+	fallback = strchr(source, ':');
+	length = (fallback != NULL) ? fallback - (source + 1) : strlen(source + 1);
+
+	if (length >= MAX_TOKEN_LEN) {
+		report_error(data->report, REPORT_CHECK, line, column, "Message token too long in '%s'", source);
 		return false;
+	}
+
+	memcpy(token, source + 1, length);
+	token[length] = '\0';
 
-	current_item->icon_flags |= wimp_ICON_SHADED;
+	*text = messages_lookup(messages, token);
+
+	if (*text == NULL && fallback != NULL)
+		*text = fallback + 1;
+
+	if (*text == NULL) {
+		report_error(data->report, REPORT_CHECK, line, column, "Undefined message token '%s'", token);
+		*text = source;
+		return false;
+	}
 
 	return true;
 }
 
 
+/**
+ * Transcode the text of a title, item or validation string into a target
+ * encoding, using a buffer attached to the menu or item. Any previous
+ * buffer is released, and ASCII text is used as it stands.
+ *
+ * Param:  *data	The data block to report errors through.
+ * Param:  encoding	The encoding to transcode into.
+ * Param:  **buffer	Pointer to the variable holding the buffer.
+ * Param:  **text	Pointer to the text, updated to the transcoded copy.
+ * Param:  line		The line to report errors against.
+ * Param:  column	The column to report errors against.
+ * Return:		True if the text was transcoded; else False.
+ */
+
+static bool data_encode_text(struct data_block *data, enum encoding_target encoding, char **buffer, char **text, int line, int column)
+{
+	enum encoding_result	result;
+	unsigned long		code = 0;
+
+	if (*buffer != NULL) {
+		memory_release(data->memory, *buffer);
+		*buffer = NULL;
+	}
+
+	if (encoding == ENCODING_NONE || *text == NULL || encoding_is_ascii(*text))
+		return true;
+
+	*buffer = memory_claim(data->memory, MEMORY_STRINGS, strlen(*text) + 1);
+	if (*buffer == NULL)
+		return false;
+
+	result = encoding_transcode(encoding, *buffer, *text, &code);
+
+	if (result == ENCODING_OK) {
+		*text = *buffer;
+		return true;
+	}
+
+	if (result == ENCODING_INVALID)
+		report_error(data->report, REPORT_CHECK, line, column, "Invalid UTF-8 in '%s'", *text);
+	else
+		report_error(data->report, REPORT_CHECK, line, column, "Character U+%04lX in '%s' can not be represented in %s", code, *text, encoding_name(encoding));
+
+	memory_release(data->memory, *buffer);
+	*buffer = NULL;
+
+	return false;
+}
+
+
+/**
+ * Calculate the indirected buffer size required for a title or item. Text
+ * longer than will fit in the block is indirected automatically, and any
+ * size requested with the indirected command is honoured if larger.
+ *
+ * Param:  *text	The text to be displayed.
+ * Param:  indirection	The buffer size requested, or -1 for none.
+ * Return:		The buffer size, or 0 if not indirected.
+ */
+
+static int data_indirected_length(char *text, int indirection)
+{
+	int	length;
+
+	length = strlen(text);
+	length = (length > MAX_DIRECT_TEXT) ? length + 1 : 0;
+
+	if (indirection >= length)
+		length = indirection + 1;
+
+	return length;
+}
+
+
+/**
+ * Turn a piece of text into a C identifier, by upper-casing (or lower-casing)
+ * letters and replacing runs of anything other than letters and digits with a single
+ * underscore. If the identifier is already in the table of names, an
+ * index is appended to make it unique before it is added.
+ *
+ * Param:		Pointer to the table of names in use, or NULL.
+ * Param:		Pointer to a buffer of MAX_IDENTIFIER_LEN bytes, which
+ *			must remain in place while the table of names is used.
+ * Param:		Pointer to the text to convert.
+ * Param:		A character which ends the text, in addition to '\0'.
+ * Param:		The index to append to clashing names.
+ * Param:		True to convert letters to lower case instead.
+ * Return:		Pointer to the buffer.
+ */
+
+static char *data_make_identifier(struct hash_table *names, char *buffer, char *text, char end, int index, bool lower)
+{
+	size_t	length = 0;
+	bool	gap = false;
+
+	while (text != NULL && *text != '\0' && *text != end && length + 1 < MAX_IDENTIFIER_LEN) {
+		if (!isalnum((unsigned char) *text)) {
+			gap = true;
+		} else if (gap && length > 0 && length + 2 >= MAX_IDENTIFIER_LEN) {
+			break;
+		} else {
+			if (gap && length > 0)
+				buffer[length++] = '_';
+
+			buffer[length++] = (lower) ? tolower((unsigned char) *text) : toupper((unsigned char) *text);
+			gap = false;
+		}
+
+		text++;
+	}
+
+	buffer[length] = '\0';
+
+	if (length == 0)
+		strcpy(buffer, (lower) ? "unnamed" : "UNNAMED");
+
+	if (names == NULL)
+		return buffer;
+
+	/* Append the index until the name is unique; the name gets longer
+	 * each time, so if it gets truncated, rely on the index alone.
+	 */
+
+	while (hash_find(names, buffer) != NULL) {
+		length = strlen(buffer);
+
+		if (length + 12 > MAX_IDENTIFIER_LEN)
+			length = 0;
+
+		if (length == 0)
+			snprintf(buffer, MAX_IDENTIFIER_LEN, (lower) ? "unnamed_%d" : "UNNAMED_%d", index);
+		else
+			snprintf(buffer + length, MAX_IDENTIFIER_LEN - length, "_%d", index);
+	}
+
+	hash_insert(names, buffer, buffer);
+
+	return buffer;
+}
+
+
 /**
  * Return a pointer to "Yes" or "No" depending upon the boolean state
  * of value.
@@ -27,30 +27,91 @@
 
 #include <stdbool.h>
 
+#include "counters.h"
+#include "encoding.h"
+#include "memory.h"
+#include "messages.h"
+#include "report.h"
+
 #define MAX_TAG_LEN 32
 #define MAX_TEMPLATE_NAME 16
 
-bool data_collate_structures(bool embed_tag, bool embed_dbox, bool verbose);
-void data_print_structure_report(void);
-bool data_write_standard_menu_file(char *filename);
-
-bool data_create_new_menu(char *tag, char *title);
-bool data_create_new_item(char *text);
-bool data_set_item_submenu(char *tag, bool dbox);
-bool data_set_menu_title_indirection(int size);
-bool data_set_item_indirection(int size);
-bool data_set_item_writable(void);
-bool data_set_item_validation(char *validation);
-bool data_set_menu_colours(int title_fg, int title_bg, int work_fg, int work_bg);
-bool data_set_item_colours(int icon_fg, int icon_bg);
-bool data_set_menu_reversed(void);
-bool data_set_menu_item_height(int height);
-bool data_set_menu_item_gap(int gap);
-bool data_set_item_ticked(void);
-bool data_set_item_dotted(void);
-bool data_set_item_warning(void);
-bool data_set_item_when_shaded(void);
-bool data_set_item_shaded(void);
+/**
+ * The shard number used to select all of the menus at once.
+ */
+
+#define DATA_ALL_SHARDS -1
+
+struct data_block;
+
+/**
+ * The forms in which a menu definition file can be written.
+ */
+
+enum data_format {
+	DATA_FORMAT_MENUS = 0,		/**< A binary Menus file.				*/
+	DATA_FORMAT_C,			/**< C source, holding the file in an array.		*/
+	DATA_FORMAT_ASM,		/**< GNU assembler source, holding the file as data.	*/
+	DATA_FORMAT_UNKNOWN		/**< An unrecognised format name.			*/
+};
+
+/**
+ * Statistics about the menus held in a data block, and the size of each
+ * of the sections of the Menus file that they collate into.
+ */
+
+struct data_statistics {
+	int		menus;			/**< The number of menus.				*/
+	int		items;			/**< The number of menu items.				*/
+	int		indirected;		/**< The number of indirected titles and items.		*/
+	int		validations;		/**< The number of validation strings.			*/
+	int		dialogues;		/**< The number of dialogue box references.		*/
+
+	int		head_bytes;		/**< The size of the file header.			*/
+	int		menu_bytes;		/**< The size of the menu and item blocks.		*/
+	int		indirection_bytes;	/**< The size of the indirected data.			*/
+	int		validation_bytes;	/**< The size of the validation strings.		*/
+	int		dialogue_tag_bytes;	/**< The size of the embedded dialogue box tags.	*/
+	int		menu_tag_bytes;		/**< The size of the embedded menu tags.		*/
+	int		file_bytes;		/**< The size of the whole file.			*/
+
+	int		longest_indirection;	/**< The longest indirected data block.			*/
+	int		longest_validation;	/**< The longest validation string block.		*/
+	int		longest_dbox_chain;	/**< The longest dialogue box tag block.		*/
+	int		longest_menu_tag;	/**< The longest menu tag block.			*/
+};
+
+struct data_block *data_create(struct report_block *report, struct memory_block *memory, struct counter_block *counters);
+void data_destroy(struct data_block *data);
+bool data_check_references(struct data_block *data);
+bool data_localise(struct data_block *data, struct messages_block *messages, enum encoding_target encoding);
+bool data_collate_structures(struct data_block *data, bool embed_tag, bool embed_dbox, bool relocate, unsigned base, bool compact, bool verbose);
+void data_print_structure_report(struct data_block *data);
+void data_get_statistics(struct data_block *data, struct data_statistics *statistics);
+enum data_format data_find_format(char *name);
+bool data_write_standard_menu_file(struct data_block *data, char *filename, enum data_format format, char *symbol, bool compress, bool changes_only);
+bool data_write_c_header(struct data_block *data, char *filename, char *menus, bool changes_only);
+int data_assign_shards(struct data_block *data);
+bool data_select_shard(struct data_block *data, int shard);
+bool data_write_shard_manifest(struct data_block *data, char *filename, bool changes_only);
+
+bool data_create_new_menu(struct data_block *data, char *tag, char *title, int line, int column);
+bool data_create_new_item(struct data_block *data, char *text, int line, int column);
+bool data_set_item_submenu(struct data_block *data, char *tag, bool dbox, int line, int column);
+bool data_set_menu_title_indirection(struct data_block *data, int size);
+bool data_set_item_indirection(struct data_block *data, int size);
+bool data_set_item_writable(struct data_block *data);
+bool data_set_item_validation(struct data_block *data, char *validation);
+bool data_set_menu_colours(struct data_block *data, int title_fg, int title_bg, int work_fg, int work_bg);
+bool data_set_item_colours(struct data_block *data, int icon_fg, int icon_bg);
+bool data_set_menu_reversed(struct data_block *data);
+bool data_set_menu_item_height(struct data_block *data, int height);
+bool data_set_menu_item_gap(struct data_block *data, int gap);
+bool data_set_item_ticked(struct data_block *data);
+bool data_set_item_dotted(struct data_block *data);
+bool data_set_item_warning(struct data_block *data);
+bool data_set_item_when_shaded(struct data_block *data);
+bool data_set_item_shaded(struct data_block *data);
 
 #endif
 
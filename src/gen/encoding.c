@@ -0,0 +1,343 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+/**
+ * Transcoding of UTF-8 text from the source and Messages files into the
+ * 8-bit alphabets used by the RISC OS Wimp. Every character takes a single
+ * byte in the target, so text never grows and can be transcoded into a
+ * buffer the size of the original.
+ *
+ * Most menu text is plain ASCII, which is the same in every target, so the
+ * text is scanned a word at a time until a byte with its top bit set turns
+ * up. This only uses integer operations, so works the same on ARM as on
+ * the host compilers.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Local source headers. */
+
+#include "encoding.h"
+
+/**
+ * A mask with the top bit of each byte in a 64-bit word set.
+ */
+
+#define ENCODING_HIGH_BITS 0x8080808080808080ull
+
+/**
+ * A mapping from a Unicode code point to a byte in a target alphabet.
+ */
+
+struct encoding_map {
+	unsigned long	code;		/**< The Unicode code point.		*/
+	unsigned char	byte;		/**< The byte in the target alphabet.	*/
+};
+
+/**
+ * The characters which RISC OS Latin1 adds in the range 0x80 to 0x9f, which
+ * ISO 8859-1 leaves for control codes.
+ */
+
+static const struct encoding_map encoding_riscos_extras[] = {
+	{0x20ac, 0x80}, {0x0174, 0x81}, {0x0175, 0x82}, {0x0176, 0x85},
+	{0x0177, 0x86}, {0x2026, 0x8c}, {0x2122, 0x8d}, {0x2030, 0x8e},
+	{0x2022, 0x8f}, {0x2018, 0x90}, {0x2019, 0x91}, {0x2039, 0x92},
+	{0x203a, 0x93}, {0x201c, 0x94}, {0x201d, 0x95}, {0x201e, 0x96},
+	{0x2013, 0x97}, {0x2014, 0x98}, {0x2212, 0x99}, {0x0152, 0x9a},
+	{0x0153, 0x9b}, {0x2020, 0x9c}, {0x2021, 0x9d}, {0xfb01, 0x9e},
+	{0xfb02, 0x9f}, {0, 0}
+};
+
+/**
+ * The characters which ISO 8859-15 places over eight of those in ISO 8859-1.
+ */
+
+static const struct encoding_map encoding_latin9_extras[] = {
+	{0x20ac, 0xa4}, {0x0160, 0xa6}, {0x0161, 0xa8}, {0x017d, 0xb4},
+	{0x017e, 0xb8}, {0x0152, 0xbc}, {0x0153, 0xbd}, {0x0178, 0xbe},
+	{0, 0}
+};
+
+static int encoding_decode(unsigned char *in, unsigned long *code);
+static bool encoding_map_code(enum encoding_target target, unsigned long code, unsigned char *byte);
+static bool encoding_search_map(const struct encoding_map *map, unsigned long code, unsigned char *byte);
+
+/**
+ * Find an encoding from its name.
+ *
+ * \param *name		The name of the encoding.
+ * \return		The encoding, or ENCODING_UNKNOWN.
+ */
+
+enum encoding_target encoding_find(char *name)
+{
+	if (strcmp(name, "utf8") == 0)
+		return ENCODING_NONE;
+	else if (strcmp(name, "latin1") == 0)
+		return ENCODING_LATIN1;
+	else if (strcmp(name, "iso8859-1") == 0)
+		return ENCODING_ISO8859_1;
+	else if (strcmp(name, "latin9") == 0)
+		return ENCODING_LATIN9;
+
+	return ENCODING_UNKNOWN;
+}
+
+/**
+ * Return a readable name for an encoding, for use in messages.
+ *
+ * \param target	The encoding to name.
+ * \return		Pointer to the name.
+ */
+
+char *encoding_name(enum encoding_target target)
+{
+	switch (target) {
+	case ENCODING_NONE:
+		return "UTF-8";
+	case ENCODING_LATIN1:
+		return "RISC OS Latin1";
+	case ENCODING_ISO8859_1:
+		return "ISO 8859-1";
+	case ENCODING_LATIN9:
+		return "ISO 8859-15";
+	default:
+		return "Unknown";
+	}
+}
+
+/**
+ * Test whether a string is entirely 7-bit ASCII, in which case it is the
+ * same in every encoding.
+ *
+ * \param *text		The string to test.
+ * \return		True if the string is ASCII; else False.
+ */
+
+bool encoding_is_ascii(char *text)
+{
+	size_t		length, position = 0;
+	uint64_t	word;
+
+	length = strlen(text);
+
+	for (; position + sizeof(uint64_t) <= length; position += sizeof(uint64_t)) {
+		memcpy(&word, text + position, sizeof(uint64_t));
+		if ((word & ENCODING_HIGH_BITS) != 0)
+			return false;
+	}
+
+	for (; position < length; position++) {
+		if ((unsigned char) text[position] >= 0x80)
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Transcode a UTF-8 string into a target encoding.
+ *
+ * \param target	The encoding to transcode into.
+ * \param *out		Pointer to a buffer to take the transcoded string,
+ *			which must be at least as long as the original.
+ * \param *in		The UTF-8 string to transcode.
+ * \param *code		Pointer to a variable to take the code point of an
+ *			unmappable character, or NULL.
+ * \return		The outcome of the transcoding.
+ */
+
+enum encoding_result encoding_transcode(enum encoding_target target, char *out, char *in, unsigned long *code)
+{
+	size_t		length, position = 0;
+	uint64_t	word;
+	unsigned long	character;
+	unsigned char	byte;
+	int		bytes;
+
+	length = strlen(in);
+
+	while (position < length) {
+		/* Copy runs of ASCII a word at a time. */
+
+		while (position + sizeof(uint64_t) <= length) {
+			memcpy(&word, in + position, sizeof(uint64_t));
+			if ((word & ENCODING_HIGH_BITS) != 0)
+				break;
+
+			memcpy(out, &word, sizeof(uint64_t));
+			out += sizeof(uint64_t);
+			position += sizeof(uint64_t);
+		}
+
+		if (position >= length)
+			break;
+
+		if ((unsigned char) in[position] < 0x80) {
+			*out++ = in[position++];
+			continue;
+		}
+
+		bytes = encoding_decode((unsigned char *) in + position, &character);
+		if (bytes == 0)
+			return ENCODING_INVALID;
+
+		if (target == ENCODING_NONE) {
+			memcpy(out, in + position, bytes);
+			out += bytes;
+		} else if (encoding_map_code(target, character, &byte)) {
+			*out++ = byte;
+		} else {
+			if (code != NULL)
+				*code = character;
+			return ENCODING_UNMAPPABLE;
+		}
+
+		position += bytes;
+	}
+
+	*out = '\0';
+
+	return ENCODING_OK;
+}
+
+/**
+ * Decode a multi-byte UTF-8 sequence, rejecting overlong forms, surrogates
+ * and code points beyond the Unicode range.
+ *
+ * \param *in		The first byte of the sequence.
+ * \param *code		Pointer to a variable to take the code point.
+ * \return		The length of the sequence, or 0 if invalid.
+ */
+
+static int encoding_decode(unsigned char *in, unsigned long *code)
+{
+	unsigned long	character, minimum;
+	int		bytes, i;
+
+	if ((*in & 0xe0) == 0xc0) {
+		bytes = 2;
+		character = *in & 0x1f;
+		minimum = 0x80;
+	} else if ((*in & 0xf0) == 0xe0) {
+		bytes = 3;
+		character = *in & 0x0f;
+		minimum = 0x800;
+	} else if ((*in & 0xf8) == 0xf0) {
+		bytes = 4;
+		character = *in & 0x07;
+		minimum = 0x10000;
+	} else {
+		return 0;
+	}
+
+	/* The terminator fails this test, so we can't run off the end. */
+
+	for (i = 1; i < bytes; i++) {
+		if ((in[i] & 0xc0) != 0x80)
+			return 0;
+
+		character = (character << 6) | (in[i] & 0x3f);
+	}
+
+	if (character < minimum || character > 0x10ffff || (character >= 0xd800 && character <= 0xdfff))
+		return 0;
+
+	*code = character;
+
+	return bytes;
+}
+
+/**
+ * Find the byte which represents a code point in a target encoding.
+ *
+ * \param target	The encoding to map into.
+ * \param code		The code point to map, which is not ASCII.
+ * \param *byte		Pointer to a variable to take the byte.
+ * \return		True if the code point can be represented; else False.
+ */
+
+static bool encoding_map_code(enum encoding_target target, unsigned long code, unsigned char *byte)
+{
+	switch (target) {
+	case ENCODING_LATIN1:
+		if (code >= 0xa0 && code <= 0xff) {
+			*byte = code;
+			return true;
+		}
+
+		return encoding_search_map(encoding_riscos_extras, code, byte);
+
+	case ENCODING_ISO8859_1:
+		if (code >= 0xa0 && code <= 0xff) {
+			*byte = code;
+			return true;
+		}
+
+		return false;
+
+	case ENCODING_LATIN9:
+		if (encoding_search_map(encoding_latin9_extras, code, byte))
+			return true;
+
+		/* The positions taken by the extras no longer hold their
+		 * ISO 8859-1 characters.
+		 */
+
+		if (code >= 0xa0 && code <= 0xff && code != 0xa4 && code != 0xa6 && code != 0xa8 &&
+				code != 0xb4 && code != 0xb8 && code != 0xbc && code != 0xbd && code != 0xbe) {
+			*byte = code;
+			return true;
+		}
+
+		return false;
+
+	default:
+		return false;
+	}
+}
+
+/**
+ * Search a table of extra characters for a code point.
+ *
+ * \param *map		The table to search, terminated by a zero code.
+ * \param code		The code point to find.
+ * \param *byte		Pointer to a variable to take the byte.
+ * \return		True if the code point was found; else False.
+ */
+
+static bool encoding_search_map(const struct encoding_map *map, unsigned long code, unsigned char *byte)
+{
+	for (; map->code != 0; map++) {
+		if (map->code == code) {
+			*byte = map->byte;
+			return true;
+		}
+	}
+
+	return false;
+}
+
@@ -0,0 +1,57 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+#ifndef MENUGEN_ENCODING_H
+#define MENUGEN_ENCODING_H
+
+#include <stdbool.h>
+
+/**
+ * The character sets which text can be transcoded into.
+ */
+
+enum encoding_target {
+	ENCODING_NONE = 0,		/**< Leave the text unchanged.				*/
+	ENCODING_LATIN1,		/**< The RISC OS Latin1 alphabet.			*/
+	ENCODING_ISO8859_1,		/**< Strict ISO 8859-1.					*/
+	ENCODING_LATIN9,		/**< ISO 8859-15, with the Euro sign.			*/
+	ENCODING_UNKNOWN		/**< An unrecognised encoding name.			*/
+};
+
+/**
+ * The outcomes of transcoding a string.
+ */
+
+enum encoding_result {
+	ENCODING_OK,			/**< The text was transcoded.				*/
+	ENCODING_INVALID,		/**< The text was not valid UTF-8.			*/
+	ENCODING_UNMAPPABLE		/**< A character has no equivalent in the target.	*/
+};
+
+enum encoding_target encoding_find(char *name);
+char *encoding_name(enum encoding_target target);
+bool encoding_is_ascii(char *text);
+enum encoding_result encoding_transcode(enum encoding_target target, char *out, char *in, unsigned long *code);
+
+#endif
+
@@ -0,0 +1,275 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+/**
+ * Hash tables, used to index the tags in a compilation so that they can be
+ * looked up in constant time however many menus there are. The keys are not
+ * copied, so they must remain valid for the life of the table.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local source headers. */
+
+#include "hash.h"
+
+#include "memory.h"
+
+/**
+ * The number of buckets in a new table.
+ */
+
+#define HASH_INITIAL_SIZE 64
+
+struct hash_entry {
+	char			*key;		/**< The key for the entry.			*/
+	void			*value;		/**< The value stored against the key.		*/
+	uint32_t		hash;		/**< The full hash of the key.			*/
+
+	struct hash_entry	*next;		/**< The next entry in the same bucket.		*/
+};
+
+struct hash_table {
+	struct memory_block	*memory;	/**< The memory block to allocate from.		*/
+	unsigned long		*probes;	/**< A counter for key comparisons, or NULL.	*/
+
+	struct hash_entry	**buckets;	/**< The bucket array.				*/
+	unsigned		size;		/**< The number of buckets; a power of two.	*/
+	unsigned		count;		/**< The number of entries in the table.	*/
+};
+
+static uint32_t hash_key(char *key);
+static bool hash_grow(struct hash_table *table);
+
+/**
+ * Create a new, empty hash table.
+ *
+ * \param *memory	The memory block to allocate from.
+ * \param *probes	A counter to increment for each key comparison, or NULL.
+ * \return		Pointer to the new table, or NULL on failure.
+ */
+
+struct hash_table *hash_create(struct memory_block *memory, unsigned long *probes)
+{
+	struct hash_table	*table;
+
+	table = memory_claim(memory, MEMORY_INDEXES, sizeof(struct hash_table));
+	if (table == NULL)
+		return NULL;
+
+	table->buckets = memory_claim(memory, MEMORY_INDEXES, HASH_INITIAL_SIZE * sizeof(struct hash_entry *));
+	if (table->buckets == NULL) {
+		memory_release(memory, table);
+		return NULL;
+	}
+
+	memset(table->buckets, 0, HASH_INITIAL_SIZE * sizeof(struct hash_entry *));
+
+	table->memory = memory;
+	table->probes = probes;
+	table->size = HASH_INITIAL_SIZE;
+	table->count = 0;
+
+	return table;
+}
+
+/**
+ * Destroy a hash table, freeing the memory that it uses. The keys and
+ * values are not touched.
+ *
+ * \param *table	The table to destroy.
+ */
+
+void hash_destroy(struct hash_table *table)
+{
+	if (table == NULL)
+		return;
+
+	hash_clear(table);
+
+	memory_release(table->memory, table->buckets);
+	memory_release(table->memory, table);
+}
+
+/**
+ * Remove all of the entries from a hash table, leaving it empty but keeping
+ * its buckets for re-use. The keys and values are not touched.
+ *
+ * \param *table	The table to clear.
+ */
+
+void hash_clear(struct hash_table *table)
+{
+	struct hash_entry	*entry;
+	unsigned		bucket;
+
+	if (table == NULL)
+		return;
+
+	for (bucket = 0; bucket < table->size; bucket++) {
+		while (table->buckets[bucket] != NULL) {
+			entry = table->buckets[bucket];
+			table->buckets[bucket] = entry->next;
+			memory_release(table->memory, entry);
+		}
+	}
+
+	table->count = 0;
+}
+
+/**
+ * Add a key to a hash table. If the key is already present, the value that
+ * was stored first is kept, so that lookups always find the first entry.
+ *
+ * \param *table	The table to add to.
+ * \param *key		The key to add.
+ * \param *value	The value to store against the key.
+ * \return		True if successful; else False.
+ */
+
+bool hash_insert(struct hash_table *table, char *key, void *value)
+{
+	struct hash_entry	*entry;
+	uint32_t		hash;
+
+	if (table == NULL || key == NULL)
+		return false;
+
+	hash = hash_key(key);
+
+	for (entry = table->buckets[hash & (table->size - 1)]; entry != NULL; entry = entry->next) {
+		if (table->probes != NULL)
+			(*(table->probes))++;
+
+		if (entry->hash == hash && strcmp(entry->key, key) == 0)
+			return true;
+	}
+
+	if (table->count >= table->size && !hash_grow(table))
+		return false;
+
+	entry = memory_claim(table->memory, MEMORY_INDEXES, sizeof(struct hash_entry));
+	if (entry == NULL)
+		return false;
+
+	entry->key = key;
+	entry->value = value;
+	entry->hash = hash;
+
+	entry->next = table->buckets[hash & (table->size - 1)];
+	table->buckets[hash & (table->size - 1)] = entry;
+	table->count++;
+
+	return true;
+}
+
+/**
+ * Find the value stored against a key in a hash table.
+ *
+ * \param *table	The table to search.
+ * \param *key		The key to find.
+ * \return		The value stored against the key, or NULL if not found.
+ */
+
+void *hash_find(struct hash_table *table, char *key)
+{
+	struct hash_entry	*entry;
+	uint32_t		hash;
+
+	if (table == NULL || key == NULL)
+		return NULL;
+
+	hash = hash_key(key);
+
+	for (entry = table->buckets[hash & (table->size - 1)]; entry != NULL; entry = entry->next) {
+		if (table->probes != NULL)
+			(*(table->probes))++;
+
+		if (entry->hash == hash && strcmp(entry->key, key) == 0)
+			return entry->value;
+	}
+
+	return NULL;
+}
+
+/**
+ * Double the number of buckets in a hash table, redistributing the entries
+ * between them. If the memory can't be found, the table is left as it was.
+ *
+ * \param *table	The table to grow.
+ * \return		True if successful; else False.
+ */
+
+static bool hash_grow(struct hash_table *table)
+{
+	struct hash_entry	**buckets, *entry;
+	unsigned		size, bucket;
+
+	size = table->size * 2;
+
+	buckets = memory_claim(table->memory, MEMORY_INDEXES, size * sizeof(struct hash_entry *));
+	if (buckets == NULL)
+		return false;
+
+	memset(buckets, 0, size * sizeof(struct hash_entry *));
+
+	for (bucket = 0; bucket < table->size; bucket++) {
+		while (table->buckets[bucket] != NULL) {
+			entry = table->buckets[bucket];
+			table->buckets[bucket] = entry->next;
+
+			entry->next = buckets[entry->hash & (size - 1)];
+			buckets[entry->hash & (size - 1)] = entry;
+		}
+	}
+
+	memory_release(table->memory, table->buckets);
+
+	table->buckets = buckets;
+	table->size = size;
+
+	return true;
+}
+
+/**
+ * Calculate the FNV-1a hash of a key.
+ *
+ * \param *key		The key to hash.
+ * \return		The hash of the key.
+ */
+
+static uint32_t hash_key(char *key)
+{
+	uint32_t	hash = 2166136261u;
+
+	while (*key != '\0') {
+		hash ^= (unsigned char) *key++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
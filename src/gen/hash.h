@@ -0,0 +1,40 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+#ifndef MENUGEN_HASH_H
+#define MENUGEN_HASH_H
+
+#include <stdbool.h>
+
+#include "memory.h"
+
+struct hash_table;
+
+struct hash_table *hash_create(struct memory_block *memory, unsigned long *probes);
+void hash_destroy(struct hash_table *table);
+void hash_clear(struct hash_table *table);
+bool hash_insert(struct hash_table *table, char *key, void *value);
+void *hash_find(struct hash_table *table, char *key);
+
+#endif
+
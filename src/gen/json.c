@@ -0,0 +1,64 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+/**
+ * Support for writing JSON output files.
+ */
+
+#include <stdio.h>
+
+/* Local source headers. */
+
+#include "json.h"
+
+/**
+ * Write a string to a file as a quoted JSON string, escaping any characters
+ * which need it.
+ *
+ * \param *file		The file to write to.
+ * \param *text		The string to write, or NULL to write null.
+ */
+
+void json_write_string(FILE *file, char *text)
+{
+	unsigned char	c;
+
+	if (text == NULL) {
+		fputs("null", file);
+		return;
+	}
+
+	fputc('"', file);
+
+	while ((c = *text++) != '\0') {
+		if (c == '"' || c == '\\')
+			fprintf(file, "\\%c", c);
+		else if (c < 32)
+			fprintf(file, "\\u%04x", c);
+		else
+			fputc(c, file);
+	}
+
+	fputc('"', file);
+}
+
@@ -0,0 +1,260 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+/**
+ * Instrumented memory allocation, which counts the allocations made by
+ * a compilation in categories, so that the live and peak usage of each
+ * type of structure can be reported.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local source headers. */
+
+#include "memory.h"
+
+/**
+ * The header placed in front of each allocation, padded so that the memory
+ * following it is suitably aligned for any type.
+ */
+
+union memory_header {
+	struct {
+		size_t			size;		/**< The size of the allocation.		*/
+		enum memory_category	category;	/**< The category of the allocation.		*/
+	} block;
+	long double			align_float;	/**< Force alignment for floating point.	*/
+	void				*align_pointer;	/**< Force alignment for pointers.		*/
+	long long			align_integer;	/**< Force alignment for integers.		*/
+};
+
+struct memory_block {
+	struct memory_statistics	statistics;	/**< The allocation counts.			*/
+};
+
+static void memory_update_usage(struct memory_usage *usage, size_t size, bool claim);
+
+/**
+ * The names of the memory categories, in the order of enum memory_category.
+ */
+
+static char *memory_category_names[] = {
+	"menus",
+	"items",
+	"strings",
+	"sections",
+	"scratch",
+	"indexes",
+	"buffers"
+};
+
+/**
+ * Create a new memory block, to track a set of allocations.
+ *
+ * \return		Pointer to the new block, or NULL on failure.
+ */
+
+struct memory_block *memory_create(void)
+{
+	struct memory_block	*memory;
+
+	memory = malloc(sizeof(struct memory_block));
+	if (memory == NULL)
+		return NULL;
+
+	memset(&memory->statistics, 0, sizeof(struct memory_statistics));
+
+	return memory;
+}
+
+/**
+ * Destroy a memory block. Any allocations still outstanding are not freed,
+ * and must have been released by their owners beforehand.
+ *
+ * \param *memory	The memory block to destroy.
+ */
+
+void memory_destroy(struct memory_block *memory)
+{
+	if (memory == NULL)
+		return;
+
+	free(memory);
+}
+
+/**
+ * Claim memory, recording the allocation against a category. Allocations
+ * can be made without a memory block, in which case they are not counted.
+ *
+ * \param *memory	The memory block to record the allocation in, or NULL.
+ * \param category	The category of the allocation.
+ * \param size		The number of bytes to claim.
+ * \return		Pointer to the claimed memory, or NULL on failure.
+ */
+
+void *memory_claim(struct memory_block *memory, enum memory_category category, size_t size)
+{
+	union memory_header	*header;
+
+	if (category < 0 || category >= MEMORY_CATEGORIES)
+		return NULL;
+
+	header = malloc(sizeof(union memory_header) + size);
+	if (header == NULL)
+		return NULL;
+
+	header->block.size = size;
+	header->block.category = category;
+
+	if (memory != NULL) {
+		memory_update_usage(&memory->statistics.category[category], size, true);
+		memory_update_usage(&memory->statistics.total, size, true);
+	}
+
+	return header + 1;
+}
+
+/**
+ * Change the size of memory claimed by memory_claim(), keeping its category
+ * and contents. If the resize fails, the original memory is left intact.
+ *
+ * \param *memory	The memory block which the allocation was recorded
+ *			in, or NULL.
+ * \param *block	The memory to resize.
+ * \param size		The new number of bytes required.
+ * \return		Pointer to the resized memory, or NULL on failure.
+ */
+
+void *memory_resize(struct memory_block *memory, void *block, size_t size)
+{
+	union memory_header	*header;
+	size_t			old_size;
+
+	if (block == NULL)
+		return NULL;
+
+	header = (union memory_header *) block - 1;
+	old_size = header->block.size;
+
+	header = realloc(header, sizeof(union memory_header) + size);
+	if (header == NULL)
+		return NULL;
+
+	header->block.size = size;
+
+	/* Count the new size as a fresh allocation, so that the peak covers
+	 * the point at which the data is copied from the old block.
+	 */
+
+	if (memory != NULL) {
+		memory_update_usage(&memory->statistics.category[header->block.category], size, true);
+		memory_update_usage(&memory->statistics.total, size, true);
+		memory_update_usage(&memory->statistics.category[header->block.category], old_size, false);
+		memory_update_usage(&memory->statistics.total, old_size, false);
+	}
+
+	return header + 1;
+}
+
+/**
+ * Release memory claimed by memory_claim().
+ *
+ * \param *memory	The memory block which the allocation was recorded
+ *			in, or NULL.
+ * \param *block	The memory to release, or NULL for none.
+ */
+
+void memory_release(struct memory_block *memory, void *block)
+{
+	union memory_header	*header;
+
+	if (block == NULL)
+		return;
+
+	header = (union memory_header *) block - 1;
+
+	if (memory != NULL) {
+		memory_update_usage(&memory->statistics.category[header->block.category], header->block.size, false);
+		memory_update_usage(&memory->statistics.total, header->block.size, false);
+	}
+
+	free(header);
+}
+
+/**
+ * Return the allocation counts recorded in a memory block.
+ *
+ * \param *memory	The memory block to report on.
+ * \param *statistics	Pointer to a block to take the counts.
+ */
+
+void memory_get_statistics(struct memory_block *memory, struct memory_statistics *statistics)
+{
+	if (statistics == NULL)
+		return;
+
+	if (memory != NULL)
+		*statistics = memory->statistics;
+	else
+		memset(statistics, 0, sizeof(struct memory_statistics));
+}
+
+/**
+ * Return the name of a memory category.
+ *
+ * \param category	The category to name.
+ * \return		Pointer to the name of the category.
+ */
+
+char *memory_category_name(enum memory_category category)
+{
+	if (category < 0 || category >= MEMORY_CATEGORIES)
+		return "unknown";
+
+	return memory_category_names[category];
+}
+
+/**
+ * Update a set of usage counts to reflect an allocation or a release.
+ *
+ * \param *usage	The usage counts to update.
+ * \param size		The size of the allocation.
+ * \param claim		True if the memory was claimed; False if released.
+ */
+
+static void memory_update_usage(struct memory_usage *usage, size_t size, bool claim)
+{
+	if (claim) {
+		usage->allocations++;
+		usage->allocated += size;
+		usage->live += size;
+
+		if (usage->live > usage->peak)
+			usage->peak = usage->live;
+	} else {
+		usage->live -= size;
+	}
+}
+
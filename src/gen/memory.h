@@ -0,0 +1,75 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+#ifndef MENUGEN_MEMORY_H
+#define MENUGEN_MEMORY_H
+
+#include <stddef.h>
+
+/**
+ * The categories into which memory allocations are divided.
+ */
+
+enum memory_category {
+	MEMORY_MENUS = 0,		/**< Menu definitions.					*/
+	MEMORY_ITEMS,			/**< Menu item definitions.				*/
+	MEMORY_STRINGS,			/**< Titles, item text and validation strings.		*/
+	MEMORY_SECTIONS,		/**< Records used to collate the file sections.		*/
+	MEMORY_SCRATCH,			/**< Temporary space used while parsing parameters.	*/
+	MEMORY_INDEXES,			/**< Hash tables used to look up tags.			*/
+	MEMORY_BUFFERS,			/**< Source files and output buffers.			*/
+	MEMORY_CATEGORIES		/**< The number of categories; must be last.		*/
+};
+
+/**
+ * The allocation counts for one category of memory.
+ */
+
+struct memory_usage {
+	int		allocations;		/**< The number of allocations made.			*/
+	size_t		allocated;		/**< The total number of bytes allocated.		*/
+	size_t		live;			/**< The number of bytes currently allocated.		*/
+	size_t		peak;			/**< The largest number of bytes allocated at once.	*/
+};
+
+/**
+ * The allocation counts for a memory block, by category and in total.
+ */
+
+struct memory_statistics {
+	struct memory_usage	category[MEMORY_CATEGORIES];	/**< The usage for each category.	*/
+	struct memory_usage	total;				/**< The usage across all categories.	*/
+};
+
+struct memory_block;
+
+struct memory_block *memory_create(void);
+void memory_destroy(struct memory_block *memory);
+void *memory_claim(struct memory_block *memory, enum memory_category category, size_t size);
+void *memory_resize(struct memory_block *memory, void *block, size_t size);
+void memory_release(struct memory_block *memory, void *block);
+void memory_get_statistics(struct memory_block *memory, struct memory_statistics *statistics);
+char *memory_category_name(enum memory_category category);
+
+#endif
+
@@ -27,12 +27,33 @@
  * environment.
  *
  * Syntax: MenuGen <source> <output> [<options>]
+ *         MenuGen -batch <jobfile> [<options>]
+ *         MenuGen -check <source> [<options>]
  *
- * Options -d  - Embed dialogue box names into the output
- *         -m  - Embed menu names into the output
- *         -v  - Produce verbose output
+ * Options -d      - Embed dialogue box names into the output
+ *         -m      - Embed menu names into the output
+ *         -v      - Produce verbose output
+ *         -watch  - Watch the source files, and rebuild on changes
+ *         -variant <output>
+ *                 - Also write the menus to another file, with the
+ *                   -d and -m options which follow
+ *
+ * Each variant is collated and written from the same parsed source, so
+ * several forms of a Menus file can be built without parsing it again.
+ *
+ * In batch mode, each line of the job file contains a source and output
+ * filename, optionally followed by options which apply to that job in
+ * addition to those given on the command line.
+ *
+ * In check mode, the source file is parsed and its references checked,
+ * but no output is generated.
+ *
+ * A source of "-" is read from standard input, and an output of "-" is
+ * written to standard output. All messages go to standard error, so that
+ * they can never become mixed up with the output.
  */
 
+#include <errno.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -44,63 +65,1167 @@
 
 /* Local source headers. */
 
-#include "data.h"
-#include "parse.h"
-#include "stack.h"
+#include "buffer.h"
+#include "compile.h"
+#include "encoding.h"
+#include "memory.h"
+#include "stats.h"
+#include "trace.h"
+#include "watch.h"
+
+
+#define BATCH_LINE_BLOCK 1024
+#define BATCH_PARAMS_BLOCK 16
+#define MAX_VARIANTS 8
+
+/**
+ * An additional output variant for a job.
+ */
+
+struct menugen_variant {
+	char			*output;		/**< The name of the output file.			*/
+	bool			embed_dialogue_names;	/**< True to embed dialogue names in the output.	*/
+	bool			embed_menu_names;	/**< True to embed menu names in the output.		*/
+	char			*messages;		/**< The Messages file to localise with, or NULL.	*/
+	enum encoding_target	encoding;		/**< The encoding to transcode the text into.		*/
+	char			*header;		/**< The C header file to write, or NULL.		*/
+	enum data_format	format;			/**< The form in which to write the output.		*/
+	char			*symbol;		/**< The symbol for source formats, or NULL.		*/
+	bool			relocate;		/**< True to relocate the output to a fixed address.	*/
+	unsigned		base;			/**< The address to relocate the output to.		*/
+	char			*shards;		/**< The shard manifest to write, or NULL.		*/
+	bool			compress;		/**< True to write the output in a compressed container. */
+	bool			compact;		/**< True to write the output in the compact format.	*/
+};
+
+/**
+ * The options which can be applied to a job.
+ */
+
+struct menugen_options {
+	bool			embed_dialogue_names;	/**< True to embed dialogue names in the output.	*/
+	bool			embed_menu_names;	/**< True to embed menu names in the output.		*/
+	char			*messages;		/**< The Messages file to localise with, or NULL.	*/
+	enum encoding_target	encoding;		/**< The encoding to transcode the text into.		*/
+	char			*header;		/**< The C header file to write, or NULL.		*/
+	enum data_format	format;			/**< The form in which to write the output.		*/
+	char			*symbol;		/**< The symbol for source formats, or NULL.		*/
+	bool			relocate;		/**< True to relocate the output to a fixed address.	*/
+	unsigned		base;			/**< The address to relocate the output to.		*/
+	char			*shards;		/**< The shard manifest to write, or NULL.		*/
+	bool			compress;		/**< True to write the output in a compressed container. */
+	bool			compact;		/**< True to write the output in the compact format.	*/
+	bool			verbose_output;		/**< True to produce verbose output.			*/
+	unsigned		verbose_subsystems;	/**< The subsystems to produce verbose output for.	*/
+	bool			check_only;		/**< True to check the source without compiling it.	*/
+	bool			time_phases;		/**< True to report the time taken by each phase.	*/
+	int			variants;		/**< The number of additional output variants.		*/
+	struct menugen_variant	variant[MAX_VARIANTS];	/**< The additional output variants.			*/
+};
+
+/**
+ * The settings which apply to the whole run, rather than to individual jobs.
+ */
+
+struct menugen_settings {
+	bool			watch_mode;		/**< True to watch the sources for changes.		*/
+	char			*trace_file;		/**< The name of the trace file to write, or NULL.	*/
+	char			*stats_file;		/**< The name of the statistics file to write, or NULL.	*/
+};
+
+/**
+ * The diagnostic outputs which record details of the jobs processed.
+ */
+
+struct menugen_diagnostics {
+	struct trace_block	*trace;			/**< The trace to record events in, or NULL.		*/
+	struct stats_block	*stats;			/**< The statistics file to write to, or NULL.		*/
+};
+
+/**
+ * A compilation job.
+ */
+
+struct menugen_job {
+	char			*source;		/**< The name of the source file.			*/
+	char			*output;		/**< The name of the output file, or NULL.		*/
+	struct menugen_options	options;		/**< The options to apply to the job.			*/
+	int			watch;			/**< The job's watch handle, if watching.		*/
+	int			messages_watch[MAX_VARIANTS + 1]; /**< The Messages files' watch handles, or -1.	*/
+};
 
+static bool menugen_read_options(int argc, char *argv[], struct menugen_options *options, struct menugen_settings *settings);
+static unsigned menugen_read_subsystems(char *list);
+static bool menugen_read_address(char *text, unsigned *address);
+static bool menugen_read_batch(char *filename, struct menugen_options *options, struct menugen_job **jobs, int *count);
+static char *menugen_read_batch_line(FILE *file, char **line, size_t *size, bool *success);
+static bool menugen_add_job(char *source, char *output, struct menugen_options *options, struct menugen_job **jobs, int *count);
+static void menugen_free_jobs(struct menugen_job *jobs, int count);
+static char *menugen_copy_string(char *string, bool *success);
+static void menugen_free_job(struct menugen_job *job);
+static bool menugen_watch_jobs(struct menugen_job *jobs, int count, struct menugen_diagnostics *diagnostics);
+static bool menugen_process_file(struct menugen_job *job, bool changes_only, struct menugen_diagnostics *diagnostics);
+static bool menugen_write_output(struct compile_context *context, struct menugen_job *job, struct menugen_variant *output,
+		bool report, bool changes_only, struct menugen_diagnostics *diagnostics);
+static bool menugen_write_shards(struct compile_context *context, struct menugen_job *job, struct menugen_variant *output,
+		bool report, bool changes_only, struct menugen_diagnostics *diagnostics);
+static double menugen_end_phase(struct menugen_job *job, struct menugen_diagnostics *diagnostics, char *name, char *category, double start);
+static void menugen_print_memory(struct memory_statistics *memory);
 
-#define MAX_STACK_SIZE 100
 
 int main(int argc, char *argv[])
 {
-	int	param;
-	bool	verbose_output = false;
-	bool	embed_dialogue_names = false;
-	bool	embed_menu_names = false;
-	bool	param_error = false;
+	struct menugen_options	options;
+	struct menugen_settings	settings;
+	struct menugen_job	*jobs = NULL;
+	struct menugen_diagnostics	diagnostics;
+	int			count = 0, job;
+	bool			batch_mode = false;
+	bool			param_error = false;
+	bool			success;
 
-	stack_initialise(MAX_STACK_SIZE);
+	options.embed_dialogue_names = false;
+	options.embed_menu_names = false;
+	options.verbose_output = false;
+	options.verbose_subsystems = 0;
+	options.check_only = false;
+	options.time_phases = false;
+	options.messages = NULL;
+	options.encoding = ENCODING_NONE;
+	options.header = NULL;
+	options.format = DATA_FORMAT_MENUS;
+	options.symbol = NULL;
+	options.relocate = false;
+	options.base = 0;
+	options.shards = NULL;
+	options.compress = false;
+	options.compact = false;
+	options.variants = 0;
 
-	printf("MenuGen %s - %s\n", BUILD_VERSION, BUILD_DATE);
-	printf("Copyright Stephen Fryatt, 2001-%s\n", BUILD_DATE + 7);
+	settings.watch_mode = false;
+	settings.trace_file = NULL;
+	settings.stats_file = NULL;
+
+	diagnostics.trace = NULL;
+	diagnostics.stats = NULL;
+
+	fprintf(stderr, "MenuGen %s - %s\n", BUILD_VERSION, BUILD_DATE);
+	fprintf(stderr, "Copyright Stephen Fryatt, 2001-%s\n", BUILD_DATE + 7);
 
 	if (argc < 3)
 		param_error = true;
+	else if (strcmp(argv[1], "-batch") == 0)
+		batch_mode = true;
+	else if (strcmp(argv[1], "-check") == 0)
+		options.check_only = true;
 
-	if (!param_error) {
-		for (param = 3; param < argc; param++) {
-			if (strcmp(argv[param], "-d") == 0)
-				embed_dialogue_names = true;
-			else if (strcmp(argv[param], "-m") == 0)
-				embed_menu_names = true;
-			else if (strcmp(argv[param], "-v") == 0)
-				verbose_output = true;
-			else
-				param_error = true;
-		}
+	if (!param_error)
+		param_error = !menugen_read_options(argc - 3, argv + 3, &options, &settings);
+
+	/* Variants, headers and shard manifests on the command line would
+	 * apply to every job in a batch, with each job overwriting the files
+	 * of the one before.
+	 */
+
+	if (!param_error && (batch_mode || options.check_only) && options.variants > 0)
+		param_error = true;
+
+	if (!param_error && (batch_mode || options.check_only) && options.header != NULL) {
+		if (batch_mode)
+			fprintf(stderr, "Header files must be given on each job line\n");
+		else
+			fprintf(stderr, "Header files can not be written when checking\n");
+		param_error = true;
+	}
+
+	if (!param_error && (batch_mode || options.check_only) && options.shards != NULL) {
+		if (batch_mode)
+			fprintf(stderr, "Shard manifests must be given on each job line\n");
+		else
+			fprintf(stderr, "Shard manifests can not be written when checking\n");
+		param_error = true;
 	}
 
 	if (param_error) {
-		printf("Usage: menugen <sourcefile> <output> [-d] [-m] [-v]\n");
+		fprintf(stderr, "Usage: menugen <sourcefile> <output> [-d] [-m] [-messages <file>] [-encoding <name>] [-header <file>]\n");
+		fprintf(stderr, "               [-format <format>] [-symbol <name>] [-base <address>] [-shards <manifest>]\n");
+		fprintf(stderr, "               [-compress] [-compact] [-v] [-watch]\n");
+		fprintf(stderr, "               [-variant <output> [-d] [-m] [-messages <file>] [-encoding <name>] [-header <file>]\n");
+		fprintf(stderr, "               [-format <format>] [-symbol <name>] [-base <address>] [-shards <manifest>]\n");
+		fprintf(stderr, "               [-compress] [-compact]]...\n");
+		fprintf(stderr, "       menugen -batch <jobfile> [-d] [-m] [-messages <file>] [-encoding <name>] [-v] [-watch]\n");
+		fprintf(stderr, "       menugen -check <sourcefile> [-messages <file>] [-encoding <name>] [-v] [-watch]\n");
+		fprintf(stderr, "Encodings: utf8, latin1, iso8859-1, latin9\n");
+		fprintf(stderr, "Formats: menus, c, asm\n");
+		fprintf(stderr, "Diagnostic options: [-verbose <subsystems>] [-time] [-trace <tracefile>] [-stats <statsfile>]\n");
 		return 1;
 	}
 
-	printf("Starting to parse menu definition file...\n");
-	if (!parse_process_file(argv[1], verbose_output)) {
-		printf("Errors in source file: terminating.\n");
-		return 1;
+	if (settings.trace_file != NULL) {
+		diagnostics.trace = trace_create(settings.trace_file);
+
+		if (diagnostics.trace == NULL) {
+			fprintf(stderr, "Unable to open trace file '%s'\n", settings.trace_file);
+			return 1;
+		}
+	}
+
+	if (settings.stats_file != NULL) {
+		diagnostics.stats = stats_create(settings.stats_file);
+
+		if (diagnostics.stats == NULL) {
+			fprintf(stderr, "Unable to open statistics file '%s'\n", settings.stats_file);
+			trace_destroy(diagnostics.trace);
+			return 1;
+		}
+	}
+
+	if (batch_mode)
+		success = menugen_read_batch(argv[2], &options, &jobs, &count);
+	else if (options.check_only)
+		success = menugen_add_job(argv[2], NULL, &options, &jobs, &count);
+	else
+		success = menugen_add_job(argv[1], argv[2], &options, &jobs, &count);
+
+	for (job = 0; job < count; job++) {
+		if (batch_mode)
+			fprintf(stderr, "Processing job '%s'...\n", jobs[job].source);
+
+		if (!menugen_process_file(&jobs[job], settings.watch_mode, &diagnostics))
+			success = false;
+	}
+
+	if (settings.watch_mode && count > 0)
+		success = menugen_watch_jobs(jobs, count, &diagnostics);
+
+	menugen_free_jobs(jobs, count);
+
+	if (!trace_destroy(diagnostics.trace)) {
+		fprintf(stderr, "Failed to write trace file\n");
+		success = false;
+	}
+
+	if (!stats_destroy(diagnostics.stats)) {
+		fprintf(stderr, "Failed to write statistics file\n");
+		success = false;
+	}
+
+	return (success) ? 0 : 1;
+}
+
+
+/**
+ * Read a set of option flags, updating the supplied settings for any
+ * which are found. Any -d, -m, -messages, -encoding, -header, -format,
+ * -symbol, -base, -shards, -compress and -compact options following a
+ * -variant apply to that variant, rather than to the main output.
+ *
+ * \param argc			The number of options to read.
+ * \param *argv[]		The options to read.
+ * \param *options		Pointer to the options to update.
+ * \param *settings		Pointer to the global settings to update, or
+ *				NULL if global settings can't be given.
+ * \return			True if the options were valid; else False.
+ */
+
+static bool menugen_read_options(int argc, char *argv[], struct menugen_options *options, struct menugen_settings *settings)
+{
+	int			param;
+	unsigned		subsystems;
+	enum encoding_target	encoding;
+	enum data_format	format;
+	unsigned		base;
+	struct menugen_variant	*variant = NULL;
+
+	for (param = 0; param < argc; param++) {
+		if (strcmp(argv[param], "-d") == 0) {
+			if (variant != NULL)
+				variant->embed_dialogue_names = true;
+			else
+				options->embed_dialogue_names = true;
+		} else if (strcmp(argv[param], "-m") == 0) {
+			if (variant != NULL)
+				variant->embed_menu_names = true;
+			else
+				options->embed_menu_names = true;
+		} else if (strcmp(argv[param], "-variant") == 0 && param + 1 < argc) {
+			if (options->variants >= MAX_VARIANTS) {
+				fprintf(stderr, "Too many variants (maximum %d)\n", MAX_VARIANTS);
+				return false;
+			}
+
+			variant = &(options->variant[options->variants++]);
+			variant->output = argv[++param];
+			variant->embed_dialogue_names = false;
+			variant->embed_menu_names = false;
+			variant->messages = NULL;
+			variant->encoding = ENCODING_NONE;
+			variant->header = NULL;
+			variant->format = DATA_FORMAT_MENUS;
+			variant->symbol = NULL;
+			variant->relocate = false;
+			variant->base = 0;
+			variant->shards = NULL;
+			variant->compress = false;
+			variant->compact = false;
+		} else if (strcmp(argv[param], "-messages") == 0 && param + 1 < argc) {
+			if (variant != NULL)
+				variant->messages = argv[++param];
+			else
+				options->messages = argv[++param];
+		} else if (strcmp(argv[param], "-encoding") == 0 && param + 1 < argc) {
+			encoding = encoding_find(argv[++param]);
+			if (encoding == ENCODING_UNKNOWN)
+				return false;
+
+			if (variant != NULL)
+				variant->encoding = encoding;
+			else
+				options->encoding = encoding;
+		} else if (strcmp(argv[param], "-header") == 0 && param + 1 < argc) {
+			if (variant != NULL)
+				variant->header = argv[++param];
+			else
+				options->header = argv[++param];
+		} else if (strcmp(argv[param], "-format") == 0 && param + 1 < argc) {
+			format = data_find_format(argv[++param]);
+			if (format == DATA_FORMAT_UNKNOWN)
+				return false;
+
+			if (variant != NULL)
+				variant->format = format;
+			else
+				options->format = format;
+		} else if (strcmp(argv[param], "-symbol") == 0 && param + 1 < argc) {
+			if (variant != NULL)
+				variant->symbol = argv[++param];
+			else
+				options->symbol = argv[++param];
+		} else if (strcmp(argv[param], "-base") == 0 && param + 1 < argc) {
+			if (!menugen_read_address(argv[++param], &base))
+				return false;
+
+			if (variant != NULL) {
+				variant->relocate = true;
+				variant->base = base;
+			} else {
+				options->relocate = true;
+				options->base = base;
+			}
+		} else if (strcmp(argv[param], "-shards") == 0 && param + 1 < argc) {
+			if (variant != NULL)
+				variant->shards = argv[++param];
+			else
+				options->shards = argv[++param];
+		} else if (strcmp(argv[param], "-compress") == 0) {
+			if (variant != NULL)
+				variant->compress = true;
+			else
+				options->compress = true;
+		} else if (strcmp(argv[param], "-compact") == 0) {
+			if (variant != NULL)
+				variant->compact = true;
+			else
+				options->compact = true;
+		} else if (strcmp(argv[param], "-v") == 0)
+			options->verbose_subsystems |= REPORT_ALL;
+		else if (strcmp(argv[param], "-verbose") == 0 && param + 1 < argc) {
+			subsystems = menugen_read_subsystems(argv[++param]);
+			if (subsystems == 0)
+				return false;
+			options->verbose_subsystems |= subsystems;
+		} else if (strcmp(argv[param], "-time") == 0)
+			options->time_phases = true;
+		else if (settings != NULL && strcmp(argv[param], "-watch") == 0)
+			settings->watch_mode = true;
+		else if (settings != NULL && strcmp(argv[param], "-trace") == 0 && param + 1 < argc)
+			settings->trace_file = argv[++param];
+		else if (settings != NULL && strcmp(argv[param], "-stats") == 0 && param + 1 < argc)
+			settings->stats_file = argv[++param];
+		else
+			return false;
+	}
+
+	options->verbose_output = (options->verbose_subsystems != 0) ? true : false;
+
+	return true;
+}
+
+
+/**
+ * Read a comma-separated list of report subsystem names.
+ *
+ * \param *list			The list to read.
+ * \return			A mask of the subsystems, or 0 if the list
+ *				was invalid.
+ */
+
+static unsigned menugen_read_subsystems(char *list)
+{
+	unsigned	subsystems = 0;
+	char		*name, *end;
+	size_t		length;
+
+	for (name = list; *name != '\0'; name = (*end == ',') ? end + 1 : end) {
+		end = strchr(name, ',');
+		if (end == NULL)
+			end = name + strlen(name);
+
+		length = end - name;
+
+		if (length == 5 && strncmp(name, "parse", length) == 0)
+			subsystems |= REPORT_PARSE;
+		else if (length == 5 && strncmp(name, "check", length) == 0)
+			subsystems |= REPORT_CHECK;
+		else if (length == 9 && strncmp(name, "structure", length) == 0)
+			subsystems |= REPORT_STRUCTURE;
+		else if (length == 6 && strncmp(name, "output", length) == 0)
+			subsystems |= REPORT_OUTPUT;
+		else
+			return 0;
+	}
+
+	return subsystems;
+}
+
+
+/**
+ * Read a word-aligned address, given in decimal, or in hexadecimal with
+ * a 0x or & prefix.
+ *
+ * \param *text			The text to read.
+ * \param *address		Pointer to a variable to take the address.
+ * \return			True if the address was valid; else False.
+ */
+
+static bool menugen_read_address(char *text, unsigned *address)
+{
+	unsigned long	value;
+	char		*start, *end;
+
+	errno = 0;
+
+	start = (*text == '&') ? text + 1 : text;
+	value = strtoul(start, &end, (start != text) ? 16 : 0);
+
+	if (errno != 0 || end == start || *end != '\0' || value > 0xffffffffUL || (value & 3) != 0)
+		return false;
+
+	*address = (unsigned) value;
+
+	return true;
+}
+
+
+/**
+ * Read a batch file, adding each of the jobs listed within it to a job
+ * list. Blank lines, and those starting with a #, are ignored.
+ *
+ * \param *filename		The name of the batch file to read.
+ * \param *options		The options to apply to all of the jobs.
+ * \param **jobs		Pointer to the job list to update.
+ * \param *count		Pointer to the number of jobs in the list.
+ * \return			True if all of the jobs were valid; else False.
+ */
+
+static bool menugen_read_batch(char *filename, struct menugen_options *options, struct menugen_job **jobs, int *count)
+{
+	FILE			*file;
+	char			*line = NULL, **params = NULL, **extended;
+	size_t			line_size = 0;
+	int			line_number = 0, params_found, params_size = 0;
+	bool			success = true, memory = true;
+	struct menugen_options	job_options;
+
+	file = fopen(filename, "r");
+
+	if (file == NULL) {
+		fprintf(stderr, "Bad batch file '%s'\n", filename);
+		return false;
+	}
+
+	while (menugen_read_batch_line(file, &line, &line_size, &memory) != NULL) {
+		line_number++;
+
+		/* Split the line into parameters, growing the list as required. */
+
+		params_found = 0;
+
+		while (memory) {
+			if (params_found >= params_size) {
+				extended = realloc(params, sizeof(char *) * (params_size + BATCH_PARAMS_BLOCK));
+				if (extended == NULL) {
+					memory = false;
+					break;
+				}
+
+				params = extended;
+				params_size += BATCH_PARAMS_BLOCK;
+			}
+
+			params[params_found] = strtok((params_found == 0) ? line : NULL, " \t\r\n");
+			if (params[params_found] == NULL)
+				break;
+
+			params_found++;
+		}
+
+		if (!memory)
+			break;
+
+		if (params_found == 0 || *params[0] == '#')
+			continue;
+
+		job_options = *options;
+
+		if (params_found < 2 || !menugen_read_options(params_found - 2, params + 2, &job_options, NULL)) {
+			fprintf(stderr, "Bad job at line %d of batch file\n", line_number);
+			success = false;
+			continue;
+		}
+
+		if (!menugen_add_job(params[0], params[1], &job_options, jobs, count))
+			success = false;
+	}
+
+	if (!memory) {
+		fprintf(stderr, "Failed to allocate memory for line %d of batch file\n", line_number + 1);
+		success = false;
+	}
+
+	free(params);
+	free(line);
+	fclose(file);
+
+	return success;
+}
+
+
+/**
+ * Read a complete line from a batch file, growing the line buffer as
+ * required so that long lines aren't split up.
+ *
+ * \param *file			The batch file to read from.
+ * \param **line		Pointer to the line buffer, which is updated if
+ *				the buffer is reallocated.
+ * \param *size			Pointer to the size of the line buffer.
+ * \param *success		Pointer to a variable to be set False if the
+ *				memory can't be allocated.
+ * \return			Pointer to the line, or NULL at the end of the
+ *				file or on failure.
+ */
+
+static char *menugen_read_batch_line(FILE *file, char **line, size_t *size, bool *success)
+{
+	char	*extended;
+	size_t	length = 0;
+
+	do {
+		if (*size - length < 2) {
+			extended = realloc(*line, *size + BATCH_LINE_BLOCK);
+			if (extended == NULL) {
+				*success = false;
+				return NULL;
+			}
+
+			*line = extended;
+			*size += BATCH_LINE_BLOCK;
+		}
+
+		if (fgets(*line + length, *size - length, file) == NULL)
+			return (length > 0) ? *line : NULL;
+
+		length += strlen(*line + length);
+	} while (length == 0 || (*line)[length - 1] != '\n');
+
+	return *line;
+}
+
+
+/**
+ * Add a job to a job list, taking copies of the filenames.
+ *
+ * \param *source		The name of the source file to compile.
+ * \param *output		The name of the Menus file to write, or NULL.
+ * \param *options		The options to apply to the job.
+ * \param **jobs		Pointer to the job list to update.
+ * \param *count		Pointer to the number of jobs in the list.
+ * \return			True if the job was added; else False.
+ */
+
+static bool menugen_add_job(char *source, char *output, struct menugen_options *options, struct menugen_job **jobs, int *count)
+{
+	struct menugen_job	*list, *job;
+	struct menugen_variant	*variant;
+	bool			success = true;
+	int			i;
+
+	list = realloc(*jobs, sizeof(struct menugen_job) * (*count + 1));
+	if (list == NULL) {
+		fprintf(stderr, "Failed to allocate memory for job\n");
+		return false;
+	}
+
+	*jobs = list;
+	job = list + *count;
+
+	job->options = *options;
+	job->watch = -1;
+
+	for (i = 0; i <= MAX_VARIANTS; i++)
+		job->messages_watch[i] = -1;
+
+	job->source = menugen_copy_string(source, &success);
+	job->output = menugen_copy_string(output, &success);
+	job->options.messages = menugen_copy_string(options->messages, &success);
+	job->options.header = menugen_copy_string(options->header, &success);
+	job->options.symbol = menugen_copy_string(options->symbol, &success);
+	job->options.shards = menugen_copy_string(options->shards, &success);
+
+	for (i = 0; i < options->variants; i++) {
+		variant = &(job->options.variant[i]);
+
+		variant->output = menugen_copy_string(options->variant[i].output, &success);
+		variant->messages = menugen_copy_string(options->variant[i].messages, &success);
+		variant->header = menugen_copy_string(options->variant[i].header, &success);
+		variant->symbol = menugen_copy_string(options->variant[i].symbol, &success);
+		variant->shards = menugen_copy_string(options->variant[i].shards, &success);
 	}
 
-	printf("Collating menu data...\n");
-	data_collate_structures(embed_menu_names, embed_dialogue_names, verbose_output);
+	if (!success) {
+		menugen_free_job(job);
 
-	if (verbose_output) {
-		printf("Printing structure report...\n");
-		data_print_structure_report();
+		fprintf(stderr, "Failed to allocate memory for job\n");
+		return false;
 	}
 
-	printf("Writing menu file...\n");
-	data_write_standard_menu_file(argv[2]);
+	(*count)++;
+
+	return true;
+}
+
+
+/**
+ * Take a copy of a string in a malloc()-claimed block.
+ *
+ * \param *string		The string to copy, or NULL.
+ * \param *success		Pointer to a variable to be set False if the
+ *				memory can't be allocated.
+ * \return			Pointer to the copy, or NULL.
+ */
+
+static char *menugen_copy_string(char *string, bool *success)
+{
+	char	*copy;
+
+	if (string == NULL)
+		return NULL;
+
+	copy = malloc(strlen(string) + 1);
+
+	if (copy == NULL) {
+		*success = false;
+		return NULL;
+	}
+
+	strcpy(copy, string);
+
+	return copy;
+}
+
+
+/**
+ * Free a job list, and the data associated with it.
+ *
+ * \param *jobs		The job list to free.
+ * \param count		The number of jobs in the list.
+ */
+
+static void menugen_free_jobs(struct menugen_job *jobs, int count)
+{
+	int	job;
+
+	if (jobs == NULL)
+		return;
+
+	for (job = 0; job < count; job++)
+		menugen_free_job(&jobs[job]);
+
+	free(jobs);
+}
+
+
+/**
+ * Free the filenames held by a job.
+ *
+ * \param *job		The job to free the data for.
+ */
+
+static void menugen_free_job(struct menugen_job *job)
+{
+	int	variant;
+
+	if (job->source != NULL)
+		free(job->source);
+	if (job->output != NULL)
+		free(job->output);
+	if (job->options.messages != NULL)
+		free(job->options.messages);
+	if (job->options.header != NULL)
+		free(job->options.header);
+	if (job->options.symbol != NULL)
+		free(job->options.symbol);
+	if (job->options.shards != NULL)
+		free(job->options.shards);
+
+	for (variant = 0; variant < job->options.variants; variant++) {
+		if (job->options.variant[variant].output != NULL)
+			free(job->options.variant[variant].output);
+		if (job->options.variant[variant].messages != NULL)
+			free(job->options.variant[variant].messages);
+		if (job->options.variant[variant].header != NULL)
+			free(job->options.variant[variant].header);
+		if (job->options.variant[variant].symbol != NULL)
+			free(job->options.variant[variant].symbol);
+		if (job->options.variant[variant].shards != NULL)
+			free(job->options.variant[variant].shards);
+	}
+}
+
+
+/**
+ * Watch the source and Messages files for a list of jobs, rebuilding any
+ * jobs whose inputs change. Outputs are only rewritten if their contents
+ * change, and this function only returns if an error occurs.
+ *
+ * \param *jobs		The list of jobs to watch.
+ * \param count		The number of jobs in the list.
+ * \param *diagnostics	The diagnostic outputs to record the jobs in.
+ * \return			False, as the function only returns on error.
+ */
+
+static bool menugen_watch_jobs(struct menugen_job *jobs, int count, struct menugen_diagnostics *diagnostics)
+{
+	struct watch_block	*watch;
+	int			job, i;
+	char			*messages;
+	bool			changed;
+
+	watch = watch_create();
+
+	if (watch == NULL) {
+		fprintf(stderr, "Unable to watch for changes on this system\n");
+		return false;
+	}
+
+	for (job = 0; job < count; job++) {
+		if (strcmp(jobs[job].source, "-") == 0) {
+			fprintf(stderr, "Unable to watch standard input\n");
+			watch_destroy(watch);
+			return false;
+		}
+
+		jobs[job].watch = watch_add_file(watch, jobs[job].source);
+
+		if (jobs[job].watch == -1) {
+			fprintf(stderr, "Unable to watch source file '%s'\n", jobs[job].source);
+			watch_destroy(watch);
+			return false;
+		}
+
+		/* The Messages files are inputs too, so watch them as well. */
+
+		for (i = 0; i <= jobs[job].options.variants; i++) {
+			messages = (i == 0) ? jobs[job].options.messages : jobs[job].options.variant[i - 1].messages;
+			if (messages == NULL)
+				continue;
+
+			jobs[job].messages_watch[i] = watch_add_file(watch, messages);
+
+			if (jobs[job].messages_watch[i] == -1) {
+				fprintf(stderr, "Unable to watch messages file '%s'\n", messages);
+				watch_destroy(watch);
+				return false;
+			}
+		}
+	}
+
+	fprintf(stderr, "Watching for changes...\n");
+
+	while (watch_wait(watch)) {
+		for (job = 0; job < count; job++) {
+			changed = false;
+
+			if (watch_changed(watch, jobs[job].watch)) {
+				fprintf(stderr, "Source file '%s' changed...\n", jobs[job].source);
+				changed = true;
+			}
+
+			for (i = 0; i <= jobs[job].options.variants; i++) {
+				if (!watch_changed(watch, jobs[job].messages_watch[i]))
+					continue;
+
+				messages = (i == 0) ? jobs[job].options.messages : jobs[job].options.variant[i - 1].messages;
+				fprintf(stderr, "Messages file '%s' changed...\n", messages);
+				changed = true;
+			}
+
+			if (changed)
+				menugen_process_file(&jobs[job], true, diagnostics);
+		}
+
+		fprintf(stderr, "Watching for changes...\n");
+	}
+
+	watch_destroy(watch);
+
+	return false;
+}
+
+
+/**
+ * Compile a single menu definition file into a Menus file, using a fresh
+ * compile context which is discarded afterwards. Any variants are then
+ * collated and written from the same parsed menus.
+ *
+ * \param *job			The job to be processed.
+ * \param changes_only		True to only rewrite the output if its contents
+ *				have changed; else False.
+ * \param *diagnostics	The diagnostic outputs to record the job in.
+ * \return			True if the job succeeded; else False.
+ */
+
+static bool menugen_process_file(struct menugen_job *job, bool changes_only, struct menugen_diagnostics *diagnostics)
+{
+	struct compile_context		*context;
+	struct compile_statistics	statistics;
+	struct menugen_variant		output, *variant;
+	bool				success = false, valid, written;
+	double				job_start, start, parse_time, job_time;
+	int				i;
+
+	job_start = trace_time();
+
+	context = compile_create(NULL, NULL);
+	if (context == NULL) {
+		fprintf(stderr, "Failed to initialise compiler: terminating.\n");
+		return false;
+	}
+
+	compile_set_verbose(context, job->options.verbose_subsystems);
+
+	fprintf(stderr, "Starting to parse menu definition file...\n");
+
+	/* Check the references even if the parse failed, so that all of
+	 * the errors in the file are reported together.
+	 */
+
+	start = trace_time();
+	valid = compile_parse_file(context, job->source, job->options.verbose_output);
+	if (!compile_check_references(context))
+		valid = false;
+	if (job->options.check_only && (job->options.messages != NULL || job->options.encoding != ENCODING_NONE) &&
+			!compile_localise(context, job->options.messages, job->options.encoding))
+		valid = false;
+	parse_time = menugen_end_phase(job, diagnostics, "Parse", "phase", start);
+
+	if (!valid) {
+		fprintf(stderr, "Errors in source file: terminating.\n");
+	} else if (job->options.check_only) {
+		fprintf(stderr, "No errors found in source file.\n");
+		success = true;
+	} else {
+		output.output = job->output;
+		output.embed_dialogue_names = job->options.embed_dialogue_names;
+		output.embed_menu_names = job->options.embed_menu_names;
+		output.messages = job->options.messages;
+		output.encoding = job->options.encoding;
+		output.header = job->options.header;
+		output.format = job->options.format;
+		output.symbol = job->options.symbol;
+		output.relocate = job->options.relocate;
+		output.base = job->options.base;
+		output.shards = job->options.shards;
+		output.compress = job->options.compress;
+		output.compact = job->options.compact;
+
+		success = menugen_write_output(context, job, &output, job->options.verbose_output, changes_only, diagnostics);
+	}
+
+	job_time = menugen_end_phase(job, diagnostics, "Job", "job", job_start);
+
+	if (diagnostics->stats != NULL || job->options.verbose_output)
+		compile_get_statistics(context, &statistics);
+
+	if (job->options.verbose_output)
+		menugen_print_memory(&statistics.memory);
+
+	stats_write_job(diagnostics->stats, job->source, job->output, success, &statistics, parse_time, job_time);
+
+	/* Each variant gets its own statistics record, with no parse time
+	 * as the parsed menus are shared with the main output.
+	 */
+
+	for (i = 0; valid && !job->options.check_only && i < job->options.variants; i++) {
+		variant = &(job->options.variant[i]);
+
+		fprintf(stderr, "Building variant '%s'...\n", variant->output);
+
+		start = trace_time();
+		written = menugen_write_output(context, job, variant, false, changes_only, diagnostics);
+		job_time = menugen_end_phase(job, diagnostics, "Variant", "job", start);
+
+		if (!written)
+			success = false;
+
+		if (diagnostics->stats != NULL) {
+			compile_get_statistics(context, &statistics);
+			stats_write_job(diagnostics->stats, job->source, variant->output, written, &statistics, 0.0, job_time);
+		}
+	}
+
+	compile_destroy(context);
+
+	return success;
+}
+
+
+/**
+ * Localise and collate the parsed menus in a compile context with a given
+ * set of options, and write the result to a Menus file.
+ *
+ * \param *context		The compile context holding the parsed menus.
+ * \param *job			The job to which the output belongs.
+ * \param *output		The details of the output to write.
+ * \param report		True to print a structure report; else False.
+ * \param changes_only		True to only rewrite the output if its contents
+ *				have changed; else False.
+ * \param *diagnostics	The diagnostic outputs to record the phases in.
+ * \return			True if the file was written; else False.
+ */
+
+static bool menugen_write_output(struct compile_context *context, struct menugen_job *job, struct menugen_variant *output,
+		bool report, bool changes_only, struct menugen_diagnostics *diagnostics)
+{
+	bool	success = false;
+	double	start;
+
+	/* Localise even without messages or an encoding, to undo any
+	 * previous locale.
+	 */
+
+	if (output->messages != NULL)
+		fprintf(stderr, "Localising menu text from '%s'...\n", output->messages);
+
+	start = trace_time();
+	success = compile_localise(context, output->messages, output->encoding);
+	menugen_end_phase(job, diagnostics, "Localise", "phase", start);
+
+	if (!success) {
+		fprintf(stderr, "Errors in menu text: terminating.\n");
+		return false;
+	}
+
+	/* The symbols in the source formats point into the uncompressed data. */
+
+	if (output->compress && output->format != DATA_FORMAT_MENUS) {
+		fprintf(stderr, "Compressed output must be written as a Menus file: terminating.\n");
+		return false;
+	}
+
+	/* Compact files are fixed up through their relocation table on loading. */
+
+	if (output->compact && output->relocate) {
+		fprintf(stderr, "Compact output can not be relocated: terminating.\n");
+		return false;
+	}
+
+	if (output->shards != NULL)
+		return menugen_write_shards(context, job, output, report, changes_only, diagnostics);
+
+	success = false;
+
+	fprintf(stderr, "Collating menu data...\n");
+	start = trace_time();
+	compile_collate(context, output->embed_menu_names, output->embed_dialogue_names, output->relocate, output->base, output->compact, job->options.verbose_output);
+	menugen_end_phase(job, diagnostics, "Collate", "phase", start);
+
+	if (report) {
+		fprintf(stderr, "Printing structure report...\n");
+		start = trace_time();
+		compile_print_report(context);
+		menugen_end_phase(job, diagnostics, "Report", "phase", start);
+	}
+
+	fprintf(stderr, "Writing menu file...\n");
+	start = trace_time();
+	if (!compile_write_file(context, output->output, output->format, output->symbol, output->compress, changes_only))
+		fprintf(stderr, "Failed to write menu file: terminating.\n");
+	else
+		success = true;
+	menugen_end_phase(job, diagnostics, "Write", "phase", start);
+
+	if (success && output->header != NULL) {
+		fprintf(stderr, "Writing header file...\n");
+		start = trace_time();
+		if (!compile_write_header(context, output->header, output->output, changes_only)) {
+			fprintf(stderr, "Failed to write header file: terminating.\n");
+			success = false;
+		}
+		menugen_end_phase(job, diagnostics, "Header", "phase", start);
+	}
+
+	return success;
+}
+
+
+/**
+ * Split the localised menus in a compile context into shards, and write
+ * each one to its own Menus file along with a manifest linking them back
+ * together. The core shard goes to the output file, and shard n to a file
+ * whose name is the output's with n appended.
+ *
+ * \param *context		The compile context holding the parsed menus.
+ * \param *job			The job to which the output belongs.
+ * \param *output		The details of the output to write.
+ * \param report		True to print a structure report for each shard;
+ *				else False.
+ * \param changes_only		True to only rewrite the files if their contents
+ *				have changed; else False.
+ * \param *diagnostics	The diagnostic outputs to record the phases in.
+ * \return			True if the files were written; else False.
+ */
+
+static bool menugen_write_shards(struct compile_context *context, struct menugen_job *job, struct menugen_variant *output,
+		bool report, bool changes_only, struct menugen_diagnostics *diagnostics)
+{
+	bool	success = true;
+	double	start;
+	int	shard, shards;
+	char	*filename;
+
+	/* Each shard is a Menus file in its own right, with offsets which
+	 * only make sense within it, so the other forms can't be sharded.
+	 */
+
+	if (output->format != DATA_FORMAT_MENUS || output->relocate || buffer_is_standard_stream(output->output)) {
+		fprintf(stderr, "Sharded output must be written as plain Menus files: terminating.\n");
+		return false;
+	}
+
+	/* A header describes a single Menus file, so can't cover the shards. */
+
+	if (output->header != NULL) {
+		fprintf(stderr, "Sharded output can not have a header file: terminating.\n");
+		return false;
+	}
+
+	filename = malloc(strlen(output->output) + 12);
+	if (filename == NULL) {
+		fprintf(stderr, "Failed to allocate memory for shard filename\n");
+		return false;
+	}
+
+	start = trace_time();
+	shards = compile_assign_shards(context);
+	menugen_end_phase(job, diagnostics, "Shard", "phase", start);
+
+	for (shard = 0; success && shard < shards; shard++) {
+		if (shard == 0)
+			strcpy(filename, output->output);
+		else
+			sprintf(filename, "%s%d", output->output, shard);
+
+		compile_select_shard(context, shard);
+
+		fprintf(stderr, "Collating menu shard %d of %d...\n", shard + 1, shards);
+		start = trace_time();
+		compile_collate(context, output->embed_menu_names, output->embed_dialogue_names, false, 0, output->compact, job->options.verbose_output);
+		menugen_end_phase(job, diagnostics, "Collate", "phase", start);
+
+		if (report) {
+			fprintf(stderr, "Printing structure report...\n");
+			start = trace_time();
+			compile_print_report(context);
+			menugen_end_phase(job, diagnostics, "Report", "phase", start);
+		}
+
+		fprintf(stderr, "Writing menu file '%s'...\n", filename);
+		start = trace_time();
+		if (!compile_write_file(context, filename, DATA_FORMAT_MENUS, NULL, output->compress, changes_only)) {
+			fprintf(stderr, "Failed to write menu file: terminating.\n");
+			success = false;
+		}
+		menugen_end_phase(job, diagnostics, "Write", "phase", start);
+	}
+
+	free(filename);
+
+	/* The manifest needs every menu, so select them all again. */
+
+	compile_select_shard(context, DATA_ALL_SHARDS);
+
+	if (success) {
+		fprintf(stderr, "Writing shard manifest...\n");
+		start = trace_time();
+		if (!compile_write_manifest(context, output->shards, changes_only)) {
+			fprintf(stderr, "Failed to write shard manifest: terminating.\n");
+			success = false;
+		}
+		menugen_end_phase(job, diagnostics, "Manifest", "phase", start);
+	}
+
+	return success;
+}
+
+
+/**
+ * Record the end of a phase of a job, adding it to the trace and reporting
+ * the time taken if required.
+ *
+ * \param *job			The job to which the phase belongs.
+ * \param *diagnostics	The diagnostic outputs to record the phase in.
+ * \param *name			The name of the phase.
+ * \param *category		The trace category for the phase.
+ * \param start			The time at which the phase started.
+ * \return			The time taken by the phase, in microseconds.
+ */
+
+static double menugen_end_phase(struct menugen_job *job, struct menugen_diagnostics *diagnostics, char *name, char *category, double start)
+{
+	double	end;
+
+	end = trace_time();
+
+	trace_event(diagnostics->trace, name, category, job->source, start, end);
+
+	if (job->options.time_phases)
+		fprintf(stderr, "%s took %.3f ms\n", name, (end - start) / 1000.0);
+
+	return end - start;
+}
+
+
+/**
+ * Print a summary of the memory used by a job.
+ *
+ * \param *memory		The memory statistics to print.
+ */
+
+static void menugen_print_memory(struct memory_statistics *memory)
+{
+	enum memory_category	category;
+
+	fprintf(stderr, "Memory usage:\n");
+
+	for (category = 0; category < MEMORY_CATEGORIES; category++) {
+		fprintf(stderr, "  %-10s %6d allocations, %8lu bytes allocated, %8lu bytes peak\n",
+				memory_category_name(category), memory->category[category].allocations,
+				(unsigned long) memory->category[category].allocated,
+				(unsigned long) memory->category[category].peak);
+	}
 
-	return 0;
+	fprintf(stderr, "  %-10s %6d allocations, %8lu bytes allocated, %8lu bytes peak\n",
+			"total", memory->total.allocations,
+			(unsigned long) memory->total.allocated, (unsigned long) memory->total.peak);
 }
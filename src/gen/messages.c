@@ -0,0 +1,161 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+/**
+ * Messages files, in the RISC OS MessageTrans format, used to look up the
+ * text of localised menu titles and items. Each line holds one or more
+ * tokens, separated by slashes, followed by a colon and the message text.
+ * Lines starting with a # are comments. The tokens are indexed in a hash
+ * table, so each lookup takes constant time however large the file is.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local source headers. */
+
+#include "messages.h"
+
+#include "buffer.h"
+#include "hash.h"
+#include "memory.h"
+
+struct messages_block {
+	struct memory_block	*memory;	/**< The memory block to allocate from.		*/
+	char			*file;		/**< The contents of the Messages file.		*/
+	struct hash_table	*index;		/**< The index of tokens into the file.		*/
+};
+
+static bool messages_index_file(struct messages_block *messages);
+
+/**
+ * Load a Messages file into memory, and index the tokens within it.
+ *
+ * \param *filename	The name of the file to load.
+ * \param *memory	The memory block to allocate from, or NULL.
+ * \return		Pointer to the loaded messages, or NULL on failure.
+ */
+
+struct messages_block *messages_load(char *filename, struct memory_block *memory)
+{
+	struct messages_block	*messages;
+
+	messages = malloc(sizeof(struct messages_block));
+	if (messages == NULL)
+		return NULL;
+
+	messages->memory = memory;
+	messages->file = buffer_load_file(filename, memory, NULL);
+	messages->index = hash_create(memory, NULL);
+
+	if (messages->file == NULL || messages->index == NULL || !messages_index_file(messages)) {
+		messages_destroy(messages);
+		return NULL;
+	}
+
+	return messages;
+}
+
+/**
+ * Destroy a set of messages, freeing the memory that they use. Any text
+ * returned by messages_lookup() becomes invalid.
+ *
+ * \param *messages	The messages to destroy.
+ */
+
+void messages_destroy(struct messages_block *messages)
+{
+	if (messages == NULL)
+		return;
+
+	hash_destroy(messages->index);
+
+	memory_release(messages->memory, messages->file);
+
+	free(messages);
+}
+
+/**
+ * Look up the text for a token. If a token appears more than once, the
+ * first definition is returned.
+ *
+ * \param *messages	The messages to search.
+ * \param *token	The token to look up.
+ * \return		Pointer to the message text, or NULL if not found.
+ */
+
+char *messages_lookup(struct messages_block *messages, char *token)
+{
+	if (messages == NULL)
+		return NULL;
+
+	return hash_find(messages->index, token);
+}
+
+/**
+ * Split the loaded file into lines, terminating the tokens and the text in
+ * place and adding each token to the index.
+ *
+ * \param *messages	The messages to index.
+ * \return		True if successful; else False.
+ */
+
+static bool messages_index_file(struct messages_block *messages)
+{
+	char	*line, *next, *end, *text, *token;
+
+	for (line = messages->file; *line != '\0'; line = next) {
+		next = strchr(line, '\n');
+
+		if (next != NULL)
+			*next++ = '\0';
+		else
+			next = line + strlen(line);
+
+		end = line + strlen(line);
+		if (end > line && *(end - 1) == '\r')
+			*(end - 1) = '\0';
+
+		if (*line == '#')
+			continue;
+
+		text = strchr(line, ':');
+		if (text == NULL)
+			continue;
+
+		*text++ = '\0';
+
+		for (token = line; token != NULL; token = end) {
+			end = strchr(token, '/');
+			if (end != NULL)
+				*end++ = '\0';
+
+			if (*token != '\0' && !hash_insert(messages->index, token, text))
+				return false;
+		}
+	}
+
+	return true;
+}
+
@@ -29,7 +29,11 @@
 
 #include "parse.h"
 
+#include "buffer.h"
+#include "counters.h"
 #include "data.h"
+#include "memory.h"
+#include "report.h"
 #include "stack.h"
 
 #define MAX_PARAM_LIST 10
@@ -37,114 +41,202 @@
 
 #define MAX_COMMAND_LEN 20
 
+/**
+ * The maximum depth to which blocks can be nested.
+ */
+
+#define MAX_NESTING_DEPTH 65536
+
+/**
+ * The types of block which can be opened in a file. Each type is a single
+ * bit, so that the set of blocks currently open can be held as a mask.
+ */
+
 enum type {
-	TYPE_NONE = 0,
-	TYPE_MENU = 1,
-	TYPE_ITEM = 2,
-	TYPE_SUBMENU = 3,
-	TYPE_WRITABLE = 4,
-	TYPE_SPRITE = 5
+	TYPE_NONE = 0x00,
+	TYPE_MENU = 0x01,
+	TYPE_ITEM = 0x02,
+	TYPE_SUBMENU = 0x04,
+	TYPE_WRITABLE = 0x08,
+	TYPE_SPRITE = 0x10
+};
+
+/**
+ * The state of a parse operation, passed to the command handlers.
+ */
+
+struct parse_block {
+	struct data_block	*data;		/**< The data block to store the menus in.		*/
+	struct report_block	*report;	/**< The report block to send messages to.		*/
+	struct stack_block	stack;		/**< The stack used to track nested blocks.		*/
+	unsigned		context;	/**< The mask of block types currently open.		*/
+
+	int			line;		/**< The line on which the current statement starts.	*/
+	int			column;		/**< The column at which the current statement starts.	*/
 };
 
 struct command_def {
 	char		command[MAX_COMMAND_LEN];
 	char		params[MAX_PARAM_LIST];
-	bool		menu;
-	bool		item;
-	bool		submenu;
-	bool		writable;
-	bool		sprite;
+	unsigned	context;
 	enum type	new_type;
-	bool		(*handler)(char params[][MAX_PARAM_LEN]);
+	bool		(*handler)(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
 };
 
-static int parse_find_parameters(char params[][MAX_PARAM_LEN], char *line, char *types);
-
-static bool parse_command_always(char params[][MAX_PARAM_LEN]);
-static bool parse_command_colours_menu(char params[][MAX_PARAM_LEN]);
-static bool parse_command_colours_item(char params[][MAX_PARAM_LEN]);
-static bool parse_command_dbox(char params[][MAX_PARAM_LEN]);
-static bool parse_command_dotted(char params[][MAX_PARAM_LEN]);
-static bool parse_command_indirected_menu(char params[][MAX_PARAM_LEN]);
-static bool parse_command_indirected_item(char params[][MAX_PARAM_LEN]);
-static bool parse_command_item(char params[][MAX_PARAM_LEN]);
-static bool parse_command_item_height(char params[][MAX_PARAM_LEN]);
-static bool parse_command_item_gap(char params[][MAX_PARAM_LEN]);
-static bool parse_command_menu(char params[][MAX_PARAM_LEN]);
-static bool parse_command_reverse(char params[][MAX_PARAM_LEN]);
-static bool parse_command_shaded(char params[][MAX_PARAM_LEN]);
-static bool parse_command_submenu(char params[][MAX_PARAM_LEN]);
-static bool parse_command_ticked(char params[][MAX_PARAM_LEN]);
-static bool parse_command_validation(char params[][MAX_PARAM_LEN]);
-static bool parse_command_warning(char params[][MAX_PARAM_LEN]);
-static bool parse_command_writable(char params[][MAX_PARAM_LEN]);
-
-
-/* Define the commands here, in terms of name, parameters, what commands they
- * must be subservient to, what groups they open, and what handlers they
- * use.
+static int parse_find_parameters(struct memory_block *memory, char params[][MAX_PARAM_LEN], char *line, char *types);
+
+static bool parse_command_always(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_colours_menu(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_colours_item(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_dbox(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_dotted(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_indirected_menu(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_indirected_item(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_item(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_item_height(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_item_gap(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_menu(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_reverse(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_shaded(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_submenu(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_ticked(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_validation(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_warning(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+static bool parse_command_writable(struct parse_block *parse, char params[][MAX_PARAM_LEN]);
+
+
+/* Define the commands here, in terms of name, parameters, the mask of groups
+ * which they must be subservient to, what groups they open, and what handlers
+ * they use.
  */
 
 #define COMMANDS 20
 
 static const struct command_def command_list[] = {
-	{"always",	"",	true,	true,	true,	false,	false,	TYPE_NONE,	parse_command_always},
-	{"colours",	"IIII",	true,	false,	false,	false,	false,	TYPE_NONE,	parse_command_colours_menu},
-	{"colours",	"II",	true,	true,	false,	false,	false,	TYPE_NONE,	parse_command_colours_item},
-	{"d_box",	"I",	true,	true,	false,	false,	false,	TYPE_SUBMENU,	parse_command_dbox},
-	{"dotted",	"",	true,	true,	false,	false,	false,	TYPE_NONE,	parse_command_dotted},
-	{"half",	"",	true,	true,	false,	false,	true,	TYPE_NONE,	NULL},
-	{"indirected",	"I",	true,	false,	false,	false,	false,	TYPE_NONE,	parse_command_indirected_menu},
-	{"indirected",	"I",	true,	true,	false,	false,	false,	TYPE_NONE,	parse_command_indirected_item},
-	{"item",	"S",	true,	false,	false,	false,	false,	TYPE_ITEM,	parse_command_item},
-	{"item_gap",	"I",	true,	false,	false,	false,	false,	TYPE_NONE,	parse_command_item_gap},
-	{"item_height",	"I",	true,	false,	false,	false,	false,	TYPE_NONE,	parse_command_item_height},
-	{"menu",	"IS",	false,	false,	false,	false,	false,	TYPE_MENU,	parse_command_menu},
-	{"reverse",	"",	true,	false,	false,	false,	false,	TYPE_NONE,	parse_command_reverse},
-	{"shaded",	"",	true,	true,	false,	false,	false,	TYPE_NONE,	parse_command_shaded},
-	{"sprite",	"",	true,	true,	false,	false,	false,	TYPE_SPRITE,	NULL},
-	{"submenu",	"I",	true,	true,	false,	false,	false,	TYPE_SUBMENU,	parse_command_submenu},
-	{"ticked",	"",	true,	true,	false,	false,	false,	TYPE_NONE,	parse_command_ticked},
-	{"validation",	"S",	true,	true,	false,	true,	false,	TYPE_NONE,	parse_command_validation},
-	{"warning",	"",	true,	true,	true,	false,	false,	TYPE_NONE,	parse_command_warning},
-	{"writable",	"",	true,	true,	false,	false,	false,	TYPE_WRITABLE,	parse_command_writable}
+	{"always",	"",	TYPE_MENU | TYPE_ITEM | TYPE_SUBMENU,	TYPE_NONE,	parse_command_always},
+	{"colours",	"IIII",	TYPE_MENU,				TYPE_NONE,	parse_command_colours_menu},
+	{"colours",	"II",	TYPE_MENU | TYPE_ITEM,			TYPE_NONE,	parse_command_colours_item},
+	{"d_box",	"I",	TYPE_MENU | TYPE_ITEM,			TYPE_SUBMENU,	parse_command_dbox},
+	{"dotted",	"",	TYPE_MENU | TYPE_ITEM,			TYPE_NONE,	parse_command_dotted},
+	{"half",	"",	TYPE_MENU | TYPE_ITEM | TYPE_SPRITE,	TYPE_NONE,	NULL},
+	{"indirected",	"I",	TYPE_MENU,				TYPE_NONE,	parse_command_indirected_menu},
+	{"indirected",	"I",	TYPE_MENU | TYPE_ITEM,			TYPE_NONE,	parse_command_indirected_item},
+	{"item",	"S",	TYPE_MENU,				TYPE_ITEM,	parse_command_item},
+	{"item_gap",	"I",	TYPE_MENU,				TYPE_NONE,	parse_command_item_gap},
+	{"item_height",	"I",	TYPE_MENU,				TYPE_NONE,	parse_command_item_height},
+	{"menu",	"IS",	TYPE_NONE,				TYPE_MENU,	parse_command_menu},
+	{"reverse",	"",	TYPE_MENU,				TYPE_NONE,	parse_command_reverse},
+	{"shaded",	"",	TYPE_MENU | TYPE_ITEM,			TYPE_NONE,	parse_command_shaded},
+	{"sprite",	"",	TYPE_MENU | TYPE_ITEM,			TYPE_SPRITE,	NULL},
+	{"submenu",	"I",	TYPE_MENU | TYPE_ITEM,			TYPE_SUBMENU,	parse_command_submenu},
+	{"ticked",	"",	TYPE_MENU | TYPE_ITEM,			TYPE_NONE,	parse_command_ticked},
+	{"validation",	"S",	TYPE_MENU | TYPE_ITEM | TYPE_WRITABLE,	TYPE_NONE,	parse_command_validation},
+	{"warning",	"",	TYPE_MENU | TYPE_ITEM | TYPE_SUBMENU,	TYPE_NONE,	parse_command_warning},
+	{"writable",	"",	TYPE_MENU | TYPE_ITEM,			TYPE_WRITABLE,	parse_command_writable}
 };
 
 /**
- * Process a file, reading bytes from the input and passing complete lines
- * to the parameter system.
+ * Process a file, loading it into memory and then passing it to the
+ * parser.
  *
+ * \Param  *data		The data block to store the menus in.
+ * \Param  *report		The report block to send messages to.
+ * \Param  *memory		The memory block to record allocations in, or NULL.
+ * \Param  *counters		The counters to update, or NULL.
  * \Param  *filename		The file to process.
- * \Param  verbose		True if verbose output is to be written to STDOUT; else False.
+ * \Param  verbose		True if verbose output is to be reported; else False.
+ * \Param  *statistics		Pointer to a block to take statistics about
+ *				the file, or NULL.
+ * \Return			True if the parsing completed successfully; else False.
+ */
+
+bool parse_process_file(struct data_block *data, struct report_block *report, struct memory_block *memory, struct counter_block *counters, char *filename, bool verbose, struct parse_statistics *statistics)
+{
+	char	*file;
+	size_t	length;
+	bool	success;
+
+	file = buffer_load_file(filename, memory, &length);
+
+	if (file == NULL) {
+		report_error(report, REPORT_PARSE, 0, 0, "Bad source file '%s'", filename);
+
+		if (statistics != NULL) {
+			statistics->bytes = 0;
+			statistics->lines = 0;
+			statistics->statements = 0;
+		}
+
+		return false;
+	}
+
+	success = parse_process_buffer(data, report, memory, counters, file, length, verbose, statistics);
+
+	memory_release(memory, file);
+
+	return success;
+}
+
+/**
+ * Process a menu definition held in memory, passing complete lines to the
+ * parameter system.
+ *
+ * \Param  *data		The data block to store the menus in.
+ * \Param  *report		The report block to send messages to.
+ * \Param  *memory		The memory block to record allocations in, or NULL.
+ * \Param  *counters		The counters to update, or NULL.
+ * \Param  *file		The menu definition to process.
+ * \Param  length		The length of the menu definition, in bytes.
+ * \Param  verbose		True if verbose output is to be reported; else False.
+ * \Param  *statistics		Pointer to a block to take statistics about
+ *				the file, or NULL.
  * \Return			True if the parsing completed successfully; else False.
  */
 
-bool parse_process_file(char *filename, bool verbose)
+bool parse_process_buffer(struct data_block *data, struct report_block *report, struct memory_block *memory, struct counter_block *counters, char *file, size_t length, bool verbose, struct parse_statistics *statistics)
 {
-	FILE	*f;
+	struct parse_block	parse;
+	size_t	position;
 	bool	parse_error = false, fatal_error = false;
 	int	c, last, len, pcount, i, cid;
 	bool	comment = false, string = false;
-	bool	menu = false, item = false, submenu = false, writable = false, sprite = false;
-	int	line_number = 1;
+	int	type;
+	int	line_number = 1, column_number = 0, statements = 0;
 	char	command[4096], params[MAX_PARAM_LIST][MAX_PARAM_LEN], types[64];
 
 	last = '\0';
 	len = 0;
 
-	f = fopen(filename, "r");
+	parse.data = data;
+	parse.report = report;
+	parse.line = 0;
+	parse.column = 0;
+	parse.context = TYPE_NONE;
+
+	if (!report_wants(report, REPORT_LEVEL_VERBOSE, REPORT_PARSE))
+		verbose = false;
+
+	stack_initialise(&parse.stack, MAX_NESTING_DEPTH);
 
-	if (f != NULL) {
-		while (!fatal_error && (c = fgetc(f)) != EOF) {
-			if (c == '\n')
+	if (file != NULL) {
+		for (position = 0; !fatal_error && position < length; position++) {
+			c = (unsigned char) file[position];
+
+			if (c == '\n') {
 				line_number++;
+				column_number = 0;
+			} else {
+				column_number++;
+			}
 
 			if (c == '*' && last == '/') {
 				if (comment) {
-					printf("Nested comments at line %d\n", line_number);
+					report_error(report, REPORT_PARSE, line_number, column_number - 1, "Nested comments");
 					parse_error = true;
 				}
 
+				COUNTER_ADD(counters, LEX_COMMENTS, 1);
+
 				comment = true;
 				if (len > 0)
 					len--;
@@ -152,7 +244,7 @@ bool parse_process_file(char *filename, bool verbose)
 
 			if (c == '/' && last == '*') {
 				if (!comment) {
-					printf("No comment to close at line %d\n", line_number);
+					report_error(report, REPORT_PARSE, line_number, column_number - 1, "No comment to close");
 					parse_error = true;
 				}
 
@@ -165,150 +257,161 @@ bool parse_process_file(char *filename, bool verbose)
 
 			if (!comment && ((c > 32) || (string && (c == 32)))) {
 				if (c == '{' && !string) {
+					statements++;
+					COUNTER_ADD(counters, STATEMENTS, 1);
 					command[len] = '\0';
-					pcount = parse_find_parameters(params, command, types);
+					pcount = parse_find_parameters(memory, params, command, types);
 
 					if (pcount == 0) {
-						printf("Error processing command '%s' at line %d\n", command, line_number);
+						report_error(report, REPORT_PARSE, parse.line, parse.column, "Error processing command '%s'", command);
 						parse_error = true;
 					}
 
 					cid = -1;
 					for (i = 0; (pcount > 0) && (i < COMMANDS); i++) {
+						COUNTER_ADD(counters, COMMAND_PROBES, 1);
+
 						if (strcmp(command_list[i].command, params[0]) == 0 &&
 								command_list[i].new_type != TYPE_NONE &&
-								command_list[i].menu == menu &&
-								command_list[i].item == item &&
-								command_list[i].submenu == submenu &&
-								command_list[i].writable == writable &&
-								command_list[i].sprite == sprite) {
+								command_list[i].context == parse.context) {
 							cid = i;
 							break;
 						}
 					}
 
 					if (cid != -1) {
+						COUNTER_COMMAND(counters, cid, (char *) command_list[cid].command);
+
 						if (strcmp(command_list[cid].params, types) == 0) {
 							if (command_list[cid].handler != NULL)
-								fatal_error = !command_list[cid].handler(params);
+								fatal_error = !command_list[cid].handler(&parse, params);
 							if (fatal_error)
-								printf("Internal error processing '%s' command at line %d\n", command_list[cid].command, line_number);
+								report_error(report, REPORT_PARSE, parse.line, parse.column, "Internal error processing '%s' command", command_list[cid].command);
 							else if (verbose)
-								printf("Found command %s as section head at line %d\n", command_list[cid].command, line_number);
+								report_verbose(report, REPORT_PARSE, line_number, "Found command %s as section head", command_list[cid].command);
 						} else {
-							printf("Bad parameters to '%s' at line %d\n", command_list[cid].command, line_number);
+							report_error(report, REPORT_PARSE, parse.line, parse.column, "Bad parameters to '%s'", command_list[cid].command);
 							parse_error = true;
 						}
-
-						stack_push(command_list[cid].new_type);
-						switch(command_list[cid].new_type) {
-						case TYPE_MENU:
-							menu = true;
-							break;
-						case TYPE_ITEM:
-							item = true;
-							break;
-						case TYPE_SUBMENU:
-							submenu = true;
-							break;
-						case TYPE_WRITABLE:
-							writable = true;
-							break;
-						case TYPE_SPRITE:
-							sprite = true;
-							break;
-						case TYPE_NONE:
-							break;
-						}
 					} else {
-						printf("Invalid command '%s' at line %d\n", command, line_number);
+						report_error(report, REPORT_PARSE, parse.line, parse.column, "Invalid command '%s'", command);
 						parse_error = true;
 					}
+
+					/* Invalid section heads still open a block, so that
+					 * their closing brace doesn't close its parent.
+					 */
+
+					type = (cid != -1) ? command_list[cid].new_type : TYPE_NONE;
+
+					if (stack_push(&parse.stack, type)) {
+						parse.context |= type;
+					} else {
+						report_error(report, REPORT_PARSE, parse.line, parse.column, "Blocks nested too deeply");
+						fatal_error = true;
+					}
 					len = 0;
 				} else if (c == '}' && !string) {
-					switch(stack_pop()) {
+					type = stack_pop(&parse.stack);
+					if (type == STACK_EMPTY) {
+						report_error(report, REPORT_PARSE, line_number, column_number, "Unexpected '}'");
+						parse_error = true;
+					} else {
+						parse.context &= ~type;
+					}
+
+					switch(type) {
 					case TYPE_MENU:
-						menu = false;
 						if (verbose)
-							printf("Closing menu at line %d\n", line_number);
+							report_verbose(report, REPORT_PARSE, line_number, "Closing menu");
 						break;
 					case TYPE_ITEM:
-						item = false;
 						if (verbose)
-							printf("Closing item at line %d\n", line_number);
+							report_verbose(report, REPORT_PARSE, line_number, "Closing item");
 						break;
 					case TYPE_SUBMENU:
-						submenu = false;
 						if (verbose)
-							printf("Closing submenu or d_box at line %d\n", line_number);
+							report_verbose(report, REPORT_PARSE, line_number, "Closing submenu or d_box");
 						break;
 					case TYPE_WRITABLE:
-						writable = false;
 						if (verbose)
-							printf("Closing writable at line %d\n", line_number);
+							report_verbose(report, REPORT_PARSE, line_number, "Closing writable");
 						break;
 					case TYPE_SPRITE:
-						sprite = false;
 						if (verbose)
-							printf("Closing sprite at line %d\n", line_number);
+							report_verbose(report, REPORT_PARSE, line_number, "Closing sprite");
 						break;
 					case TYPE_NONE:
 						break;
 					}
 					len = 0;
 				} else if (c == ';' && !string) {
+					statements++;
+					COUNTER_ADD(counters, STATEMENTS, 1);
 					command[len] = '\0';
-					pcount = parse_find_parameters(params, command, types);
+					pcount = parse_find_parameters(memory, params, command, types);
 
 					if (pcount == 0) {
-						printf("Error processing command '%s' at line %d\n", command, line_number);
+						report_error(report, REPORT_PARSE, parse.line, parse.column, "Error processing command '%s'", command);
 						parse_error = true;
 					}
 
 					cid = -1;
 					for (i = 0; (pcount > 0) && (i < COMMANDS); i++) {
+						COUNTER_ADD(counters, COMMAND_PROBES, 1);
+
 						if (strcmp(command_list[i].command, params[0]) == 0 &&
-								command_list[i].menu == menu &&
-								command_list[i].item == item &&
-								command_list[i].submenu == submenu &&
-								command_list[i].writable == writable &&
-								command_list[i].sprite == sprite) {
+								command_list[i].context == parse.context) {
 							cid = i;
 							break;
 						}
 					}
 
 					if (cid != -1) {
+						COUNTER_COMMAND(counters, cid, (char *) command_list[cid].command);
+
 						if (strcmp(command_list[cid].params, types) == 0) {
 							if (command_list[cid].handler != NULL)
-								fatal_error = !command_list[cid].handler(params);
+								fatal_error = !command_list[cid].handler(&parse, params);
 							if (fatal_error)
-								printf("Internal error processing '%s' command at line %d\n", command_list[cid].command, line_number);
+								report_error(report, REPORT_PARSE, parse.line, parse.column, "Internal error processing '%s' command", command_list[cid].command);
 							else if (verbose)
-								printf("Found command %s standalone at line %d\n", command_list[cid].command, line_number);
+								report_verbose(report, REPORT_PARSE, line_number, "Found command %s standalone", command_list[cid].command);
 						} else {
-							printf("Bad parameters to '%s' at line %d\n", command_list[cid].command, line_number);
+							report_error(report, REPORT_PARSE, parse.line, parse.column, "Bad parameters to '%s'", command_list[cid].command);
 							parse_error = true;
 						}
 					} else {
-						printf("Invalid command '%s' at line %d\n", command, line_number);
+						report_error(report, REPORT_PARSE, parse.line, parse.column, "Invalid command '%s'", command);
 						parse_error = true;
 					}
 					len = 0;
 				} else if (c != '\0') {
+					if (len == 0) {
+						parse.line = line_number;
+						parse.column = column_number;
+					}
+
 					command[len++] = c;
 				}
 			}
 
 			last = c;
 		}
-
-		fclose(f);
 	} else {
-		printf("Bad source file '%s'\n", filename);
 		fatal_error = true;
 	}
 
+	stack_terminate(&parse.stack);
+
+	COUNTER_ADD(counters, LEX_BYTES, length);
+
+	if (statistics != NULL) {
+		statistics->bytes = length;
+		statistics->lines = line_number;
+		statistics->statements = statements;
+	}
+
 	return (parse_error || fatal_error) ? false : true;
 }
 
@@ -317,6 +420,7 @@ bool parse_process_file(char *filename, bool verbose)
  * a set of strings and producing a list of types as a string in the form
  * "SI" for String-Integer.
  *
+ * \param *memory		The memory block to record allocations in, or NULL.
  * \param *params		An array of strings to take returned parameters
  * \param *line			The command line to parse
  * \param *types		A string to take the list of parameter types
@@ -324,7 +428,7 @@ bool parse_process_file(char *filename, bool verbose)
  *				command name (so 0 == error)
  */
 
-int parse_find_parameters(char params[][MAX_PARAM_LEN], char *line, char *types)
+int parse_find_parameters(struct memory_block *memory, char params[][MAX_PARAM_LEN], char *line, char *types)
 {
 	bool	error = false;
 	int	entries = 0;
@@ -332,7 +436,7 @@ int parse_find_parameters(char params[][MAX_PARAM_LEN], char *line, char *types)
 
 	*types = '\0';
 
-	copy = (char *) malloc(strlen(line) + 1);
+	copy = memory_claim(memory, MEMORY_SCRATCH, strlen(line) + 1);
 
 	if (copy == NULL)
 		return entries;
@@ -373,7 +477,7 @@ int parse_find_parameters(char params[][MAX_PARAM_LEN], char *line, char *types)
 	strcpy(params[0], copy);
 	entries++;
 
-	free(copy);
+	memory_release(memory, copy);
 
 	if (error)
 		entries = 0;
@@ -386,93 +490,93 @@ int parse_find_parameters(char params[][MAX_PARAM_LEN], char *line, char *types)
  * The various command handlers.
  */
 
-static bool parse_command_always(char params[][MAX_PARAM_LEN])
+static bool parse_command_always(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_set_item_when_shaded();
+	return data_set_item_when_shaded(parse->data);
 }
 
-static bool parse_command_colours_menu(char params[][MAX_PARAM_LEN])
+static bool parse_command_colours_menu(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_set_menu_colours(atoi(params[1]), atoi(params[2]), atoi(params[3]), atoi(params[4]));
+	return data_set_menu_colours(parse->data, atoi(params[1]), atoi(params[2]), atoi(params[3]), atoi(params[4]));
 }
 
-static bool parse_command_colours_item(char params[][MAX_PARAM_LEN])
+static bool parse_command_colours_item(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_set_item_colours(atoi(params[1]), atoi(params[2]));
+	return data_set_item_colours(parse->data, atoi(params[1]), atoi(params[2]));
 }
 
-static bool parse_command_dbox(char params[][MAX_PARAM_LEN])
+static bool parse_command_dbox(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_set_item_submenu(params[1], true);
+	return data_set_item_submenu(parse->data, params[1], true, parse->line, parse->column);
 }
 
-static bool parse_command_dotted(char params[][MAX_PARAM_LEN])
+static bool parse_command_dotted(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_set_item_dotted();
+	return data_set_item_dotted(parse->data);
 }
 
-static bool parse_command_indirected_menu(char params[][MAX_PARAM_LEN])
+static bool parse_command_indirected_menu(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_set_menu_title_indirection(atoi(params[1]));
+	return data_set_menu_title_indirection(parse->data, atoi(params[1]));
 }
 
-static bool parse_command_indirected_item(char params[][MAX_PARAM_LEN])
+static bool parse_command_indirected_item(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_set_item_indirection(atoi(params[1]));
+	return data_set_item_indirection(parse->data, atoi(params[1]));
 }
 
-static bool parse_command_item(char params[][MAX_PARAM_LEN])
+static bool parse_command_item(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_create_new_item(params[1]);
+	return data_create_new_item(parse->data, params[1], parse->line, parse->column);
 }
 
-static bool parse_command_item_gap(char params[][MAX_PARAM_LEN])
+static bool parse_command_item_gap(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_set_menu_item_gap(atoi(params[1]));
+	return data_set_menu_item_gap(parse->data, atoi(params[1]));
 }
 
-static bool parse_command_item_height(char params[][MAX_PARAM_LEN])
+static bool parse_command_item_height(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_set_menu_item_height(atoi(params[1]));
+	return data_set_menu_item_height(parse->data, atoi(params[1]));
 }
 
-static bool parse_command_menu(char params[][MAX_PARAM_LEN])
+static bool parse_command_menu(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_create_new_menu(params[1], params[2]);
+	return data_create_new_menu(parse->data, params[1], params[2], parse->line, parse->column);
 }
 
-static bool parse_command_reverse(char params[][MAX_PARAM_LEN])
+static bool parse_command_reverse(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_set_menu_reversed();
+	return data_set_menu_reversed(parse->data);
 }
 
-static bool parse_command_shaded(char params[][MAX_PARAM_LEN])
+static bool parse_command_shaded(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_set_item_shaded();
+	return data_set_item_shaded(parse->data);
 }
 
-static bool parse_command_submenu(char params[][MAX_PARAM_LEN])
+static bool parse_command_submenu(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_set_item_submenu(params[1], false);
+	return data_set_item_submenu(parse->data, params[1], false, parse->line, parse->column);
 }
 
-static bool parse_command_ticked(char params[][MAX_PARAM_LEN])
+static bool parse_command_ticked(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_set_item_ticked();
+	return data_set_item_ticked(parse->data);
 }
 
-static bool parse_command_validation(char params[][MAX_PARAM_LEN])
+static bool parse_command_validation(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_set_item_validation(params[1]);
+	return data_set_item_validation(parse->data, params[1]);
 }
 
-static bool parse_command_warning(char params[][MAX_PARAM_LEN])
+static bool parse_command_warning(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_set_item_warning();
+	return data_set_item_warning(parse->data);
 }
 
-static bool parse_command_writable(char params[][MAX_PARAM_LEN])
+static bool parse_command_writable(struct parse_block *parse, char params[][MAX_PARAM_LEN])
 {
-	return data_set_item_writable();
+	return data_set_item_writable(parse->data);
 }
 
@@ -25,8 +25,25 @@
 #define MENUGEN_PARSE_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
-bool parse_process_file(char *filename, bool verbose);
+#include "counters.h"
+#include "data.h"
+#include "memory.h"
+#include "report.h"
+
+/**
+ * Statistics about a parsed source file.
+ */
+
+struct parse_statistics {
+	size_t		bytes;			/**< The size of the source file.			*/
+	int		lines;			/**< The number of lines in the source file.		*/
+	int		statements;		/**< The number of commands and section heads.		*/
+};
+
+bool parse_process_file(struct data_block *data, struct report_block *report, struct memory_block *memory, struct counter_block *counters, char *filename, bool verbose, struct parse_statistics *statistics);
+bool parse_process_buffer(struct data_block *data, struct report_block *report, struct memory_block *memory, struct counter_block *counters, char *file, size_t length, bool verbose, struct parse_statistics *statistics);
 
 #endif
 
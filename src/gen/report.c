@@ -0,0 +1,414 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+/**
+ * Message reporting, so that the parse and data modules can pass
+ * information and errors back to their client without writing directly
+ * to the console.
+ *
+ * Messages are filtered by level and subsystem before they are formatted,
+ * so that unwanted verbose output costs almost nothing, and those which
+ * remain are held in a buffer until the client flushes it. Each report
+ * block has its own buffer, so separate compile contexts can report from
+ * separate threads, with each context's messages delivered in order.
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/* Local source headers. */
+
+#include "report.h"
+
+/**
+ * The maximum length of a reported message.
+ */
+
+#define REPORT_MAX_MESSAGE 1024
+
+/**
+ * The amount of message text which can be buffered before the buffer is
+ * flushed automatically.
+ */
+
+#define REPORT_FLUSH_THRESHOLD 65536
+
+/**
+ * The number of entries by which the entry list grows when it is full.
+ */
+
+#define REPORT_ENTRY_STEP 256
+
+/**
+ * A buffered message, waiting to be passed to the handler.
+ */
+
+struct report_entry {
+	enum report_level	level;		/**< The level of the message.				*/
+	enum report_subsystem	subsystem;	/**< The subsystem which reported the message.		*/
+	int			line;		/**< The source line to which it refers, or 0.		*/
+	int			column;		/**< The source column to which it refers, or 0.	*/
+	size_t			offset;		/**< The offset of the message in the text buffer.	*/
+};
+
+struct report_block {
+	report_handler		handler;	/**< The client's handler, or NULL for the default.	*/
+	void			*handle;	/**< The handle to pass to the client's handler.	*/
+
+	unsigned		verbose;	/**< The subsystems whose verbose messages are wanted.	*/
+	char			*file;		/**< The current source file, or NULL.			*/
+
+	struct report_entry	*entries;	/**< The buffered messages.				*/
+	int			entry_count;	/**< The number of buffered messages.			*/
+	int			entry_size;	/**< The number of entries allocated.			*/
+
+	char			*text;		/**< The buffered message text.				*/
+	size_t			text_length;	/**< The amount of text buffered.			*/
+	size_t			text_size;	/**< The space allocated for text.			*/
+};
+
+static void report_send(struct report_block *report, enum report_level level, enum report_subsystem subsystem,
+		int line, int column, char *format, va_list ap);
+static void report_write_default(struct report_block *report);
+
+/**
+ * Create a new report block, to pass messages to a handler.
+ *
+ * \param handler	The handler to receive messages, or NULL to write
+ *			them to stderr.
+ * \param *handle	A handle to pass to the handler.
+ * \return		Pointer to the new block, or NULL on failure.
+ */
+
+struct report_block *report_create(report_handler handler, void *handle)
+{
+	struct report_block	*report;
+
+	report = malloc(sizeof(struct report_block));
+	if (report == NULL)
+		return NULL;
+
+	report->handler = handler;
+	report->handle = handle;
+
+	report->verbose = REPORT_ALL;
+	report->file = NULL;
+
+	report->entries = NULL;
+	report->entry_count = 0;
+	report->entry_size = 0;
+
+	report->text = NULL;
+	report->text_length = 0;
+	report->text_size = 0;
+
+	return report;
+}
+
+/**
+ * Destroy a report block, flushing any messages still buffered.
+ *
+ * \param *report	The block to destroy.
+ */
+
+void report_destroy(struct report_block *report)
+{
+	if (report == NULL)
+		return;
+
+	report_flush(report);
+
+	free(report->file);
+	free(report->entries);
+	free(report->text);
+	free(report);
+}
+
+/**
+ * Set the subsystems whose verbose messages are to be reported. Errors
+ * and information messages are always reported.
+ *
+ * \param *report	The report block to update.
+ * \param subsystems	A mask of the subsystems to report verbose messages for.
+ */
+
+void report_set_verbose(struct report_block *report, unsigned subsystems)
+{
+	if (report != NULL)
+		report->verbose = subsystems;
+}
+
+/**
+ * Set the name of the source file to which subsequent messages refer.
+ *
+ * \param *report	The report block to update.
+ * \param *file		The name of the source file, or NULL for none.
+ */
+
+void report_set_file(struct report_block *report, char *file)
+{
+	if (report == NULL)
+		return;
+
+	/* Messages already buffered refer to the old name. */
+
+	report_flush(report);
+
+	free(report->file);
+	report->file = NULL;
+
+	if (file != NULL) {
+		report->file = malloc(strlen(file) + 1);
+		if (report->file != NULL)
+			strcpy(report->file, file);
+	}
+}
+
+/**
+ * Test whether messages of a given level from a given subsystem would be
+ * reported, so that callers can avoid doing work to produce them.
+ *
+ * \param *report	The report block to test.
+ * \param level		The level of the message.
+ * \param subsystem	The subsystem reporting the message.
+ * \return		True if the message would be reported; else False.
+ */
+
+bool report_wants(struct report_block *report, enum report_level level, enum report_subsystem subsystem)
+{
+	if (report == NULL)
+		return false;
+
+	if (level == REPORT_LEVEL_VERBOSE && (report->verbose & subsystem) == 0)
+		return false;
+
+	return true;
+}
+
+/**
+ * Pass all of the buffered messages to the handler, in the order in which
+ * they were reported, and empty the buffer.
+ *
+ * \param *report	The report block to flush.
+ */
+
+void report_flush(struct report_block *report)
+{
+	struct report_record	record;
+	int			i;
+
+	if (report == NULL || report->entry_count == 0)
+		return;
+
+	if (report->handler == NULL) {
+		report_write_default(report);
+	} else {
+		record.file = report->file;
+
+		for (i = 0; i < report->entry_count; i++) {
+			record.level = report->entries[i].level;
+			record.subsystem = report->entries[i].subsystem;
+			record.line = report->entries[i].line;
+			record.column = report->entries[i].column;
+			record.message = report->text + report->entries[i].offset;
+
+			report->handler(report->handle, &record);
+		}
+	}
+
+	report->entry_count = 0;
+	report->text_length = 0;
+}
+
+/**
+ * Report a general information message.
+ *
+ * \param *report	The report block to use.
+ * \param subsystem	The subsystem reporting the message.
+ * \param *format	A printf() format string for the message.
+ * \param ...		Parameters for the format string.
+ */
+
+void report_info(struct report_block *report, enum report_subsystem subsystem, char *format, ...)
+{
+	va_list	ap;
+
+	va_start(ap, format);
+	report_send(report, REPORT_LEVEL_INFO, subsystem, 0, 0, format, ap);
+	va_end(ap);
+}
+
+/**
+ * Report a verbose information message.
+ *
+ * \param *report	The report block to use.
+ * \param subsystem	The subsystem reporting the message.
+ * \param line		The source line to which the message refers, or 0.
+ * \param *format	A printf() format string for the message.
+ * \param ...		Parameters for the format string.
+ */
+
+void report_verbose(struct report_block *report, enum report_subsystem subsystem, int line, char *format, ...)
+{
+	va_list	ap;
+
+	va_start(ap, format);
+	report_send(report, REPORT_LEVEL_VERBOSE, subsystem, line, 0, format, ap);
+	va_end(ap);
+}
+
+/**
+ * Report an error.
+ *
+ * \param *report	The report block to use.
+ * \param subsystem	The subsystem reporting the error.
+ * \param line		The source line to which the error refers, or 0.
+ * \param column	The source column to which the error refers, or 0.
+ * \param *format	A printf() format string for the message.
+ * \param ...		Parameters for the format string.
+ */
+
+void report_error(struct report_block *report, enum report_subsystem subsystem, int line, int column, char *format, ...)
+{
+	va_list	ap;
+
+	va_start(ap, format);
+	report_send(report, REPORT_LEVEL_ERROR, subsystem, line, column, format, ap);
+	va_end(ap);
+}
+
+/**
+ * Format a message and add it to a report block's buffer, if it passes
+ * the block's filter.
+ *
+ * \param *report	The report block to use.
+ * \param level		The level of the message.
+ * \param subsystem	The subsystem reporting the message.
+ * \param line		The source line to which the message refers, or 0.
+ * \param column	The source column to which the message refers, or 0.
+ * \param *format	A printf() format string for the message.
+ * \param ap		Parameters for the format string.
+ */
+
+static void report_send(struct report_block *report, enum report_level level, enum report_subsystem subsystem,
+		int line, int column, char *format, va_list ap)
+{
+	struct report_entry	*entries, *entry;
+	char			*text;
+	size_t			size;
+	int			length;
+
+	if (!report_wants(report, level, subsystem))
+		return;
+
+	/* Make sure that there's space for the entry and the longest message. */
+
+	if (report->entry_count >= report->entry_size) {
+		entries = realloc(report->entries, sizeof(struct report_entry) * (report->entry_size + REPORT_ENTRY_STEP));
+		if (entries == NULL)
+			return;
+
+		report->entries = entries;
+		report->entry_size += REPORT_ENTRY_STEP;
+	}
+
+	if (report->text_length + REPORT_MAX_MESSAGE > report->text_size) {
+		size = report->text_size + REPORT_FLUSH_THRESHOLD / 4 + REPORT_MAX_MESSAGE;
+
+		text = realloc(report->text, size);
+		if (text == NULL)
+			return;
+
+		report->text = text;
+		report->text_size = size;
+	}
+
+	length = vsnprintf(report->text + report->text_length, REPORT_MAX_MESSAGE, format, ap);
+	if (length < 0)
+		return;
+	if (length >= REPORT_MAX_MESSAGE)
+		length = REPORT_MAX_MESSAGE - 1;
+
+	entry = report->entries + report->entry_count++;
+
+	entry->level = level;
+	entry->subsystem = subsystem;
+	entry->line = line;
+	entry->column = column;
+	entry->offset = report->text_length;
+
+	report->text_length += length + 1;
+
+	if (report->text_length >= REPORT_FLUSH_THRESHOLD)
+		report_flush(report);
+}
+
+/**
+ * Write the buffered messages to stderr in a single operation, with
+ * details of their location in the source.
+ *
+ * \param *report	The report block to write out.
+ */
+
+static void report_write_default(struct report_block *report)
+{
+	struct report_entry	*entry;
+	char			*output, *message;
+	size_t			size, length = 0;
+	int			i;
+
+	/* Allow for the message text, plus the location and newline. */
+
+	size = report->text_length + report->entry_count * 48;
+
+	output = malloc(size);
+
+	for (i = 0; i < report->entry_count; i++) {
+		entry = report->entries + i;
+		message = report->text + entry->offset;
+
+		if (output == NULL) {
+			if (entry->line > 0 && entry->column > 0)
+				fprintf(stderr, "%s at line %d, column %d\n", message, entry->line, entry->column);
+			else if (entry->line > 0)
+				fprintf(stderr, "%s at line %d\n", message, entry->line);
+			else
+				fprintf(stderr, "%s\n", message);
+		} else if (entry->line > 0 && entry->column > 0) {
+			length += sprintf(output + length, "%s at line %d, column %d\n", message, entry->line, entry->column);
+		} else if (entry->line > 0) {
+			length += sprintf(output + length, "%s at line %d\n", message, entry->line);
+		} else {
+			length += sprintf(output + length, "%s\n", message);
+		}
+	}
+
+	if (output != NULL) {
+		fwrite(output, sizeof(char), length, stderr);
+		free(output);
+	}
+}
+
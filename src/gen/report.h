@@ -0,0 +1,89 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+#ifndef MENUGEN_REPORT_H
+#define MENUGEN_REPORT_H
+
+#include <stdbool.h>
+
+/**
+ * The levels of message which can be reported, in decreasing order of
+ * severity.
+ */
+
+enum report_level {
+	REPORT_LEVEL_ERROR,		/**< An error in the source or during compilation.		*/
+	REPORT_LEVEL_INFO,		/**< General information about the compilation.		*/
+	REPORT_LEVEL_VERBOSE		/**< Detailed information, for verbose output.			*/
+};
+
+/**
+ * The subsystems which can report messages. Each is a single bit, so that
+ * sets of subsystems can be given as masks.
+ */
+
+enum report_subsystem {
+	REPORT_PARSE = 0x01,		/**< The source file parser.					*/
+	REPORT_CHECK = 0x02,		/**< The reference checks.					*/
+	REPORT_STRUCTURE = 0x04,	/**< The structure report.					*/
+	REPORT_OUTPUT = 0x08,		/**< The output file writer.					*/
+	REPORT_ALL = 0x0f		/**< All of the subsystems.					*/
+};
+
+/**
+ * A reported message, as passed to a handler.
+ */
+
+struct report_record {
+	enum report_level	level;		/**< The level of the message.				*/
+	enum report_subsystem	subsystem;	/**< The subsystem which reported the message.		*/
+	char			*file;		/**< The source file to which it refers, or NULL.	*/
+	int			line;		/**< The source line to which it refers, or 0.		*/
+	int			column;		/**< The source column to which it refers, or 0.	*/
+	char			*message;	/**< The message text, without a trailing newline.	*/
+};
+
+/**
+ * A handler to receive reported messages.
+ *
+ * \param *handle	The handle supplied when the report block was created.
+ * \param *record	The message being reported. The record and its
+ *			strings are only valid for the duration of the call.
+ */
+
+typedef void (*report_handler)(void *handle, struct report_record *record);
+
+struct report_block;
+
+struct report_block *report_create(report_handler handler, void *handle);
+void report_destroy(struct report_block *report);
+void report_set_verbose(struct report_block *report, unsigned subsystems);
+void report_set_file(struct report_block *report, char *file);
+bool report_wants(struct report_block *report, enum report_level level, enum report_subsystem subsystem);
+void report_flush(struct report_block *report);
+void report_info(struct report_block *report, enum report_subsystem subsystem, char *format, ...);
+void report_verbose(struct report_block *report, enum report_subsystem subsystem, int line, char *format, ...);
+void report_error(struct report_block *report, enum report_subsystem subsystem, int line, int column, char *format, ...);
+
+#endif
+
@@ -23,84 +23,124 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 /* Local source headers. */
 
 #include "stack.h"
 
-static int stack_size = 0;
-static int stack_ptr = -1;
-static int *stack = NULL;
-
 /**
- * Initialise the stack.
+ * Initialise a stack, which will initially use the storage in its own
+ * block and then move to the heap if it needs to grow beyond that.
  *
- * \param size		The number of integers that the stack will hold.
- * \return		True if the initialise was successful; else False.
+ * \param *stack	The stack to initialise.
+ * \param limit		The maximum number of integers that the stack
+ *			may grow to hold.
  */
 
-bool stack_initialise(int size)
+void stack_initialise(struct stack_block *stack, int limit)
 {
-	stack_size = size;
-	stack_ptr = -1;
-
-	stack = (int *) malloc(sizeof(int) * stack_size);
+	if (stack == NULL)
+		return;
 
-	return (stack == NULL) ? false : true;
+	stack->size = STACK_LOCAL_SIZE;
+	stack->limit = limit;
+	stack->ptr = -1;
+	stack->stack = stack->local;
 }
 
 /**
- * Terminate the stack and free the resources it uses.
+ * Terminate a stack, freeing any heap memory that it has claimed. The
+ * stack block itself is left to the caller.
+ *
+ * \param *stack	The stack to terminate.
  */
 
-void stack_terminate(void)
+void stack_terminate(struct stack_block *stack)
 {
-	if (stack != NULL)
-		free(stack);
+	if (stack == NULL)
+		return;
 
-	stack = NULL;
-	stack_ptr = -1;
-	stack_size = 0;
+	if (stack->stack != stack->local)
+		free(stack->stack);
+
+	stack->stack = stack->local;
+	stack->size = STACK_LOCAL_SIZE;
+	stack->ptr = -1;
 }
 
 /**
- * Push a value on to the stack.
+ * Push a value on to a stack, growing the stack if required.
  *
- * \Param  value	The value to push on to the stack.
+ * \param *stack	The stack to push the value on to.
+ * \param value		The value to push on to the stack.
+ * \return		True if the value was pushed; False if the stack
+ *			has reached its limit or memory could not be claimed.
  */
 
-void stack_push(int value)
+bool stack_push(struct stack_block *stack, int value)
 {
-	if ((stack != NULL) && (stack_ptr < (stack_size-1)))
-		stack[++stack_ptr] = value;
+	int	*data, size;
+
+	if (stack == NULL)
+		return false;
+
+	if (stack->ptr >= stack->size - 1) {
+		if (stack->size >= stack->limit)
+			return false;
+
+		size = stack->size * 2;
+		if (size > stack->limit)
+			size = stack->limit;
+
+		if (stack->stack == stack->local) {
+			data = malloc(sizeof(int) * size);
+			if (data != NULL)
+				memcpy(data, stack->local, sizeof(int) * stack->size);
+		} else {
+			data = realloc(stack->stack, sizeof(int) * size);
+		}
+
+		if (data == NULL)
+			return false;
+
+		stack->stack = data;
+		stack->size = size;
+	}
+
+	stack->stack[++stack->ptr] = value;
+
+	return true;
 }
 
 /**
- * Pop a value off the stack.
+ * Pop a value off a stack.
  *
- * \Return		The value from the top of the stack (or -1 if the
+ * \param *stack	The stack to pop the value from.
+ * \return		The value from the top of the stack (or -1 if the
  *			stack is empty).
  */
 
-int stack_pop(void)
+int stack_pop(struct stack_block *stack)
 {
-	if ((stack != NULL) && (stack_ptr > -1))
-		return stack[stack_ptr--];
+	if ((stack != NULL) && (stack->ptr > -1))
+		return stack->stack[stack->ptr--];
 	else
 		return STACK_EMPTY;
 }
 
 /**
- * Return the value from the top of the stack, leaving it in situ.
+ * Return the value from the top of a stack, leaving it in situ.
  *
- * \Return		The value from the top of the stack (or -1 if the
+ * \param *stack	The stack to read the value from.
+ * \return		The value from the top of the stack (or -1 if the
  *			stack is empty).
  */
 
-int stack_top(void)
+int stack_top(struct stack_block *stack)
 {
-	if ((stack != NULL) && (stack_ptr > -1))
-		return stack[stack_ptr];
+	if ((stack != NULL) && (stack->ptr > -1))
+		return stack->stack[stack->ptr];
 	else
 		return STACK_EMPTY;
 }
@@ -28,11 +28,31 @@
 
 #define STACK_EMPTY -1
 
-bool stack_initialise(int size);
-void stack_terminate(void);
-void stack_push(int value);
-int stack_pop(void);
-int stack_top(void);
+/**
+ * The number of values which a stack holds before it spills to the heap.
+ */
+
+#define STACK_LOCAL_SIZE 32
+
+/**
+ * A stack of integers. The structure is public so that stacks can be
+ * embedded in other blocks or created on the C stack; its contents should
+ * only be accessed through the stack_* functions.
+ */
+
+struct stack_block {
+	int	size;				/**< The number of integers that the stack can hold.	*/
+	int	limit;				/**< The maximum size that the stack can grow to.	*/
+	int	ptr;				/**< The index of the top item, or -1 if empty.		*/
+	int	*stack;				/**< The stack data.					*/
+	int	local[STACK_LOCAL_SIZE];	/**< Storage for the first few items.			*/
+};
+
+void stack_initialise(struct stack_block *stack, int limit);
+void stack_terminate(struct stack_block *stack);
+bool stack_push(struct stack_block *stack, int value);
+int stack_pop(struct stack_block *stack);
+int stack_top(struct stack_block *stack);
 
 #endif
 
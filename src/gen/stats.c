@@ -0,0 +1,227 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+/**
+ * Machine-readable compile statistics, written as a JSON file with one
+ * record for each job processed.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Local source headers. */
+
+#include "stats.h"
+
+#include "compile.h"
+#include "counters.h"
+#include "json.h"
+#include "memory.h"
+
+struct stats_block {
+	FILE			*file;		/**< The file to which the statistics are written.	*/
+	int			jobs;		/**< The number of jobs written so far.			*/
+	bool			error;		/**< True if a write has failed.			*/
+};
+
+static void stats_write_memory_usage(FILE *file, struct memory_usage *usage);
+static void stats_write_counters(FILE *file, struct counter_block *counters);
+
+/**
+ * Create a new statistics file.
+ *
+ * \param *filename	The name of the file to write the statistics to.
+ * \return		Pointer to the new statistics block, or NULL on failure.
+ */
+
+struct stats_block *stats_create(char *filename)
+{
+	struct stats_block	*stats;
+
+	if (filename == NULL)
+		return NULL;
+
+	stats = malloc(sizeof(struct stats_block));
+	if (stats == NULL)
+		return NULL;
+
+	stats->file = fopen(filename, "w");
+	stats->jobs = 0;
+	stats->error = false;
+
+	if (stats->file == NULL) {
+		free(stats);
+		return NULL;
+	}
+
+	fprintf(stats->file, "{\"jobs\":[");
+
+	return stats;
+}
+
+/**
+ * Destroy a statistics block, completing the file and closing it.
+ *
+ * \param *stats	The statistics block to destroy.
+ * \return		True if the file was written successfully; else False.
+ */
+
+bool stats_destroy(struct stats_block *stats)
+{
+	bool	success;
+
+	if (stats == NULL)
+		return true;
+
+	fprintf(stats->file, "\n]}\n");
+
+	success = (!stats->error && !ferror(stats->file)) ? true : false;
+
+	if (fclose(stats->file) != 0)
+		success = false;
+
+	free(stats);
+
+	return success;
+}
+
+/**
+ * Write the statistics for a job to a statistics file.
+ *
+ * \param *stats	The statistics block to write to, or NULL for none.
+ * \param *source	The name of the job's source file.
+ * \param *output	The name of the job's output file, or NULL.
+ * \param success	True if the job succeeded; else False.
+ * \param *statistics	The statistics collected from the job.
+ * \param parse_time	The time taken to parse the source, in microseconds.
+ * \param total_time	The time taken by the whole job, in microseconds.
+ */
+
+void stats_write_job(struct stats_block *stats, char *source, char *output, bool success,
+		struct compile_statistics *statistics, double parse_time, double total_time)
+{
+	FILE			*file;
+	enum memory_category	category;
+
+	if (stats == NULL || statistics == NULL)
+		return;
+
+	file = stats->file;
+
+	fprintf(file, (stats->jobs++ > 0) ? ",\n{" : "\n{");
+
+	fprintf(file, "\"source\":");
+	json_write_string(file, source);
+	fprintf(file, ",\"output\":");
+	json_write_string(file, output);
+	fprintf(file, ",\"success\":%s", (success) ? "true" : "false");
+
+	fprintf(file, ",\"source_bytes\":%lu,\"source_lines\":%d,\"statements\":%d",
+			(unsigned long) statistics->source.bytes, statistics->source.lines, statistics->source.statements);
+
+	fprintf(file, ",\"counts\":{\"menus\":%d,\"items\":%d,\"indirected\":%d,\"validations\":%d,\"dialogues\":%d}",
+			statistics->output.menus, statistics->output.items, statistics->output.indirected,
+			statistics->output.validations, statistics->output.dialogues);
+
+	fprintf(file, ",\"bytes\":{\"head\":%d,\"menus\":%d,\"indirection\":%d,\"validation\":%d,\"dialogue_tags\":%d,\"menu_tags\":%d,\"total\":%d}",
+			statistics->output.head_bytes, statistics->output.menu_bytes, statistics->output.indirection_bytes,
+			statistics->output.validation_bytes, statistics->output.dialogue_tag_bytes,
+			statistics->output.menu_tag_bytes, statistics->output.file_bytes);
+
+	fprintf(file, ",\"longest\":{\"indirection\":%d,\"validation\":%d,\"dialogue_tag\":%d,\"menu_tag\":%d}",
+			statistics->output.longest_indirection, statistics->output.longest_validation,
+			statistics->output.longest_dbox_chain, statistics->output.longest_menu_tag);
+
+	fprintf(file, ",\"memory\":{");
+	for (category = 0; category < MEMORY_CATEGORIES; category++) {
+		fprintf(file, "\"%s\":", memory_category_name(category));
+		stats_write_memory_usage(file, &statistics->memory.category[category]);
+		fprintf(file, ",");
+	}
+	fprintf(file, "\"total\":");
+	stats_write_memory_usage(file, &statistics->memory.total);
+	fprintf(file, "}");
+
+	if (counters_enabled())
+		stats_write_counters(file, &statistics->counters);
+
+	fprintf(file, ",\"time\":{\"parse_ms\":%.3f,\"total_ms\":%.3f}", parse_time / 1000.0, total_time / 1000.0);
+
+	fprintf(file, ",\"parse_bytes_per_second\":%.0f",
+			(parse_time > 0.0) ? (double) statistics->source.bytes * 1000000.0 / parse_time : 0.0);
+
+	if (fprintf(file, "}") < 0)
+		stats->error = true;
+
+	fflush(file);
+}
+
+/**
+ * Write a set of memory usage counts to a statistics file as a JSON object.
+ *
+ * \param *file		The file to write to.
+ * \param *usage	The usage counts to write.
+ */
+
+static void stats_write_memory_usage(FILE *file, struct memory_usage *usage)
+{
+	fprintf(file, "{\"allocations\":%d,\"allocated\":%lu,\"live\":%lu,\"peak\":%lu}",
+			usage->allocations, (unsigned long) usage->allocated,
+			(unsigned long) usage->live, (unsigned long) usage->peak);
+}
+
+/**
+ * Write a set of hot-path counters to a statistics file, as a JSON object
+ * preceded by a comma.
+ *
+ * \param *file		The file to write to.
+ * \param *counters	The counters to write.
+ */
+
+static void stats_write_counters(FILE *file, struct counter_block *counters)
+{
+	enum counter_id	id;
+	int		command;
+	bool		first = true;
+
+	fprintf(file, ",\"counters\":{");
+
+	for (id = 0; id < COUNTER_COUNT; id++)
+		fprintf(file, "%s\"%s\":%lu", (id > 0) ? "," : "", counters_name(id), counters->value[id]);
+
+	fprintf(file, ",\"commands\":[");
+
+	for (command = 0; command < COUNTER_MAX_COMMANDS; command++) {
+		if (counters->command_name[command] == NULL)
+			continue;
+
+		fprintf(file, "%s{\"command\":", (first) ? "" : ",");
+		json_write_string(file, counters->command_name[command]);
+		fprintf(file, ",\"dispatched\":%lu}", counters->command[command]);
+		first = false;
+	}
+
+	fprintf(file, "]}");
+}
+
@@ -0,0 +1,39 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+#ifndef MENUGEN_STATS_H
+#define MENUGEN_STATS_H
+
+#include <stdbool.h>
+
+#include "compile.h"
+
+struct stats_block;
+
+struct stats_block *stats_create(char *filename);
+bool stats_destroy(struct stats_block *stats);
+void stats_write_job(struct stats_block *stats, char *source, char *output, bool success,
+		struct compile_statistics *statistics, double parse_time, double total_time);
+
+#endif
+
@@ -0,0 +1,166 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+/**
+ * Timing and trace output, which records how long each stage of a
+ * compilation takes as a Chrome trace event file that can be loaded into
+ * a trace viewer.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Local source headers. */
+
+#include "trace.h"
+
+#include "json.h"
+
+/**
+ * The process and thread IDs used in the trace. All of the work happens
+ * on a single thread.
+ */
+
+#define TRACE_PROCESS_ID 1
+#define TRACE_THREAD_ID 1
+
+struct trace_block {
+	FILE			*file;		/**< The file to which the trace is written.	*/
+	bool			error;		/**< True if a write has failed.		*/
+};
+
+/**
+ * Return the current time in microseconds, measured from an arbitrary
+ * point. A monotonic clock is used where the system has one.
+ *
+ * \return		The current time, in microseconds.
+ */
+
+double trace_time(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec	now;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &now) == 0)
+		return (double) now.tv_sec * 1000000.0 + (double) now.tv_nsec / 1000.0;
+#endif
+
+	return (double) clock() * 1000000.0 / (double) CLOCKS_PER_SEC;
+}
+
+/**
+ * Create a new trace, opening the file that it will be written to.
+ *
+ * \param *filename	The name of the file to write the trace to.
+ * \return		Pointer to the new trace, or NULL on failure.
+ */
+
+struct trace_block *trace_create(char *filename)
+{
+	struct trace_block	*trace;
+
+	if (filename == NULL)
+		return NULL;
+
+	trace = malloc(sizeof(struct trace_block));
+	if (trace == NULL)
+		return NULL;
+
+	trace->file = fopen(filename, "w");
+	trace->error = false;
+
+	if (trace->file == NULL) {
+		free(trace);
+		return NULL;
+	}
+
+	fprintf(trace->file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(trace->file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"menugen\"}},\n",
+			TRACE_PROCESS_ID, TRACE_THREAD_ID);
+	fprintf(trace->file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"main\"}}",
+			TRACE_PROCESS_ID, TRACE_THREAD_ID);
+
+	return trace;
+}
+
+/**
+ * Destroy a trace, completing the file and closing it.
+ *
+ * \param *trace	The trace to destroy.
+ * \return		True if the trace was written successfully; else False.
+ */
+
+bool trace_destroy(struct trace_block *trace)
+{
+	bool	success;
+
+	if (trace == NULL)
+		return true;
+
+	fprintf(trace->file, "\n]}\n");
+
+	success = (!trace->error && !ferror(trace->file)) ? true : false;
+
+	if (fclose(trace->file) != 0)
+		success = false;
+
+	free(trace);
+
+	return success;
+}
+
+/**
+ * Add a complete event to a trace.
+ *
+ * \param *trace	The trace to add the event to, or NULL for none.
+ * \param *name		The name of the event.
+ * \param *category	The category of the event.
+ * \param *file		The name of the file being processed, or NULL.
+ * \param start		The time at which the event started, from trace_time().
+ * \param end		The time at which the event ended, from trace_time().
+ */
+
+void trace_event(struct trace_block *trace, char *name, char *category, char *file, double start, double end)
+{
+	if (trace == NULL || name == NULL || category == NULL)
+		return;
+
+	fprintf(trace->file, ",\n{\"name\":");
+	json_write_string(trace->file, name);
+	fprintf(trace->file, ",\"cat\":");
+	json_write_string(trace->file, category);
+	fprintf(trace->file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d",
+			start, end - start, TRACE_PROCESS_ID, TRACE_THREAD_ID);
+
+	if (file != NULL) {
+		fprintf(trace->file, ",\"args\":{\"file\":");
+		json_write_string(trace->file, file);
+		fprintf(trace->file, "}");
+	}
+
+	if (fprintf(trace->file, "}") < 0)
+		trace->error = true;
+}
+
@@ -0,0 +1,37 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+#ifndef MENUGEN_TRACE_H
+#define MENUGEN_TRACE_H
+
+#include <stdbool.h>
+
+struct trace_block;
+
+double trace_time(void);
+struct trace_block *trace_create(char *filename);
+bool trace_destroy(struct trace_block *trace);
+void trace_event(struct trace_block *trace, char *name, char *category, char *file, double start, double end);
+
+#endif
+
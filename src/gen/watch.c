@@ -0,0 +1,282 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+/**
+ * Watch source files for changes. This uses inotify, and so is only
+ * available on Linux; on other platforms, watch_create() will always
+ * fail.
+ *
+ * The directories holding the files are watched, rather than the files
+ * themselves, so that editors which save by writing a new file and then
+ * renaming it over the old one are still spotted.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+/* Local source headers. */
+
+#include "watch.h"
+
+/**
+ * The time to wait for further events after a change, in milliseconds,
+ * so that multiple writes to the same file result in a single update.
+ */
+
+#define WATCH_SETTLE_TIME 100
+
+/**
+ * The size of the buffer used to read inotify events.
+ */
+
+#define WATCH_EVENT_BUFFER 4096
+
+struct watch_file {
+	int			descriptor;	/**< The inotify watch descriptor for the file's directory.	*/
+	char			*leafname;	/**< Pointer to the file's leafname within the filename.	*/
+	bool			changed;	/**< True if the file has changed since the last wait.		*/
+};
+
+struct watch_block {
+	int			handle;		/**< The inotify instance handle.				*/
+	int			files;		/**< The number of files being watched.				*/
+	struct watch_file	*file_list;	/**< The array of files being watched.				*/
+};
+
+#ifdef __linux__
+static void watch_read_events(struct watch_block *watch);
+#endif
+
+/**
+ * Create a new, empty, watch block.
+ *
+ * \return		Pointer to the new block, or NULL on failure.
+ */
+
+struct watch_block *watch_create(void)
+{
+#ifdef __linux__
+	struct watch_block	*watch;
+
+	watch = malloc(sizeof(struct watch_block));
+	if (watch == NULL)
+		return NULL;
+
+	watch->handle = inotify_init();
+	watch->files = 0;
+	watch->file_list = NULL;
+
+	if (watch->handle == -1) {
+		free(watch);
+		return NULL;
+	}
+
+	return watch;
+#else
+	return NULL;
+#endif
+}
+
+/**
+ * Destroy a watch block, freeing the resources that it uses.
+ *
+ * \param *watch	The watch block to destroy.
+ */
+
+void watch_destroy(struct watch_block *watch)
+{
+	if (watch == NULL)
+		return;
+
+#ifdef __linux__
+	close(watch->handle);
+#endif
+
+	if (watch->file_list != NULL)
+		free(watch->file_list);
+
+	free(watch);
+}
+
+/**
+ * Add a file to a watch block. The filename is referenced by the block,
+ * and so must remain valid until the block is destroyed.
+ *
+ * \param *watch	The watch block to add the file to.
+ * \param *filename	The name of the file to be watched.
+ * \return		A handle for the file, or -1 on failure.
+ */
+
+int watch_add_file(struct watch_block *watch, char *filename)
+{
+#ifdef __linux__
+	struct watch_file	*list;
+	char			*directory, *leafname;
+	int			descriptor;
+
+	if (watch == NULL || filename == NULL)
+		return -1;
+
+	/* Find the directory containing the file. */
+
+	leafname = strrchr(filename, '/');
+
+	if (leafname == NULL) {
+		leafname = filename;
+		descriptor = inotify_add_watch(watch->handle, ".", IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	} else {
+		directory = malloc(leafname - filename + 2);
+		if (directory == NULL)
+			return -1;
+
+		strncpy(directory, filename, leafname - filename + 1);
+		directory[leafname - filename + 1] = '\0';
+		leafname++;
+
+		descriptor = inotify_add_watch(watch->handle, directory, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+
+		free(directory);
+	}
+
+	if (descriptor == -1)
+		return -1;
+
+	list = realloc(watch->file_list, sizeof(struct watch_file) * (watch->files + 1));
+	if (list == NULL)
+		return -1;
+
+	watch->file_list = list;
+
+	list[watch->files].descriptor = descriptor;
+	list[watch->files].leafname = leafname;
+	list[watch->files].changed = false;
+
+	return watch->files++;
+#else
+	return -1;
+#endif
+}
+
+/**
+ * Wait until one or more of the files in a watch block has changed. The
+ * files which have changed can then be identified using watch_changed().
+ *
+ * \param *watch	The watch block to wait on.
+ * \return		True if one or more files changed; False on error.
+ */
+
+bool watch_wait(struct watch_block *watch)
+{
+#ifdef __linux__
+	struct pollfd	poll_data;
+	bool		changed = false;
+	int		file;
+
+	if (watch == NULL || watch->files == 0)
+		return false;
+
+	for (file = 0; file < watch->files; file++)
+		watch->file_list[file].changed = false;
+
+	poll_data.fd = watch->handle;
+	poll_data.events = POLLIN;
+
+	while (!changed) {
+		if (poll(&poll_data, 1, -1) == -1)
+			return false;
+
+		/* Collect events until things settle down. */
+
+		do {
+			watch_read_events(watch);
+		} while (poll(&poll_data, 1, WATCH_SETTLE_TIME) > 0);
+
+		for (file = 0; file < watch->files; file++) {
+			if (watch->file_list[file].changed)
+				changed = true;
+		}
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Test whether a file in a watch block changed during the last call
+ * to watch_wait().
+ *
+ * \param *watch	The watch block holding the file.
+ * \param file		The handle of the file to test.
+ * \return		True if the file has changed; else False.
+ */
+
+bool watch_changed(struct watch_block *watch, int file)
+{
+	if (watch == NULL || file < 0 || file >= watch->files)
+		return false;
+
+	return watch->file_list[file].changed;
+}
+
+#ifdef __linux__
+
+/**
+ * Read a batch of pending events from inotify, and flag any of the
+ * watched files to which they refer.
+ *
+ * \param *watch	The watch block to read events for.
+ */
+
+static void watch_read_events(struct watch_block *watch)
+{
+	char			buffer[WATCH_EVENT_BUFFER];
+	struct inotify_event	*event;
+	ssize_t			length, position;
+	int			file;
+
+	length = read(watch->handle, buffer, WATCH_EVENT_BUFFER);
+
+	for (position = 0; position < length; position += sizeof(struct inotify_event) + event->len) {
+		event = (struct inotify_event *) (buffer + position);
+
+		if (event->len == 0)
+			continue;
+
+		for (file = 0; file < watch->files; file++) {
+			if (watch->file_list[file].descriptor == event->wd && strcmp(watch->file_list[file].leafname, event->name) == 0)
+				watch->file_list[file].changed = true;
+		}
+	}
+}
+
+#endif
+
@@ -0,0 +1,38 @@
+/* Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuGen:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+#ifndef MENUGEN_WATCH_H
+#define MENUGEN_WATCH_H
+
+#include <stdbool.h>
+
+struct watch_block;
+
+struct watch_block *watch_create(void);
+void watch_destroy(struct watch_block *watch);
+int watch_add_file(struct watch_block *watch, char *filename);
+bool watch_wait(struct watch_block *watch);
+bool watch_changed(struct watch_block *watch, int file);
+
+#endif
+
@@ -0,0 +1,110 @@
+/* Copyright 2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuTest:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Local source headers. */
+
+#include "decompress.h"
+
+
+/**
+ * Decompress a block of data packed by MenuGen's compressor.
+ *
+ * \param *input	Pointer to the compressed data.
+ * \param length	The length of the compressed data, in bytes.
+ * \param *output	Pointer to a buffer to take the decompressed data.
+ * \param size		The size of the output buffer, in bytes.
+ * \return		The number of bytes decompressed, or -1 if the data
+ *			was corrupt or wouldn't fit into the buffer.
+ */
+
+long decompress_block(uint8_t *input, size_t length, uint8_t *output, size_t size)
+{
+	uint8_t	*in = input, *in_end = input + length;
+	uint8_t	*out = output, *out_end = output + size;
+	uint8_t	*match;
+	size_t	count, distance;
+	int	token, extra;
+
+	while (in < in_end) {
+		token = *in++;
+
+		/* Copy the literals. */
+
+		count = token >> 4;
+
+		if (count == 15) {
+			do {
+				if (in >= in_end)
+					return -1;
+
+				extra = *in++;
+				count += extra;
+			} while (extra == 255);
+		}
+
+		if (count > (size_t) (in_end - in) || count > (size_t) (out_end - out))
+			return -1;
+
+		while (count-- > 0)
+			*out++ = *in++;
+
+		/* The final block has no match. */
+
+		if (in == in_end)
+			break;
+
+		/* Copy the match, which may overlap the output. */
+
+		if (in_end - in < 2)
+			return -1;
+
+		distance = in[0] | (in[1] << 8);
+		in += 2;
+
+		count = (token & 0x0f) + 4;
+
+		if ((token & 0x0f) == 15) {
+			do {
+				if (in >= in_end)
+					return -1;
+
+				extra = *in++;
+				count += extra;
+			} while (extra == 255);
+		}
+
+		if (distance == 0 || distance > (size_t) (out - output) || count > (size_t) (out_end - out))
+			return -1;
+
+		match = out - distance;
+
+		while (count-- > 0)
+			*out++ = *match++;
+	}
+
+	return out - output;
+}
+
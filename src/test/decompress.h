@@ -0,0 +1,48 @@
+/* Copyright 2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuTest:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+
+#ifndef MENUTEST_DECOMPRESS_H
+#define MENUTEST_DECOMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Decompress a block of data packed by MenuGen's compressor. The code uses
+ * no memory beyond the two buffers, calls no library functions and checks
+ * every length and distance against the buffers, so it can be copied as it
+ * stands into an application which needs to unpack compressed Menus files.
+ *
+ * \param *input	Pointer to the compressed data.
+ * \param length	The length of the compressed data, in bytes.
+ * \param *output	Pointer to a buffer to take the decompressed data.
+ * \param size		The size of the output buffer, in bytes.
+ * \return		The number of bytes decompressed, or -1 if the data
+ *			was corrupt or wouldn't fit into the buffer.
+ */
+
+long decompress_block(uint8_t *input, size_t length, uint8_t *output, size_t size);
+
+#endif
+
@@ -21,14 +21,21 @@
  * permissions and limitations under the Licence.
  */
 
+#include <stdbool.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
 
+/* We use types from this, but don't try to link to any subroutines! */
+
+#include "oslib/wimp.h"
 
 /* Local source headers. */
 
 #include "file.h"
+#include "decompress.h"
+
+#include "../file.h"
 
 
 /**
@@ -83,3 +90,74 @@ int8_t *file_load(char *filename, size_t *length)
 	return data;
 }
 
+
+/**
+ * Test whether a file in memory is a compressed container.
+ *
+ * \param *data		Pointer to the file data.
+ * \param length	The length of the file data.
+ * \return		True if the file is compressed; else False.
+ */
+
+bool file_is_compressed(int8_t *data, size_t length)
+{
+	struct file_extended_head_block	*extended_head;
+
+	if (data == NULL || length < sizeof(struct file_head_block) + sizeof(struct file_extended_head_block) +
+			sizeof(struct file_compression_head_block))
+		return false;
+
+	extended_head = (struct file_extended_head_block *) (data + sizeof(struct file_head_block));
+
+	return (extended_head->zero == 0 && (extended_head->flags & FILE_FLAGS_COMPRESSED)) ? true : false;
+}
+
+
+/**
+ * If a file in memory is a compressed container, replace it with the
+ * uncompressed file that it holds.
+ *
+ * \param *data		Pointer to the file data, which is freed if it
+ *			is replaced.
+ * \param *length	Pointer to the length of the file data, which is
+ *			updated if it is replaced.
+ * \return		Pointer to the uncompressed file, which is the
+ *			original data if it wasn't compressed, or NULL
+ *			on failure.
+ */
+
+int8_t *file_expand(int8_t *data, size_t *length)
+{
+	struct file_compression_head_block	*compression_head;
+	int8_t					*expanded;
+	size_t					offset;
+	long					expanded_length, target_length;
+
+	if (data == NULL || length == NULL || !file_is_compressed(data, *length))
+		return data;
+
+	offset = sizeof(struct file_head_block) + sizeof(struct file_extended_head_block);
+	compression_head = (struct file_compression_head_block *) (data + offset);
+	offset += sizeof(struct file_compression_head_block);
+
+	target_length = compression_head->length;
+
+	expanded = (target_length > 0) ? malloc(target_length) : NULL;
+	if (expanded == NULL) {
+		free(data);
+		return NULL;
+	}
+
+	expanded_length = decompress_block((uint8_t *) data + offset, *length - offset, (uint8_t *) expanded, target_length);
+
+	free(data);
+
+	if (expanded_length != target_length) {
+		free(expanded);
+		return NULL;
+	}
+
+	*length = expanded_length;
+
+	return expanded;
+}
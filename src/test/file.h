@@ -25,6 +25,8 @@
 #ifndef MENUTEST_FILE_H
 #define MENUTEST_FILE_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /**
@@ -38,5 +40,30 @@
 
 int8_t *file_load(char *filename, size_t *length);
 
+/**
+ * Test whether a file in memory is a compressed container.
+ *
+ * \param *data		Pointer to the file data.
+ * \param length	The length of the file data.
+ * \return		True if the file is compressed; else False.
+ */
+
+bool file_is_compressed(int8_t *data, size_t length);
+
+/**
+ * If a file in memory is a compressed container, replace it with the
+ * uncompressed file that it holds.
+ *
+ * \param *data		Pointer to the file data, which is freed if it
+ *			is replaced.
+ * \param *length	Pointer to the length of the file data, which is
+ *			updated if it is replaced.
+ * \return		Pointer to the uncompressed file, which is the
+ *			original data if it wasn't compressed, or NULL
+ *			on failure.
+ */
+
+int8_t *file_expand(int8_t *data, size_t *length);
+
 #endif
 
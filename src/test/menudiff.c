@@ -0,0 +1,106 @@
+/* Copyright 2015, Stephen Fryatt (info@stevefryatt.org.uk)
+ *
+ * This file is part of MenuTest:
+ *
+ *   http://www.stevefryatt.org.uk/risc-os/
+ *
+ * Licensed under the EUPL, Version 1.2 only (the "Licence");
+ * You may not use this work except in compliance with the
+ * Licence.
+ *
+ * You may obtain a copy of the Licence at:
+ *
+ *   http://joinup.ec.europa.eu/software/page/eupl
+ *
+ * Unless required by applicable law or agreed to in
+ * writing, software distributed under the Licence is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES
+ * OR CONDITIONS OF ANY KIND, either express or implied.
+ *
+ * See the Licence for the specific language governing
+ * permissions and limitations under the Licence.
+ */
+
+/* MenuDiff
+ *
+ * Compare two menu files generated by MenuGen byte for byte, and if they
+ * differ, report where the first difference lies in terms of the file's
+ * sections. Compressed files are expanded before they are compared.
+ *
+ * Syntax: MenuDiff <reference> <file>
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/* Local source headers. */
+
+#include "file.h"
+#include "parse.h"
+
+/**
+ * The length of a section description.
+ */
+
+#define MAX_DESCRIPTION 256
+
+int main(int argc, char *argv[])
+{
+	int8_t	*reference, *file;
+	size_t	reference_length, file_length, offset, common;
+	char	description[MAX_DESCRIPTION];
+	bool	found;
+	int	result = 0;
+
+	if (argc != 3) {
+		fprintf(stderr, "Usage: menudiff <reference> <file>\n");
+		return 2;
+	}
+
+	reference = file_expand(file_load(argv[1], &reference_length), &reference_length);
+	if (reference == NULL) {
+		fprintf(stderr, "Failed to load file '%s'\n", argv[1]);
+		return 2;
+	}
+
+	file = file_expand(file_load(argv[2], &file_length), &file_length);
+	if (file == NULL) {
+		fprintf(stderr, "Failed to load file '%s'\n", argv[2]);
+		free(reference);
+		return 2;
+	}
+
+	common = (reference_length < file_length) ? reference_length : file_length;
+
+	for (offset = 0; offset < common && reference[offset] == file[offset]; offset++);
+
+	if (offset < common) {
+		found = parse_describe_offset(reference, reference_length, offset, description, MAX_DESCRIPTION);
+
+		printf("%s differs from %s at byte %u (0x%02x, expected 0x%02x)\n", argv[2], argv[1],
+				(unsigned) offset, (uint8_t) file[offset], (uint8_t) reference[offset]);
+		printf("  in %s%s\n", description, (found) ? "" : " of the reference");
+
+		result = 1;
+	} else if (reference_length != file_length) {
+		printf("%s is %u bytes long, but %s is %u bytes\n", argv[2], (unsigned) file_length, argv[1], (unsigned) reference_length);
+
+		if (file_length > reference_length)
+			parse_describe_offset(file, file_length, reference_length, description, MAX_DESCRIPTION);
+		else
+			parse_describe_offset(reference, reference_length, file_length, description, MAX_DESCRIPTION);
+
+		printf("  from %s\n", description);
+
+		result = 1;
+	}
+
+	free(reference);
+	free(file);
+
+	return result;
+}
+
@@ -73,6 +73,17 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
+	if (file_is_compressed(data, length)) {
+		printf("\nCompressed file: %lu bytes.\n", (unsigned long) length);
+
+		data = file_expand(data, &length);
+
+		if (data == NULL) {
+			printf("Failed to decompress file\n");
+			return 1;
+		}
+	}
+
 	parse_process(data, length);
 
 	return 0;
@@ -43,8 +43,23 @@ static void	parse_process_indirected_data(int8_t *file, size_t length, int offse
 static void	parse_process_validation_data(int8_t *file, size_t length, int offset);
 static void	parse_process_dialogues(int8_t *file, size_t length, int offset);
 static void	parse_process_menu_names(int8_t *file, size_t length, int offset);
-static void	parse_process_menus(int8_t *file, size_t length, int offset);
+static void	parse_process_compact(int8_t *file, size_t length, int offset);
+static void	parse_process_relocations(int8_t *file, size_t length, int offset);
+static void	parse_process_compact_dialogues(int8_t *file, size_t length, int offset);
+static void	parse_process_compact_menu_names(int8_t *file, size_t length, int offset);
+static void	parse_process_menus(int8_t *file, size_t length, int offset, int end);
 static void	parse_print_heading(char *heading);
+static bool	parse_valid(size_t length, int offset, int size);
+static int	parse_word(int8_t *file, int offset);
+static int	parse_tag_block_length(int8_t *file, size_t length, int offset);
+static int	parse_offset(int word);
+static int	parse_compact_entry(int8_t *file, size_t length, int *offset);
+
+/**
+ * The base address of a relocated file, or zero.
+ */
+
+static int	parse_base = 0;
 
 
 /**
@@ -69,20 +84,43 @@ void parse_process(int8_t *file, size_t length)
 
 	struct file_head_block		*file_head = (struct file_head_block *) file;
 	struct file_extended_head_block	*extended_head = (struct file_extended_head_block *) (file + sizeof(struct file_head_block));
+	struct file_relocation_head_block	*relocation_head = (struct file_relocation_head_block *) (extended_head + 1);
+
+	parse_base = 0;
 
 	if (extended_head->zero == 0) {
 		printf("\nNew format file (extended header).\n");
 		printf("File flags: 0x%x\n", extended_head->flags);
-	
+
+		menu_offset += 16;
+
+		/* Relocated files hold addresses instead of offsets, which
+		 * must be turned back into offsets as they are used.
+		 */
+
+		if (extended_head->flags & FILE_FLAGS_RELOCATED) {
+			parse_base = relocation_head->base;
+			printf("Relocated to base address: 0x%x\n", parse_base);
+
+			menu_offset += 4;
+		}
+
+		/* Compact files have their own sections, and menu blocks
+		 * without the next and submenu words.
+		 */
+
+		if (extended_head->flags & FILE_FLAGS_COMPACT) {
+			parse_process_compact(file, length, menu_offset - 8);
+			return;
+		}
+
 		parse_print_heading("Menu Name Data");
 
 		if (extended_head->menus != -1) {
-			parse_process_menu_names(file, length, extended_head->menus);
+			parse_process_menu_names(file, length, parse_offset(extended_head->menus));
 		} else {
 			printf("  No Data\n");
 		}
-
-		menu_offset += 16;
 	} else {
 		printf("\nOld format file.\n");
 	}
@@ -90,7 +128,7 @@ void parse_process(int8_t *file, size_t length)
 	parse_print_heading("Dialogue Data");
 
 	if (file_head->dialogues != -1) {
-		parse_process_dialogues(file, length, file_head->dialogues);
+		parse_process_dialogues(file, length, parse_offset(file_head->dialogues));
 	} else {
 		printf("  No Data\n");
 	}
@@ -98,7 +136,7 @@ void parse_process(int8_t *file, size_t length)
 	parse_print_heading("Indirected Text Data");
 
 	if (file_head->indirection != -1) {
-		parse_process_indirected_data(file, length, file_head->indirection);
+		parse_process_indirected_data(file, length, parse_offset(file_head->indirection));
 	} else {
 		printf("  No Data\n");
 	}
@@ -106,13 +144,162 @@ void parse_process(int8_t *file, size_t length)
 	parse_print_heading("Validation String Data");
 
 	if (file_head->validation != -1) {
-		parse_process_validation_data(file, length, file_head->validation);
+		parse_process_validation_data(file, length, parse_offset(file_head->validation));
 	} else {
 		printf("  No Data\n");
 	}
 
 
-	parse_process_menus(file, length, menu_offset);
+	parse_process_menus(file, length, menu_offset, -1);
+}
+
+
+/**
+ * Process a compact format menu file, displaying details of its contents.
+ * The strings and submenus are already linked in as offsets, so there's
+ * nothing to fix up.
+ *
+ * \param *file		Pointer to the file data to be processed.
+ * \param length	The length of the data block.
+ * \param offset	The offset into the block of the first menu.
+ */
+
+static void parse_process_compact(int8_t *file, size_t length, int offset)
+{
+	struct file_head_block		*file_head = (struct file_head_block *) file;
+	struct file_extended_head_block	*extended_head = (struct file_extended_head_block *) (file + sizeof(struct file_head_block));
+
+	printf("Compact format file.\n");
+
+	parse_print_heading("Menu Name Data");
+
+	if (extended_head->menus != -1) {
+		parse_process_compact_menu_names(file, length, extended_head->menus);
+	} else {
+		printf("  No Data\n");
+	}
+
+	parse_print_heading("Dialogue Data");
+
+	if (file_head->dialogues != -1) {
+		parse_process_compact_dialogues(file, length, file_head->dialogues);
+	} else {
+		printf("  No Data\n");
+	}
+
+	parse_print_heading("Relocation Data");
+
+	parse_process_relocations(file, length, file_head->indirection);
+
+	parse_print_heading("String Pool");
+
+	printf("  %d bytes\n", ((file_head->dialogues != -1) ? file_head->dialogues :
+			((extended_head->menus != -1) ? extended_head->menus : (int) length)) - file_head->validation);
+
+	parse_process_menus(file, length, offset, file_head->indirection);
+}
+
+
+/**
+ * Process the relocation table in a compact file, checking that every entry
+ * falls within the menus and refers to a word holding an offset.
+ *
+ * \param *file		Pointer to the file data to be processed.
+ * \param length	The length of the data block.
+ * \param offset	The offset into the block of the relocation table.
+ */
+
+static void parse_process_relocations(int8_t *file, size_t length, int offset)
+{
+	struct file_compact_relocation_block	*table;
+	int					entry, word, position, errors = 0;
+
+	if (file == NULL || !parse_valid(length, offset, sizeof(struct file_compact_relocation_block)))
+		return;
+
+	table = (struct file_compact_relocation_block *) (file + offset);
+
+	position = offset + sizeof(struct file_compact_relocation_block);
+	word = 0;
+
+	for (entry = 0; entry < table->relocations; entry++) {
+		word += 4 * parse_compact_entry(file, length, &position);
+
+		if (word >= offset || parse_word(file, word) < 0 || (size_t) parse_word(file, word) >= length)
+			errors++;
+	}
+
+	printf("  %d words to relocate\n", table->relocations);
+
+	if (errors > 0)
+		printf("  %d invalid entries\n", errors);
+}
+
+
+/**
+ * Process the dialogue box table in a compact file, showing a list of boxes.
+ *
+ * \param *file		Pointer to the file data to be processed.
+ * \param length	The length of the data block.
+ * \param offset	The offset into the block of the dialogue table.
+ */
+
+static void parse_process_compact_dialogues(int8_t *file, size_t length, int offset)
+{
+	struct file_compact_dialogue_block	*table;
+	struct file_compact_chain_block		*chain;
+	int					block, entry, name, position;
+
+	if (file == NULL || !parse_valid(length, offset, sizeof(struct file_compact_dialogue_block)))
+		return;
+
+	table = (struct file_compact_dialogue_block *) (file + offset);
+	name = table->names;
+	offset += sizeof(struct file_compact_dialogue_block);
+
+	for (block = 0; block < table->chains && parse_valid(length, offset, sizeof(struct file_compact_chain_block)); block++) {
+		chain = (struct file_compact_chain_block *) (file + offset);
+
+		if (name == -1) {
+			printf("  Single dialogue chain (%d entries)\n", chain->dialogues);
+		} else {
+			printf("  Dialogue list: '%s'\n", (char *) (file + name));
+			name += strlen((char *) (file + name)) + 1;
+		}
+
+		position = offset + sizeof(struct file_compact_chain_block);
+
+		for (entry = 0; entry < chain->dialogues; entry++)
+			parse_compact_entry(file, length, &position);
+
+		offset += (position - offset + 3) & (~3);
+	}
+}
+
+
+/**
+ * Process the menu table in a compact file, showing a list of menus.
+ *
+ * \param *file		Pointer to the file data to be processed.
+ * \param length	The length of the data block.
+ * \param offset	The offset into the block of the menu table.
+ */
+
+static void parse_process_compact_menu_names(int8_t *file, size_t length, int offset)
+{
+	struct file_compact_tag_block	*table;
+	int				entry, name;
+
+	if (file == NULL || !parse_valid(length, offset, sizeof(struct file_compact_tag_block)))
+		return;
+
+	table = (struct file_compact_tag_block *) (file + offset);
+	name = table->names;
+
+	for (entry = 0; entry < table->menus; entry++) {
+		printf("  Menu entry: '%s'\n", (char *) (file + name));
+		name += strlen((char *) (file + name)) + 1;
+	}
 }
 
 
@@ -139,7 +326,7 @@ static void parse_process_indirected_data(int8_t *file, size_t length, int offse
 		if (data->location == -1)
 			continue;
 
-		indirection = (struct file_indirected_text *) (file + data->location);
+		indirection = (struct file_indirected_text *) (file + parse_offset(data->location));
 
 
 		printf("  %d bytes: '%s'\n", indirection->size, data->data);
@@ -179,7 +366,7 @@ static void parse_process_validation_data(int8_t *file, size_t length, int offse
 		if (data->location == -1)
 			continue;
 
-		indirection = (struct file_indirected_text *) (file + data->location - 4);
+		indirection = (struct file_indirected_text *) (file + parse_offset(data->location) - 4);
 
 
 		printf("  %d bytes: '%s'\n", data->length, data->data);
@@ -271,9 +458,12 @@ static void parse_process_menu_names(int8_t *file, size_t length, int offset)
  * \param *file		Pointer to the file data to be processed.
  * \param length	The length of the data block.
  * \param offset	The offset into the block of the menu tag data.
+ * \param end		The offset of the end of the menus in a compact file,
+ *			where each menu follows on from the last; or -1 to
+ *			follow the chain of menus.
  */
 
-static void parse_process_menus(int8_t *file, size_t length, int offset)
+static void parse_process_menus(int8_t *file, size_t length, int offset, int end)
 {
 	struct file_menu_block		*menu_block;
 	struct file_item_block		*item_block;
@@ -327,7 +517,10 @@ static void parse_process_menus(int8_t *file, size_t length, int offset)
 				item_block += 1;
 		} while (!last_item);
 
-		offset = menu_block->next;
+		if (end != -1)
+			offset = ((int8_t *) (item_block + 1) - file < end) ? (int8_t *) (item_block + 1) - file : -1;
+		else
+			offset = parse_offset(menu_block->next);
 	}
 
 }
@@ -356,3 +549,381 @@ static void parse_print_heading(char *heading)
 	putchar('\n');
 }
 
+
+/**
+ * Describe the part of a menu file in which a given offset falls, by walking
+ * the file's sections in the same way as the decoders above. Unlike them,
+ * the file is left untouched and every access is checked against its
+ * length, so that damaged files can be described safely.
+ *
+ * \param *file		Pointer to the file data to be described.
+ * \param length	The length of the data block.
+ * \param offset	The offset to be described.
+ * \param *description	Pointer to a buffer to take the description.
+ * \param size		The size of the description buffer.
+ * \return		True if the offset is in a known section; else False.
+ */
+
+bool parse_describe_offset(int8_t *file, size_t length, int offset, char *description, size_t size)
+{
+	struct file_head_block		*file_head;
+	struct file_menu_block		*menu_block;
+	struct file_item_block		*item_block;
+	char				title[FILE_ITEM_TEXT_LENGTH + 1];
+	int				menu_offset, menu_start, block, item, block_length, section, end;
+	bool				extended, relocated, compact;
+
+	snprintf(description, size, "beyond the known sections");
+
+	if (file == NULL || !parse_valid(length, 0, sizeof(struct file_head_block)))
+		return false;
+
+	file_head = (struct file_head_block *) file;
+
+	/* The file head and extended head. */
+
+	if (offset < sizeof(struct file_head_block)) {
+		snprintf(description, size, "file head, %s offset", (offset < 4) ? "dialogue" : ((offset < 8) ? "indirection" : "validation"));
+		return true;
+	}
+
+	extended = (parse_valid(length, sizeof(struct file_head_block), sizeof(struct file_extended_head_block)) &&
+			parse_word(file, sizeof(struct file_head_block)) == 0) ? true : false;
+
+	relocated = (extended && (parse_word(file, sizeof(struct file_head_block) + 4) & FILE_FLAGS_RELOCATED) &&
+			parse_valid(length, sizeof(struct file_head_block) + sizeof(struct file_extended_head_block),
+			sizeof(struct file_relocation_head_block))) ? true : false;
+
+	compact = (extended && (parse_word(file, sizeof(struct file_head_block) + 4) & FILE_FLAGS_COMPACT)) ? true : false;
+
+	parse_base = (relocated) ? parse_word(file, sizeof(struct file_head_block) + sizeof(struct file_extended_head_block)) : 0;
+
+	menu_offset = sizeof(struct file_head_block) + 8;
+
+	if (extended) {
+		if (offset < sizeof(struct file_head_block) + sizeof(struct file_extended_head_block)) {
+			section = (offset - sizeof(struct file_head_block)) / 4;
+			snprintf(description, size, "extended file head, %s", (section == 0) ? "zero word" :
+					((section == 1) ? "flags" : ((section == 2) ? "menu name offset" : "end word")));
+			return true;
+		}
+
+		menu_offset += sizeof(struct file_extended_head_block);
+	}
+
+	if (relocated) {
+		if (offset < menu_offset - 8 + sizeof(struct file_relocation_head_block)) {
+			snprintf(description, size, "relocation head, base address");
+			return true;
+		}
+
+		menu_offset += sizeof(struct file_relocation_head_block);
+	}
+
+	/* The menu and item blocks, following the chain of menus. In compact
+	 * files, the blocks start at the title and follow each other up to
+	 * the relocation table.
+	 */
+
+	if (compact)
+		menu_offset -= 8;
+
+	end = (compact) ? file_head->indirection : -1;
+
+	title[FILE_ITEM_TEXT_LENGTH] = '\0';
+
+	for (block = 0; menu_offset != -1 && parse_valid(length, menu_offset - 8, sizeof(struct file_menu_block)); block++) {
+		menu_block = (struct file_menu_block *) (file + menu_offset - 8);
+		item_block = (struct file_item_block *) (file + menu_offset - 8 + sizeof(struct file_menu_block));
+
+		if (parse_valid(length, menu_offset - 8 + sizeof(struct file_menu_block), sizeof(struct file_item_block)) &&
+				(item_block->menu_flags & wimp_MENU_TITLE_INDIRECTED))
+			snprintf(title, sizeof(title), "indirected");
+		else
+			strncpy(title, menu_block->title_data.text, FILE_ITEM_TEXT_LENGTH);
+
+		menu_start = (compact) ? menu_offset : menu_offset - 8;
+
+		if (offset >= menu_start && offset < menu_offset - 8 + sizeof(struct file_menu_block)) {
+			snprintf(description, size, "menu %d ('%s'), header byte %d", block, title, offset - (menu_offset - 8));
+			return true;
+		}
+
+		for (item = 0; (int8_t *) (item_block + 1) <= file + length; item++) {
+			if (offset >= (int8_t *) item_block - file && offset < (int8_t *) (item_block + 1) - file) {
+				snprintf(description, size, "menu %d ('%s'), item %d, byte %d", block, title, item, (int) (offset - ((int8_t *) item_block - file)));
+				return true;
+			}
+
+			if (item_block->menu_flags & wimp_MENU_LAST)
+				break;
+
+			item_block++;
+		}
+
+		if (compact) {
+			menu_offset = (int8_t *) (item_block + 1) - file;
+
+			if (menu_offset >= end)
+				break;
+
+			continue;
+		}
+
+		if (parse_offset(menu_block->next) == menu_offset)
+			break;
+
+		menu_offset = parse_offset(menu_block->next);
+	}
+
+	/* The sections in a compact file, which each run up to the next. */
+
+	if (compact) {
+		section = parse_word(file, sizeof(struct file_head_block) + 8);
+		end = (section != -1) ? section : (int) length;
+
+		if (section != -1 && offset >= section && offset < length) {
+			snprintf(description, size, "menu table, byte %d", offset - section);
+			return true;
+		}
+
+		section = file_head->dialogues;
+
+		if (section != -1 && offset >= section && offset < end) {
+			snprintf(description, size, "dialogue table, byte %d", offset - section);
+			return true;
+		}
+
+		end = (section != -1) ? section : end;
+		section = file_head->validation;
+
+		if (offset >= section && offset < end) {
+			snprintf(description, size, "string pool, byte %d", offset - section);
+			return true;
+		}
+
+		end = section;
+		section = file_head->indirection;
+
+		if (offset >= section && offset < end) {
+			snprintf(description, size, "relocation table, byte %d", offset - section);
+			return true;
+		}
+
+		return false;
+	}
+
+	/* The indirected text blocks, whose lengths come from their targets. */
+
+	section = parse_offset(file_head->indirection);
+
+	for (block = 0; section != -1 && parse_valid(length, section, 4); block++) {
+		if (parse_word(file, section) == -1) {
+			if (offset >= section && offset < section + 4) {
+				snprintf(description, size, "indirected text terminator");
+				return true;
+			}
+			break;
+		}
+
+		if (!parse_valid(length, parse_offset(parse_word(file, section)) + 8, 4))
+			break;
+
+		block_length = (parse_word(file, parse_offset(parse_word(file, section)) + 8) + 7) & (~3);
+		if (block_length <= 0)
+			break;
+
+		if (offset >= section && offset < section + block_length) {
+			snprintf(description, size, "indirected text block %d, byte %d", block, offset - section);
+			return true;
+		}
+
+		section += block_length;
+	}
+
+	/* The validation string blocks, which record their own lengths. */
+
+	section = parse_offset(file_head->validation);
+
+	for (block = 0; section != -1 && parse_valid(length, section, 4); block++) {
+		if (parse_word(file, section) == -1) {
+			if (offset >= section && offset < section + 4) {
+				snprintf(description, size, "validation string terminator");
+				return true;
+			}
+			break;
+		}
+
+		if (!parse_valid(length, section + 4, 4))
+			break;
+
+		block_length = parse_word(file, section + 4);
+		if (block_length <= 0)
+			break;
+
+		if (offset >= section && offset < section + block_length) {
+			snprintf(description, size, "validation string block %d, byte %d", block, offset - section);
+			return true;
+		}
+
+		section += block_length;
+	}
+
+	/* The dialogue name list, in new format files only. */
+
+	section = parse_offset(file_head->dialogues);
+
+	if (section != -1 && parse_valid(length, section, 4) && parse_word(file, section) == 0) {
+		if (offset >= section && offset < section + 4) {
+			snprintf(description, size, "dialogue list head");
+			return true;
+		}
+
+		section += 4;
+
+		for (block = 0; parse_valid(length, section, 4); block++) {
+			block_length = (parse_word(file, section) == -1) ? 4 : parse_tag_block_length(file, length, section);
+			if (block_length <= 0)
+				break;
+
+			if (offset >= section && offset < section + block_length) {
+				if (parse_word(file, section) == -1)
+					snprintf(description, size, "dialogue list terminator");
+				else
+					snprintf(description, size, "dialogue list entry %d ('%s'), byte %d", block, (char *) (file + section + 4), offset - section);
+				return true;
+			}
+
+			if (parse_word(file, section) == -1)
+				break;
+
+			section += block_length;
+		}
+	}
+
+	/* The menu name list, in files with an extended head. */
+
+	section = (extended) ? parse_offset(parse_word(file, sizeof(struct file_head_block) + 8)) : -1;
+
+	for (block = 0; section != -1 && parse_valid(length, section, 4); block++) {
+		block_length = (parse_word(file, section) == -1) ? 4 : parse_tag_block_length(file, length, section);
+		if (block_length <= 0)
+			break;
+
+		if (offset >= section && offset < section + block_length) {
+			if (parse_word(file, section) == -1)
+				snprintf(description, size, "menu name list terminator");
+			else
+				snprintf(description, size, "menu name entry %d ('%s'), byte %d", block, (char *) (file + section + 4), offset - section);
+			return true;
+		}
+
+		if (parse_word(file, section) == -1)
+			break;
+
+		section += block_length;
+	}
+
+	return false;
+}
+
+
+/**
+ * Test whether a block of data lies entirely within a file.
+ *
+ * \param length	The length of the file.
+ * \param offset	The offset of the block.
+ * \param size		The size of the block.
+ * \return		True if the block is within the file; else False.
+ */
+
+static bool parse_valid(size_t length, int offset, int size)
+{
+	return (offset >= 0 && size >= 0 && (size_t) offset + size <= length) ? true : false;
+}
+
+
+/**
+ * Read a word from a file, whose offset must already have been validated.
+ *
+ * \param *file		Pointer to the file data.
+ * \param offset	The offset of the word to read.
+ * \return		The word read.
+ */
+
+static int parse_word(int8_t *file, int offset)
+{
+	int	word;
+
+	memcpy(&word, file + offset, sizeof(int));
+
+	return word;
+}
+
+
+/**
+ * Find the length of a dialogue or menu name block, which consists of an
+ * offset word followed by a terminated and word-aligned name.
+ *
+ * \param *file		Pointer to the file data.
+ * \param length	The length of the file.
+ * \param offset	The offset of the block.
+ * \return		The length of the block, or 0 if it isn't terminated.
+ */
+
+static int parse_tag_block_length(int8_t *file, size_t length, int offset)
+{
+	int	end;
+
+	for (end = offset + 4; end < length && file[end] != '\0'; end++);
+
+	if (end >= length)
+		return 0;
+
+	return (end - offset + 4) & (~3);
+}
+
+
+/**
+ * Convert a word from a file into an offset, taking account of the base
+ * address if the file has been relocated.
+ *
+ * \param word		The word to convert.
+ * \return		The offset, or -1 if the word was -1.
+ */
+
+static int parse_offset(int word)
+{
+	if (word == -1)
+		return -1;
+
+	return (int) ((unsigned) word - (unsigned) parse_base);
+}
+
+
+/**
+ * Read an entry from a compact file's relocation table or dialogue chain,
+ * stored seven bits to a byte with the top bit set on all but the last.
+ *
+ * \param *file		Pointer to the file data.
+ * \param length	The length of the file.
+ * \param *offset	Pointer to the offset of the entry, which is
+ *			updated to the offset of the next entry.
+ * \return		The value of the entry.
+ */
+
+static int parse_compact_entry(int8_t *file, size_t length, int *offset)
+{
+	unsigned	value = 0;
+	int		shift = 0;
+
+	while (*offset < length && shift < 32) {
+		value |= (unsigned) (file[*offset] & 0x7f) << shift;
+		shift += 7;
+
+		if ((file[(*offset)++] & 0x80) == 0)
+			break;
+	}
+
+	return (int) value;
+}
@@ -25,6 +25,8 @@
 #ifndef MENUTEST_PARSE_H
 #define MENUTEST_PARSE_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /**
@@ -36,5 +38,18 @@
 
 void parse_process(int8_t *file, size_t length);
 
+/**
+ * Describe the part of a menu file in which a given offset falls.
+ *
+ * \param *file		Pointer to the file data to be described.
+ * \param length	The length of the data block.
+ * \param offset	The offset to be described.
+ * \param *description	Pointer to a buffer to take the description.
+ * \param size		The size of the description buffer.
+ * \return		True if the offset is in a known section; else False.
+ */
+
+bool parse_describe_offset(int8_t *file, size_t length, int offset, char *description, size_t size);
+
 #endif
 
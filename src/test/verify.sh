@@ -0,0 +1,545 @@
+#!/bin/sh
+#
+# Copyright 1996-2015, Stephen Fryatt (info@stevefryatt.org.uk)
+#
+# This file is part of MenuGen:
+#
+#   http://www.stevefryatt.org.uk/risc-os/
+#
+# Licensed under the EUPL, Version 1.2 only (the "Licence");
+# You may not use this work except in compliance with the
+# Licence.
+#
+# You may obtain a copy of the Licence at:
+#
+#   http://joinup.ec.europa.eu/software/page/eupl
+#
+# Unless required by applicable law or agreed to in
+# writing, software distributed under the Licence is
+# distributed on an "AS IS" basis, WITHOUT WARRANTIES
+# OR CONDITIONS OF ANY KIND, either express or implied.
+#
+# See the Licence for the specific language governing
+# permissions and limitations under the Licence.
+
+
+# Check that every way of running MenuGen produces exactly the same Menus
+# files as the plain, single-job pipeline, which acts as the reference.
+# The corpus is made up of the definitions in the defs folder alongside
+# this script, plus a range of generated ones. Each file is compiled with
+# each combination of embedding options, and any mismatches are reported
+# by MenuDiff, which identifies the first section to differ.
+#
+# Relocated and sharded files can't be compared byte for byte, so MenuTest
+# is used to check that they decode to the same menus as the reference
+# instead.
+#
+# If a separate reference MenuGen is given -- built from a known good
+# version, for example -- it is used for the reference outputs instead.
+#
+# Usage: verify.sh <menugen> <menudiff> <menutest> <menucorpus> <workdir> [<reference>]
+
+MENUGEN=$1
+MENUDIFF=$2
+MENUTEST=$3
+MENUCORPUS=$4
+WORKDIR=$5
+REFERENCE=${6:-$MENUGEN}
+
+if [ -z "$MENUGEN" ] || [ -z "$MENUDIFF" ] || [ -z "$MENUTEST" ] || [ -z "$MENUCORPUS" ] || [ -z "$WORKDIR" ]; then
+	echo "Usage: verify.sh <menugen> <menudiff> <menutest> <menucorpus> <workdir> [<reference>]"
+	exit 1
+fi
+
+DEFS=$(dirname "$0")/defs
+
+rm -rf "$WORKDIR"
+mkdir -p "$WORKDIR/corpus" "$WORKDIR/reference" "$WORKDIR/output" || exit 1
+
+# Assemble the corpus.
+
+cp "$DEFS"/*.def "$WORKDIR/corpus/" || exit 1
+
+generate() {
+	name=$1
+	shift
+	"$MENUCORPUS" "$WORKDIR/corpus/$name.def" "$@" || exit 1
+}
+
+generate default
+generate wide -menus 200 -items 30 -fanout 5 -indirected 60 -writable 30 -validation 80 -seed 2
+generate deep -menus 300 -fanout 1 -depth 50 -seed 3
+generate dboxes -menus 500 -dboxes 400 -dboxnames 37 -seed 4
+generate single -menus 1 -items 1 -fanout 0 -dboxes 0 -seed 5
+generate comments -comments 100 -seed 6
+generate large -menus 5000 -dboxes 1000 -dboxnames 200 -seed 7
+
+SOURCES=$(cd "$WORKDIR/corpus" && ls *.def | sed 's/\.def$//')
+
+# Each set of options is given a short name, which is used for the output
+# files.
+
+OPTIONS="plain:none d:-d m:-m dm:-d,-m"
+
+flags() {
+	echo "$1" | sed -e 's/^none$//' -e 's/,/ /g'
+}
+
+# Build the reference files with the plain pipeline, one job at a time.
+
+for option in $OPTIONS; do
+	name=${option%%:*}
+	for source in $SOURCES; do
+		"$REFERENCE" "$WORKDIR/corpus/$source.def" "$WORKDIR/reference/$source-$name.mnu" $(flags ${option#*:}) > /dev/null 2>&1 || {
+			echo "Reference failed to compile $source with $name options"
+			exit 1
+		}
+	done
+done
+
+failures=0
+
+# Compare the outputs from a mode against the reference files, or against
+# those in another folder if one is given.
+
+compare() {
+	mode=$1
+	reference=${2:-$WORKDIR/reference}
+	for option in $OPTIONS; do
+		name=${option%%:*}
+		for source in $SOURCES; do
+			if ! "$MENUDIFF" "$reference/$source-$name.mnu" "$WORKDIR/output/$source-$name.mnu"; then
+				echo "  Mode $mode, source $source, options $name"
+				failures=$((failures + 1))
+			fi
+		done
+	done
+
+	rm -f "$WORKDIR/output/"*.mnu
+	echo "Checked mode: $mode"
+}
+
+# Single jobs, with all of the diagnostics turned on.
+
+for option in $OPTIONS; do
+	name=${option%%:*}
+	for source in $SOURCES; do
+		"$MENUGEN" "$WORKDIR/corpus/$source.def" "$WORKDIR/output/$source-$name.mnu" $(flags ${option#*:}) \
+				-v -time -stats "$WORKDIR/stats.json" -trace "$WORKDIR/trace.json" > /dev/null 2>&1
+	done
+done
+
+compare diagnostics
+
+# Single jobs reading from standard input and writing to standard output.
+
+for option in $OPTIONS; do
+	name=${option%%:*}
+	for source in $SOURCES; do
+		"$MENUGEN" - - $(flags ${option#*:}) < "$WORKDIR/corpus/$source.def" > "$WORKDIR/output/$source-$name.mnu" 2> /dev/null
+	done
+done
+
+compare pipe
+
+# Every combination from a single parse, using variants. The main output
+# takes the last set of options, so that each variant has to undo the
+# collation of the one before.
+
+for source in $SOURCES; do
+	variants=""
+	main=""
+	for option in $OPTIONS; do
+		if [ -n "$main" ]; then
+			variants="$variants -variant $main"
+		fi
+		main="$WORKDIR/output/$source-${option%%:*}.mnu $(flags ${option#*:})"
+	done
+
+	"$MENUGEN" "$WORKDIR/corpus/$source.def" $main $variants > /dev/null 2>&1
+done
+
+compare variants
+
+# Every combination again, with the titles and items replaced by message
+# tokens and looked up in a Messages file which gives back the original
+# text. Every third token is left out of the file and given a default
+# instead, so that both routes are checked.
+
+tokenise() {
+	awk -v messages="$2" '
+	{
+		line = $0
+		out = ""
+		while (match(line, /"[^"]*"/)) {
+			head = substr(line, 1, RSTART - 1)
+			text = substr(line, RSTART + 1, RLENGTH - 2)
+			line = substr(line, RSTART + RLENGTH)
+			if (head ~ /validation[ \t]*\([ \t]*$/) {
+				out = out head "\"" text "\""
+			} else if (++tokens % 3 == 0) {
+				out = out head "\"@T" tokens ":" text "\""
+			} else {
+				out = out head "\"@T" tokens "\""
+				print "T" tokens ":" text > messages
+			}
+		}
+		print out line
+	}' "$1"
+}
+
+for source in $SOURCES; do
+	tokenise "$WORKDIR/corpus/$source.def" "$WORKDIR/messages.txt" > "$WORKDIR/tokens.def"
+
+	variants=""
+	main=""
+	for option in $OPTIONS; do
+		if [ -n "$main" ]; then
+			variants="$variants -variant $main -messages $WORKDIR/messages.txt"
+		fi
+		main="$WORKDIR/output/$source-${option%%:*}.mnu $(flags ${option#*:})"
+	done
+
+	"$MENUGEN" "$WORKDIR/tokens.def" $main -messages "$WORKDIR/messages.txt" $variants > /dev/null 2>&1
+	rm -f "$WORKDIR/messages.txt"
+done
+
+compare messages
+
+# Every combination again, after first building the menus with a Messages
+# file whose translations are all too long to be held directly, so that
+# each variant has to go back to direct text where its own translations
+# are short enough.
+
+for source in $SOURCES; do
+	tokenise "$WORKDIR/corpus/$source.def" "$WORKDIR/messages.txt" > "$WORKDIR/tokens.def"
+	sed 's/$/ (long translation)/' "$WORKDIR/messages.txt" > "$WORKDIR/long.txt"
+
+	variants=""
+	for option in $OPTIONS; do
+		variants="$variants -variant $WORKDIR/output/$source-${option%%:*}.mnu $(flags ${option#*:}) -messages $WORKDIR/messages.txt"
+	done
+
+	"$MENUGEN" "$WORKDIR/tokens.def" "$WORKDIR/long.mnu" -messages "$WORKDIR/long.txt" $variants > /dev/null 2>&1
+	rm -f "$WORKDIR/messages.txt" "$WORKDIR/long.txt" "$WORKDIR/long.mnu"
+done
+
+compare locales
+
+# Every combination again, transcoding the text from UTF-8 into Latin1.
+# The reference is built from copies of the sources which have already
+# been converted by iconv, if it's available.
+
+if command -v iconv > /dev/null 2>&1; then
+	mkdir -p "$WORKDIR/latin1"
+
+	for source in $SOURCES; do
+		iconv -f UTF-8 -t ISO-8859-1 "$WORKDIR/corpus/$source.def" > "$WORKDIR/latin1/$source.def" || exit 1
+
+		variants=""
+		main=""
+		for option in $OPTIONS; do
+			name=${option%%:*}
+			"$REFERENCE" "$WORKDIR/latin1/$source.def" "$WORKDIR/latin1/$source-$name.mnu" $(flags ${option#*:}) > /dev/null 2>&1 || {
+				echo "Reference failed to compile $source with $name options"
+				exit 1
+			}
+
+			if [ -n "$main" ]; then
+				variants="$variants -variant $main -encoding latin1"
+			fi
+			main="$WORKDIR/output/$source-$name.mnu $(flags ${option#*:})"
+		done
+
+		"$MENUGEN" "$WORKDIR/corpus/$source.def" $main -encoding latin1 $variants > /dev/null 2>&1
+	done
+
+	compare encoding "$WORKDIR/latin1"
+
+	# The Latin1 variants again, this time following a main output left
+	# in UTF-8. Some of the international text, such as "Ändern Größe",
+	# only fits in an icon block once transcoded, so each variant has to
+	# undo the indirection of the UTF-8 collation.
+
+	for source in $SOURCES; do
+		variants=""
+		for option in $OPTIONS; do
+			variants="$variants -variant $WORKDIR/output/$source-${option%%:*}.mnu $(flags ${option#*:}) -encoding latin1"
+		done
+
+		"$MENUGEN" "$WORKDIR/corpus/$source.def" "$WORKDIR/utf8.mnu" $variants > /dev/null 2>&1
+		rm -f "$WORKDIR/utf8.mnu"
+	done
+
+	compare encoding-variants "$WORKDIR/latin1"
+fi
+
+# Single jobs which also write C headers; the Menus files must not change,
+# and the headers must compile if there's a C compiler to hand.
+
+for option in $OPTIONS; do
+	name=${option%%:*}
+	for source in $SOURCES; do
+		"$MENUGEN" "$WORKDIR/corpus/$source.def" "$WORKDIR/output/$source-$name.mnu" $(flags ${option#*:}) \
+				-header "$WORKDIR/output/$source-$name.h" > /dev/null 2>&1
+
+		if command -v "${CC:-cc}" > /dev/null 2>&1 && ! "${CC:-cc}" -fsyntax-only -x c "$WORKDIR/output/$source-$name.h"; then
+			echo "  Mode header, source $source, options $name: header does not compile"
+			failures=$((failures + 1))
+		fi
+	done
+done
+
+rm -f "$WORKDIR/output/"*.h
+
+compare header
+
+# Single jobs writing the files as C and as assembler, with a variant for
+# each. If there's a C compiler to hand, each is linked with a program that
+# writes the data back out again, which must match the reference.
+
+if command -v "${CC:-cc}" > /dev/null 2>&1; then
+	cat > "$WORKDIR/image.c" <<-EOF
+		#include <stdio.h>
+
+		extern unsigned int menus[];
+		extern const int menus_size;
+
+		int main(int argc, char *argv[])
+		{
+			FILE *file = fopen(argv[1], "wb");
+
+			return (file == NULL || fwrite(menus, 1, menus_size, file) != menus_size || fclose(file) != 0);
+		}
+	EOF
+
+	mkdir -p "$WORKDIR/asm"
+
+	for option in $OPTIONS; do
+		name=${option%%:*}
+		for source in $SOURCES; do
+			"$MENUGEN" "$WORKDIR/corpus/$source.def" "$WORKDIR/output/$source-$name.c" $(flags ${option#*:}) -format c \
+					-variant "$WORKDIR/output/$source-$name.s" $(flags ${option#*:}) -format asm > /dev/null 2>&1
+
+			"${CC:-cc}" -o "$WORKDIR/image-c" "$WORKDIR/image.c" "$WORKDIR/output/$source-$name.c" > /dev/null 2>&1 &&
+					"$WORKDIR/image-c" "$WORKDIR/output/$source-$name.mnu"
+			"${CC:-cc}" -o "$WORKDIR/image-asm" "$WORKDIR/image.c" "$WORKDIR/output/$source-$name.s" > /dev/null 2>&1 &&
+					"$WORKDIR/image-asm" "$WORKDIR/asm/$source-$name.mnu"
+		done
+	done
+
+	rm -f "$WORKDIR/output/"*.c "$WORKDIR/output/"*.s
+
+	compare image-c
+
+	mv "$WORKDIR/asm/"*.mnu "$WORKDIR/output/" 2>/dev/null
+
+	compare image-asm
+fi
+
+# Single jobs relocated to a fixed address, for the options which give an
+# extended head in the reference too. Other than the flags and the base
+# address, MenuTest must find the same menus in both.
+
+for option in $OPTIONS; do
+	name=${option%%:*}
+	case "$name" in
+	*m)	;;
+	*)	continue ;;
+	esac
+
+	for source in $SOURCES; do
+		"$MENUGEN" "$WORKDIR/corpus/$source.def" "$WORKDIR/output/$source-$name.mnu" $(flags ${option#*:}) -base 0x8000 > /dev/null 2>&1
+
+		"$MENUTEST" "$WORKDIR/reference/$source-$name.mnu" | grep -v "^File flags:" > "$WORKDIR/reference.txt"
+		"$MENUTEST" "$WORKDIR/output/$source-$name.mnu" | grep -v "^File flags:" | grep -v "^Relocated to base address:" > "$WORKDIR/output.txt"
+
+		if ! cmp -s "$WORKDIR/reference.txt" "$WORKDIR/output.txt"; then
+			echo "  Mode relocated, source $source, options $name"
+			failures=$((failures + 1))
+		fi
+	done
+done
+
+rm -f "$WORKDIR/output/"*.mnu "$WORKDIR/reference.txt" "$WORKDIR/output.txt"
+echo "Checked mode: relocated"
+
+# Single jobs written as compressed containers, which MenuDiff expands
+# before comparing them. Each must have the compressed flag (bit 1) set.
+
+for option in $OPTIONS; do
+	name=${option%%:*}
+	for source in $SOURCES; do
+		"$MENUGEN" "$WORKDIR/corpus/$source.def" "$WORKDIR/output/$source-$name.mnu" $(flags ${option#*:}) -compress > /dev/null 2>&1
+
+		flagword=$(od -An -tu4 -j16 -N4 "$WORKDIR/output/$source-$name.mnu" 2> /dev/null | tr -d ' ')
+
+		if [ $(((${flagword:-0} / 2) % 2)) -ne 1 ]; then
+			echo "  Mode compressed, source $source, options $name: not compressed"
+			failures=$((failures + 1))
+		fi
+	done
+done
+
+compare compressed
+
+# Single jobs split into shards. Between them, the shards must hold the
+# same menus and items as the reference, and there must be as many of them
+# as the manifest says.
+
+decode() {
+	"$MENUTEST" "$1" | grep -e "^  [A-Za-z]* title:" -e "^  \* " -e "^  Menu entry:"
+}
+
+for option in $OPTIONS; do
+	name=${option%%:*}
+	for source in $SOURCES; do
+		"$MENUGEN" "$WORKDIR/corpus/$source.def" "$WORKDIR/output/$source-$name.mnu" $(flags ${option#*:}) \
+				-shards "$WORKDIR/output/$source-$name.man" > /dev/null 2>&1
+
+		decode "$WORKDIR/reference/$source-$name.mnu" | sort > "$WORKDIR/reference.txt"
+
+		shards=$(od -An -tu4 -N4 "$WORKDIR/output/$source-$name.man" 2> /dev/null | tr -d ' ')
+		shard=0
+		file="$WORKDIR/output/$source-$name.mnu"
+		while [ -f "$file" ]; do
+			decode "$file"
+			shard=$((shard + 1))
+			file="$WORKDIR/output/$source-$name.mnu$shard"
+		done | sort > "$WORKDIR/output.txt"
+
+		files=$(ls "$WORKDIR/output/$source-$name.mnu"* 2> /dev/null | wc -l)
+
+		if [ "$shards" != "$files" ] || ! cmp -s "$WORKDIR/reference.txt" "$WORKDIR/output.txt"; then
+			echo "  Mode shards, source $source, options $name"
+			failures=$((failures + 1))
+		fi
+
+		rm -f "$WORKDIR/output/$source-$name."*
+
+		# The structure report must cope with links to other shards.
+
+		if ! "$MENUGEN" "$WORKDIR/corpus/$source.def" "$WORKDIR/output/$source-$name.mnu" $(flags ${option#*:}) \
+				-shards "$WORKDIR/output/$source-$name.man" -v > /dev/null 2>&1; then
+			echo "  Mode shards, source $source, options $name: report failed"
+			failures=$((failures + 1))
+		fi
+
+		rm -f "$WORKDIR/output/$source-$name."*
+	done
+done
+
+rm -f "$WORKDIR/reference.txt" "$WORKDIR/output.txt"
+echo "Checked mode: shards"
+
+# Single jobs in the compact format. MenuTest must find the same menus and
+# names as in the reference, and where the reference has an extended head
+# too, the compact file must be no larger.
+
+summary() {
+	"$MENUTEST" "$1" | grep -e "^  [A-Za-z]* title:" -e "^  \* " -e "^  Width:" -e "^  Height:" -e "^  Gap:" \
+			-e "^  Menu entry:" -e "^  Dialogue list:"
+}
+
+for option in $OPTIONS; do
+	name=${option%%:*}
+	for source in $SOURCES; do
+		"$MENUGEN" "$WORKDIR/corpus/$source.def" "$WORKDIR/output/$source-$name.mnu" $(flags ${option#*:}) -compact > /dev/null 2>&1
+
+		summary "$WORKDIR/reference/$source-$name.mnu" > "$WORKDIR/reference.txt"
+		summary "$WORKDIR/output/$source-$name.mnu" > "$WORKDIR/output.txt"
+
+		if ! cmp -s "$WORKDIR/reference.txt" "$WORKDIR/output.txt"; then
+			echo "  Mode compact, source $source, options $name"
+			failures=$((failures + 1))
+		fi
+
+		case "$name" in
+		*m)	if [ $(wc -c < "$WORKDIR/output/$source-$name.mnu") -gt $(wc -c < "$WORKDIR/reference/$source-$name.mnu") ]; then
+				echo "  Mode compact, source $source, options $name: larger than the reference"
+				failures=$((failures + 1))
+			fi ;;
+		esac
+	done
+done
+
+rm -f "$WORKDIR/output/"*.mnu "$WORKDIR/reference.txt" "$WORKDIR/output.txt"
+echo "Checked mode: compact"
+
+# Batch mode, with the options given on the command line.
+
+for option in $OPTIONS; do
+	name=${option%%:*}
+	for source in $SOURCES; do
+		echo "$WORKDIR/corpus/$source.def $WORKDIR/output/$source-$name.mnu"
+	done > "$WORKDIR/batch-$name.txt"
+
+	"$MENUGEN" -batch "$WORKDIR/batch-$name.txt" $(flags ${option#*:}) > /dev/null 2>&1
+done
+
+compare batch
+
+# Batch mode, with every combination in a single job file, so that the jobs
+# run one after another with different options in the same process.
+
+for source in $SOURCES; do
+	for option in $OPTIONS; do
+		echo "$WORKDIR/corpus/$source.def $WORKDIR/output/$source-${option%%:*}.mnu $(flags ${option#*:})"
+	done
+done > "$WORKDIR/batch-mixed.txt"
+
+"$MENUGEN" -batch "$WORKDIR/batch-mixed.txt" > /dev/null 2>&1
+
+compare mixed-batch
+
+# Batch mode again, with the lines padded out with spaces and redundant
+# options ahead of the real ones, so that none of them fit the buffers in
+# one go, and no newline at the end.
+
+for source in $SOURCES; do
+	for option in $OPTIONS; do
+		printf '%s %s%1100s' "$WORKDIR/corpus/$source.def" "$WORKDIR/output/$source-${option%%:*}.mnu" ""
+		for repeat in 1 2 3 4 5 6 7 8 9 10; do
+			printf ' -format menus'
+		done
+		echo " $(flags ${option#*:})"
+	done
+done > "$WORKDIR/batch-lines.txt"
+
+printf '%s' "$(cat "$WORKDIR/batch-lines.txt")" > "$WORKDIR/batch-long.txt"
+
+"$MENUGEN" -batch "$WORKDIR/batch-long.txt" > /dev/null 2>&1
+
+compare long-batch
+
+# Batch mode with every combination on a single job line for each source,
+# using variants with their own Messages files as in the messages mode, so
+# that the lines carry many more options than a simple job.
+
+for source in $SOURCES; do
+	tokenise "$WORKDIR/corpus/$source.def" "$WORKDIR/messages-$source.txt" > "$WORKDIR/tokens-$source.def"
+
+	variants=""
+	main=""
+	for option in $OPTIONS; do
+		if [ -n "$main" ]; then
+			variants="$variants -variant $main -messages $WORKDIR/messages-$source.txt -format menus"
+		fi
+		main="$WORKDIR/output/$source-${option%%:*}.mnu $(flags ${option#*:})"
+	done
+
+	echo "$WORKDIR/tokens-$source.def $main -messages $WORKDIR/messages-$source.txt $variants"
+done > "$WORKDIR/batch-variants.txt"
+
+"$MENUGEN" -batch "$WORKDIR/batch-variants.txt" > /dev/null 2>&1
+
+rm -f "$WORKDIR/messages-"*.txt "$WORKDIR/tokens-"*.def
+
+compare variant-batch
+
+if [ $failures -gt 0 ]; then
+	echo "$failures outputs differ from the reference."
+	exit 1
+fi
+
+echo "All outputs match the reference."